@@ -73,3 +73,11 @@ end
 extrude_and_scale = extrudeAndScale
 document[[extrude_and_scale(m:mesh,v:vertex,dir:vec3,magnitude,scale) extrudes and scales the faces adjacent to v]](extrude_and_scale)
 categorise(extrude_and_scale,"mesh")
+
+extrude_many = fg.extrude_many
+document[[extrude_many(m:mesh,vertices,directions,magnitudes) extrudes the faces around each vertex like extrude(m,v,dir,magnitude), all at once.
+	vertices is a vertexset or a table of vertices, directions a table of vec3 (or nil for the vertex normals), and magnitudes a table or a single number.
+	The vertices must not be on a border or neighbour each other (their faces can't overlap), this is checked before the mesh is changed.
+	Returns a table of the cap loops, the loop of vertices around each extruded vertex.
+E.g., local caps = extrude_many(m,spikes,nil,0.1)]](extrude_many)
+categorise(extrude_many,"mesh")
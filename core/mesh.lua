@@ -41,10 +41,19 @@ document[[a face is a triangle within a mesh.
 document[[mesh is a triangular mesh. You construct a mesh as a primitive (cube,icosahedron,etc.) or with load_mesh().
 	Member functions:
 	subdivide(n) -- subdivide the mesh n times
-	smooth_subdivide(n) -- smooth subdivide the mesh n times (Loop Subdivision)
-	sync() -- recalculate all the vertex and face normals
+	smooth_subdivide(n) -- smooth subdivide the mesh n times (interpolating butterfly subdivision)
+	loop_subdivide(n) -- smooth subdivide the mesh n times (Loop subdivision)
+	subdivide_faces(faces,n) -- subdivide only some faces (a faceset or a table) n times, the faces around them are split so there are no cracks
+	subdivide_vertices(vertices,n) -- subdivide the faces around some vertices n times
+	adaptive_subdivide(max_edge_length,max_error,max_faces):integer -- split edges until they are shorter than max_edge_length and their curvature error is below max_error, stopping at max_faces faces (0 ignores a limit), returns the number of vertices added
+	remesh(target_length,iterations) -- make the triangles regular with edges about target_length long, by splitting, collapsing and flipping edges and relaxing the vertices (the borders stay put)
+	remesh_faces(faces,target_length,iterations) -- remesh only some faces (a faceset or a table), the border of the selection stays put
+	sync() -- recalculate the vertex and face normals (only around modified vertices if possible)
+	sync_all() -- recalculate all the vertex and face normals
+	compact() -- remove deleted vertices and faces from memory (vertices and faces you hold stay valid)
+	set_auto_compact(f) -- compact during sync() when more than fraction f of the vertices or faces are deleted (0 disables)
 	apply_transform(mtx) -- apply the transform matrix to the mesh vertices
-	clone():mesh -- copy the mesh 		
+	clone():mesh -- copy the mesh (the copy shares memory with the original until one of them is modified)
 ]](mesh)
 
 foreach({mesh,vertex,face}, function(_,f) categorise(f,"mesh") end)
@@ -62,8 +71,46 @@ document[[iso(res,f) creates an isosurface from function f(x,y,z) within a 2x2x2
 
 foreach({cube,sphere,icosahedron,tetrahedron,dodecahedron,octahedron,cone,cylinder,iso}, function(_,f) categorise(f,"mesh") end)
 
+-- fields, for iso_field
+document[[iso_field(res,field) creates an isosurface where field is 0 (negative inside) within a 2x2x2 space of resolution res.
+Native fields are evaluated in C++ on all cores, which is much faster than iso(res,f).
+	sphere_field(centre:vec3,r), box_field(centre:vec3,halfsize:vec3)
+	fg.metaballs([threshold]) -- then m:add(centre:vec3,radius,strength)
+	noise_field(scale,amplitude,octaves)
+	union_field(a,b), intersection_field(a,b), difference_field(a,b), smooth_union_field(a,b,k), sum_field(a,b)
+	lua_field(f) -- f(xs,ys,zs) is called once per slice of points with arrays of coordinates and returns an array of values]](iso_field)
+categorise(iso_field,"mesh")
+
+document[[sparse_iso_field(res,field[,lipschitz]) is like iso_field but only samples the grid near the surface, so res can be much higher (e.g., 512).
+If lipschitz is given it must bound how fast the field changes (1 for sphere_field and box_field) and nothing is missed,
+otherwise features smaller than about 8 grid cells may be missed.]](sparse_iso_field)
+categorise(sparse_iso_field,"mesh")
+
+document[[sphere_field(centre:vec3,r) is the distance to a sphere (negative inside), for iso_field]](sphere_field)
+document[[box_field(centre:vec3,halfsize:vec3) is the distance to a box (negative inside), for iso_field]](box_field)
+document[[noise_field(scale,amplitude,octaves) is amplitude*frac_sum(scale*p,octaves), e.g., sum_field(sphere_field(c,r),noise_field(4,0.1,3)) is a bumpy sphere]](noise_field)
+document[[lua_field(f) is a field defined by f(xs,ys,zs), which is called with arrays of coordinates (a slice of points at a time) and returns an array of values.
+It is evaluated on the main thread, so it is slower than the native fields.]](lua_field)
+document[[union_field(a,b) is the union of the fields a and b, min(a,b)]](union_field)
+document[[intersection_field(a,b) is the intersection of the fields a and b, max(a,b)]](intersection_field)
+document[[difference_field(a,b) is the field a with b cut out of it, max(a,-b)]](difference_field)
+document[[smooth_union_field(a,b,k) is the union of the fields a and b, rounded off where they are within k of each other]](smooth_union_field)
+document[[sum_field(a,b) is a+b, e.g., to add noise_field to another field]](sum_field)
+
+foreach({sphere_field,box_field,noise_field,lua_field,union_field,intersection_field,difference_field,smooth_union_field,sum_field}, function(_,f) categorise(f,"field") end)
+
+set_function_name(fg.metaballs,"fg.metaballs")
+document[[fg.metaballs([threshold]) makes an empty set of metaballs, a field for iso_field. The surface is where the total of the balls reaches threshold (default 0.5).
+	Member functions:
+	add(centre:vec3,radius,strength) -- add a ball, which contributes strength*(1-d^2/radius^2)^2 within radius of centre
+	set_threshold(t), get_threshold()
+	size() -- the number of balls
+E.g., local m = fg.metaballs() m:add(vec3(0,0,0),0.5,1) m:add(vec3(0.4,0,0),0.5,1) local blob = iso_field(64,m)]](fg.metaballs)
+categorise(fg.metaballs,"field")
+
 load_mesh = fg.mesh.load
-document[[load_mesh(file) loads a mesh from a file. supported formats: obj]](load_mesh)
+document[[load_mesh(file) loads a mesh from a file. supported formats: obj, ply
+A binary copy (e.g., blob.obj.fgm) is saved next to the file, which makes later loads much faster. It is rebuilt whenever the file changes.]](load_mesh)
 categorise(load_mesh,"mesh")
 
 -- operations
@@ -72,6 +119,84 @@ split_edge = fg.split_edge
 document[[split_edge(mesh,pos) splits the edge in pos into two and retriangulates the adjacent faces]](split_edge) 
 categorise(split_edge, "mesh")
 
+flip_edge = fg.flip_edge
+document[[flip_edge(mesh,pos) flips the edge in pos so it joins the other corners of its two faces, returns false if it can't]](flip_edge)
+categorise(flip_edge, "mesh")
+
+collapse_edge = fg.collapse_edge
+document[[collapse_edge(mesh,pos) collapses the edge in pos into its midpoint, keeping the vertex of pos. returns false if that would make the mesh non-manifold]](collapse_edge)
+categorise(collapse_edge, "mesh")
+
+function noise_displace(mesh,frequency,amplitude,octaves,falloff,turbulent)
+	fg.noise_displace(mesh,frequency,amplitude,octaves or 1,falloff or 1,turbulent or false)
+end
+document[[noise_displace(m:mesh,frequency,amplitude[,octaves,falloff,turbulent]) moves each vertex along its normal by amplitude*noise(frequency*p), or frac_sum (turbulence if turbulent is true) with more than 1 octave.
+The noise is evaluated in bulk and in parallel, so it is much faster than calling noise for each vertex.]](noise_displace)
+categorise(noise_displace, "mesh")
+
+function noise_colour(mesh,frequency,octaves,falloff,turbulent)
+	fg.noise_colour(mesh,frequency,octaves or 1,falloff or 1,turbulent or false)
+end
+document[[noise_colour(m:mesh,frequency[,octaves,falloff,turbulent]) sets the colour of each vertex to a grey level from the noise at frequency*p (as for noise_displace), mapped from [-1,1] (or [0,1] for turbulence) to black and white]](noise_colour)
+categorise(noise_colour, "mesh")
+
+-- spatial queries
+
+set_function_name(fg.bvh,"fg.bvh")
+document[[fg.bvh(m:mesh) builds a tree over the faces of m for fast spatial queries. It is rebuilt (or, if only vertex positions changed, refitted) automatically when m changes.
+	Member functions:
+	raycast(origin:vec3,dir:vec3[,max_distance[,min_distance]]) -- the nearest face hit by the ray, either side of a face counts
+	closest_point(p:vec3[,max_distance]) -- the nearest point on the mesh to p
+	  both return a hit with fields: hit (false if nothing was found), distance, point, face, u, v (barycentric coordinates of point)
+	overlap_sphere(centre:vec3,radius) -- the faces within radius of centre
+	overlap_box(min:vec3,max:vec3) -- the faces that intersect the box
+	overlap_triangle(a:vec3,b:vec3,c:vec3) -- the faces that intersect the triangle
+	overlap_face(f:face) -- the faces that intersect f, except those sharing a vertex with it (for detecting self-intersection)
+	  these return a faceset, e.g., for f in b:overlap_sphere(v.p,0.1).all do ... end
+	update() -- bring the tree up to date with m now rather than at the next query
+	rebuild() -- rebuild the tree from scratch
+E.g., cast a ray from v along its normal: local h = b:raycast(v.p + v.n*0.001, v.n) if h.hit then ... end]](fg.bvh)
+categorise(fg.bvh,"mesh")
+
+set_function_name(fg.spatial_hash,"fg.spatial_hash")
+document[[fg.spatial_hash(m:mesh[,cell_size]) hashes the vertex positions of m for fast neighbour queries. Vertices that moved are rehashed automatically (it is rebuilt if the topology of m changes).
+The queries are fastest when cell_size is about the query radius, by default it is twice the average edge length.
+	Properties:
+	cell_size
+	Member functions:
+	within(p:vec3,radius) -- the vertices within radius of p
+	nearest(p:vec3,k) -- the k nearest vertices to p, nearest first
+	  these return a vertexset, e.g., for v in h:within(p,0.1).all do ... end
+	pairs_within(radius) -- a table of every pair {v1,v2} of vertices within radius of each other
+	update() -- bring the hash up to date with m now rather than at the next query
+	rebuild() -- rebuild the hash from scratch
+E.g., push apart vertices that are too close: for _,pr in ipairs(h:pairs_within(0.05)) do ... end]](fg.spatial_hash)
+categorise(fg.spatial_hash,"mesh")
+
+-- subdivision and smoothing
+
+set_function_name(fg.subdivider,"fg.subdivider")
+document[[fg.subdivider() (or fg.loop_subdivider()) and fg.butterfly_subdivider() make a subdivider, for smoothing a mesh that is subdivided again every frame.
+The subdivision weights are computed once for the connectivity of the mesh, so while only its vertices move it is much faster than smooth_subdivide on a clone.
+	Member functions:
+	subdivide(m:mesh,n):mesh -- m subdivided n times (m itself is unchanged). The same mesh is returned and updated in place while the topology of m stays the same.
+E.g., local smooth = s:subdivide(m,2)]](fg.subdivider)
+categorise(fg.subdivider,"mesh")
+
+set_function_name(fg.smoother,"fg.smoother")
+document[[fg.smoother([lambda]), fg.cotangent_smoother([lambda[,mu]]) and fg.taubin_smoother([lambda,mu]) make a smoother, which moves vertices towards the average of their neighbours (Laplacian smoothing).
+Each step moves a vertex by lambda (default 0.5) of the way to the average. The cotangent smoother weights the neighbours by the shape of the triangles between them, so the vertices slide across the surface less.
+A taubin smoother follows each step with one by mu (default -0.53), which stops the mesh shrinking. Border vertices only move along the border.
+The neighbours are found once for the connectivity of the mesh (and the vertices), and the steps run in parallel, so it is much faster than smoothing with foreachv and loopv.
+	Properties:
+	lambda, mu
+	Member functions:
+	smooth(m:mesh,n) -- smooth every vertex of m n times
+	smooth_vertices(m:mesh,vs,n[,ws]) -- smooth only the vertices vs (a vertexset or a table), the others stay where they are.
+	  ws is a table with a weight (from 0 to 1) for each of vs, which scales how far it moves, e.g., to fade the smoothing out at the edge of a region.
+E.g., fg.taubin_smoother():smooth(m,10)]](fg.smoother)
+categorise(fg.smoother,"mesh")
+
 -- helpers
 
 
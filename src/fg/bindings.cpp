@@ -50,6 +50,12 @@
 #include "fg/meshoperators.h"
 #include "fg/pos.h"
 #include "fg/phyllo.h"
+#include "fg/parallel.h"
+#include "fg/field.h"
+#include "fg/meshbvh.h"
+#include "fg/spatialhash.h"
+#include "fg/smoother.h"
+#include "fg/subdivider.h"
 #include "fg/geometry_wrapper.h"
 
 #include "fg/gc/turtle.h"
@@ -61,6 +67,142 @@ fg::Vec3 matmul(const fg::Mat4& m, const fg::Vec3& v){
 	return m*((vcg::Point3<double>)(v));
 }
 
+// field constructors (see fg/field.h)
+static boost::shared_ptr<fg::Field> sphereField(fg::Vec3 c, double r){return boost::shared_ptr<fg::Field>(new fg::SphereField(c,r));}
+static boost::shared_ptr<fg::Field> boxField(fg::Vec3 c, fg::Vec3 h){return boost::shared_ptr<fg::Field>(new fg::BoxField(c,h));}
+static boost::shared_ptr<fg::Field> noiseField(double s, double a, int o){return boost::shared_ptr<fg::Field>(new fg::NoiseField(s,a,o));}
+static boost::shared_ptr<fg::Field> luaField(luabind::object f){return boost::shared_ptr<fg::Field>(new fg::LuaField(f,true));}
+static boost::shared_ptr<fg::Field> blendField(fg::BlendField::Op op, boost::shared_ptr<fg::Field> a, boost::shared_ptr<fg::Field> b, double k = 0){
+	return boost::shared_ptr<fg::Field>(new fg::BlendField(op,a,b,k));
+}
+static boost::shared_ptr<fg::Field> unionField(boost::shared_ptr<fg::Field> a, boost::shared_ptr<fg::Field> b){return blendField(fg::BlendField::UNION,a,b);}
+static boost::shared_ptr<fg::Field> intersectionField(boost::shared_ptr<fg::Field> a, boost::shared_ptr<fg::Field> b){return blendField(fg::BlendField::INTERSECTION,a,b);}
+static boost::shared_ptr<fg::Field> differenceField(boost::shared_ptr<fg::Field> a, boost::shared_ptr<fg::Field> b){return blendField(fg::BlendField::DIFFERENCE,a,b);}
+static boost::shared_ptr<fg::Field> smoothUnionField(boost::shared_ptr<fg::Field> a, boost::shared_ptr<fg::Field> b, double k){return blendField(fg::BlendField::SMOOTH_UNION,a,b,k);}
+static boost::shared_ptr<fg::Field> sumField(boost::shared_ptr<fg::Field> a, boost::shared_ptr<fg::Field> b){return blendField(fg::BlendField::SUM,a,b);}
+static boost::shared_ptr<fg::Mesh> sparseIsoField(int res, boost::shared_ptr<fg::Field> f){return fg::Mesh::Primitives::SparseIso(res,f);}
+
+// bvh queries (see fg/meshbvh.h), luabind doesn't handle default arguments or output parameters
+static fg::MeshBVH::Hit bvhRaycast(fg::MeshBVH& b, fg::Vec3 o, fg::Vec3 d){return b.raycast(o,d);}
+static fg::MeshBVH::Hit bvhRaycastMax(fg::MeshBVH& b, fg::Vec3 o, fg::Vec3 d, double maxd){return b.raycast(o,d,maxd);}
+static fg::MeshBVH::Hit bvhRaycastMinMax(fg::MeshBVH& b, fg::Vec3 o, fg::Vec3 d, double maxd, double mind){return b.raycast(o,d,maxd,mind);}
+static fg::MeshBVH::Hit bvhClosestPoint(fg::MeshBVH& b, fg::Vec3 p){return b.closestPoint(p);}
+static fg::MeshBVH::Hit bvhClosestPointMax(fg::MeshBVH& b, fg::Vec3 p, double maxd){return b.closestPoint(p,maxd);}
+static boost::shared_ptr<fg::Mesh::FaceSet> bvhOverlapSphere(fg::MeshBVH& b, fg::Vec3 c, double r){
+	boost::shared_ptr<fg::Mesh::FaceSet> s(new fg::Mesh::FaceSet());
+	b.overlapSphere(c,r,*s);
+	return s;
+}
+static boost::shared_ptr<fg::Mesh::FaceSet> bvhOverlapBox(fg::MeshBVH& b, fg::Vec3 min, fg::Vec3 max){
+	boost::shared_ptr<fg::Mesh::FaceSet> s(new fg::Mesh::FaceSet());
+	b.overlapBox(min,max,*s);
+	return s;
+}
+static boost::shared_ptr<fg::Mesh::FaceSet> bvhOverlapTriangle(fg::MeshBVH& b, fg::Vec3 p0, fg::Vec3 p1, fg::Vec3 p2){
+	boost::shared_ptr<fg::Mesh::FaceSet> s(new fg::Mesh::FaceSet());
+	b.overlapTriangle(p0,p1,p2,*s);
+	return s;
+}
+static boost::shared_ptr<fg::Mesh::FaceSet> bvhOverlapFace(fg::MeshBVH& b, boost::shared_ptr<fg::FaceProxy> f){
+	boost::shared_ptr<fg::Mesh::FaceSet> s(new fg::Mesh::FaceSet());
+	b.overlapFace(f,*s);
+	return s;
+}
+
+// spatial hash queries (see fg/spatialhash.h)
+static boost::shared_ptr<fg::Mesh::VertexSet> hashVertices(const fg::SpatialHash& h, const std::vector<int>& indices){
+	boost::shared_ptr<fg::Mesh::VertexSet> s(new fg::Mesh::VertexSet());
+	for(unsigned int i=0;i<indices.size();i++) s->push_back(h.getVertex(indices[i]));
+	return s;
+}
+static boost::shared_ptr<fg::Mesh::VertexSet> hashWithin(fg::SpatialHash& h, fg::Vec3 p, double r){
+	std::vector<int> indices;
+	h.queryRadius(p,r,indices);
+	return hashVertices(h,indices);
+}
+static boost::shared_ptr<fg::Mesh::VertexSet> hashNearest(fg::SpatialHash& h, fg::Vec3 p, int k){
+	std::vector<int> indices;
+	h.queryNearest(p,k,indices);
+	return hashVertices(h,indices);
+}
+static luabind::object hashPairsWithin(fg::SpatialHash& h, double r, lua_State* L){
+	std::vector<std::pair<int,int> > pairs;
+	h.queryPairs(r,pairs);
+	luabind::object result = luabind::newtable(L);
+	for(unsigned int i=0;i<pairs.size();i++){
+		luabind::object pair = luabind::newtable(L);
+		pair[1] = h.getVertex(pairs[i].first);
+		pair[2] = h.getVertex(pairs[i].second);
+		result[i+1] = pair;
+	}
+	return result;
+}
+
+// local subdivision (see Mesh::subdivideFaces), the selection can be a faceset/vertexset or a table
+template <class Set, class Proxy>
+static Set luaSelection(luabind::object o){
+	if (luabind::type(o)!=LUA_TTABLE) return luabind::object_cast<Set>(o);
+	Set s;
+	for(luabind::iterator it(o),end;it!=end;++it){
+		s.push_back(luabind::object_cast<boost::shared_ptr<Proxy> >(*it));
+	}
+	return s;
+}
+static void subdivideFaces(fg::Mesh& m, luabind::object faces, int levels){
+	m.subdivideFaces(luaSelection<fg::Mesh::FaceSet,fg::FaceProxy>(faces),levels);
+}
+static void subdivideVertices(fg::Mesh& m, luabind::object vertices, int levels){
+	m.subdivideVertices(luaSelection<fg::Mesh::VertexSet,fg::VertexProxy>(vertices),levels);
+}
+static void remeshFaces(fg::Mesh& m, luabind::object faces, double targetLength, int iterations){
+	m.remeshFaces(luaSelection<fg::Mesh::FaceSet,fg::FaceProxy>(faces),targetLength,iterations);
+}
+
+// batched extrusion (see fg/meshoperators.h), directions can be nil (the normals) and magnitudes a number,
+// returns a table of the cap loops (each a table of vertices)
+static luabind::object luaExtrudeMany(fg::Mesh* m, luabind::object vertices, luabind::object directions, luabind::object magnitudes, lua_State* L){
+	std::vector<fg::Vec3> dirs;
+	if (luabind::type(directions)==LUA_TTABLE){
+		for(luabind::iterator it(directions),end;it!=end;++it) dirs.push_back(luabind::object_cast<fg::Vec3>(*it));
+	}
+	std::vector<double> mags;
+	if (luabind::type(magnitudes)==LUA_TTABLE){
+		for(luabind::iterator it(magnitudes),end;it!=end;++it) mags.push_back(luabind::object_cast<double>(*it));
+	}
+	else mags.push_back(luabind::object_cast<double>(magnitudes));
+
+	std::vector<boost::shared_ptr<fg::Mesh::VertexSet> > loops = fg::extrudeMany(m,luaSelection<fg::Mesh::VertexSet,fg::VertexProxy>(vertices),dirs,mags);
+	luabind::object result = luabind::newtable(L);
+	for(unsigned int i=0;i<loops.size();i++){
+		luabind::object loop = luabind::newtable(L);
+		int j = 1;
+		BOOST_FOREACH(boost::shared_ptr<fg::VertexProxy>& v, *loops[i]) loop[j++] = v;
+		result[i+1] = loop;
+	}
+	return result;
+}
+
+// smoothers (see fg/smoother.h), the vertices can be a vertexset or a table, and the weights a table with one for each of them
+static boost::shared_ptr<fg::Smoother> smoother(){return boost::shared_ptr<fg::Smoother>(new fg::Smoother(fg::Smoother::UNIFORM));}
+static boost::shared_ptr<fg::Smoother> smoother1(double lambda){return boost::shared_ptr<fg::Smoother>(new fg::Smoother(fg::Smoother::UNIFORM,lambda));}
+static boost::shared_ptr<fg::Smoother> cotangentSmoother(){return boost::shared_ptr<fg::Smoother>(new fg::Smoother(fg::Smoother::COTANGENT));}
+static boost::shared_ptr<fg::Smoother> cotangentSmoother1(double lambda){return boost::shared_ptr<fg::Smoother>(new fg::Smoother(fg::Smoother::COTANGENT,lambda));}
+static boost::shared_ptr<fg::Smoother> cotangentSmoother2(double lambda, double mu){return boost::shared_ptr<fg::Smoother>(new fg::Smoother(fg::Smoother::COTANGENT,lambda,mu));}
+static boost::shared_ptr<fg::Smoother> taubinSmoother(){return boost::shared_ptr<fg::Smoother>(new fg::Smoother(fg::Smoother::UNIFORM,0.5,-0.53));}
+static boost::shared_ptr<fg::Smoother> taubinSmoother2(double lambda, double mu){return boost::shared_ptr<fg::Smoother>(new fg::Smoother(fg::Smoother::UNIFORM,lambda,mu));}
+static void smootherSmoothVertices(fg::Smoother& s, fg::Mesh* m, luabind::object vertices, int iterations){
+	s.smoothVertices(m,luaSelection<fg::Mesh::VertexSet,fg::VertexProxy>(vertices),iterations);
+}
+static void smootherSmoothVerticesWeighted(fg::Smoother& s, fg::Mesh* m, luabind::object vertices, int iterations, luabind::object weights){
+	std::vector<double> w;
+	for(luabind::iterator it(weights),end;it!=end;++it) w.push_back(luabind::object_cast<double>(*it));
+	s.smoothVertices(m,luaSelection<fg::Mesh::VertexSet,fg::VertexProxy>(vertices),w,iterations);
+}
+
+// subdividers (see fg/subdivider.h)
+static boost::shared_ptr<fg::Subdivider> loopSubdivider(){return boost::shared_ptr<fg::Subdivider>(new fg::Subdivider(fg::Subdivider::LOOP));}
+static boost::shared_ptr<fg::Subdivider> butterflySubdivider(){return boost::shared_ptr<fg::Subdivider>(new fg::Subdivider(fg::Subdivider::BUTTERFLY));}
+
 namespace fg {
 	int loadLuaBindings(lua_State* L){
 		using namespace luabind;
@@ -110,6 +252,12 @@ namespace fg {
            def("get_angle_from_h", (double(*)(double,double,double))&getAngleFromH)
 		   ];
 
+		// fg/parallel.h
+		module(L)[
+		   def("set_num_threads", &Parallel::setNumThreads),
+		   def("get_num_threads", &Parallel::getNumThreads)
+		   ];
+
 
 		/*
 		module(L)[
@@ -400,7 +548,17 @@ namespace fg {
 		   .def("subdivide", &Mesh::subdivide)
 		   .def("smoothSubdivide", &Mesh::smoothSubdivide) // TODO: deprecate
 		   .def("smooth_subdivide", &Mesh::smoothSubdivide)
+		   .def("loop_subdivide", &Mesh::loopSubdivide)
+		   .def("subdivide_faces", &subdivideFaces)
+		   .def("subdivide_vertices", &subdivideVertices)
+		   .def("adaptive_subdivide", &Mesh::adaptiveSubdivide)
+		   .def("remesh", &Mesh::remesh)
+		   .def("remesh_faces", &remeshFaces)
 		   .def("sync", &Mesh::sync)
+		   .def("sync_all", &Mesh::syncAll)
+		   .def("compact", &Mesh::compact)
+		   .def("set_auto_compact", &Mesh::setAutoCompact)
+		   .def("get_auto_compact", &Mesh::getAutoCompact)
 		   .def("apply_transform", &Mesh::applyTransform) // TODO: deprecate
 		   .def("applyTransform", &Mesh::applyTransform)
 		   .def("clone", &Mesh::clone)
@@ -434,7 +592,100 @@ namespace fg {
 			def("octahedron", &fg::Mesh::Primitives::Octahedron),
 			def("cone", &fg::Mesh::Primitives::Cone), // (r1,r2,subdiv=36)
 			def("cylinder", &fg::Mesh::Primitives::Cylinder), // (slices) // ,stacks)
-			def("iso", (shared_ptr<fg::Mesh>(*)(int,luabind::object)) &fg::Mesh::Primitives::Iso)
+			def("iso", (shared_ptr<fg::Mesh>(*)(int,luabind::object)) &fg::Mesh::Primitives::Iso),
+			def("iso_field", (shared_ptr<fg::Mesh>(*)(int,shared_ptr<fg::Field>)) &fg::Mesh::Primitives::Iso),
+			def("sparse_iso_field", &sparseIsoField),
+			def("sparse_iso_field", &fg::Mesh::Primitives::SparseIso)
+		];
+
+		// fg/field.h
+		module(L,"fg")[
+		   class_<fg::Field, boost::shared_ptr<fg::Field> >("field")
+		   .def("eval", &fg::Field::eval),
+
+		   class_<fg::MetaballsField, fg::Field, boost::shared_ptr<fg::MetaballsField> >("metaballs")
+		   .def(constructor<>())
+		   .def(constructor<double>())
+		   .def("add", &fg::MetaballsField::add)
+		   .def("set_threshold", &fg::MetaballsField::setThreshold)
+		   .def("get_threshold", &fg::MetaballsField::getThreshold)
+		   .def("size", &fg::MetaballsField::size)
+		];
+
+		module(L)[
+		   def("sphere_field", &sphereField),
+		   def("box_field", &boxField),
+		   def("noise_field", &noiseField),
+		   def("lua_field", &luaField),
+		   def("union_field", &unionField),
+		   def("intersection_field", &intersectionField),
+		   def("difference_field", &differenceField),
+		   def("smooth_union_field", &smoothUnionField),
+		   def("sum_field", &sumField)
+		];
+
+		// fg/meshbvh.h
+		module(L,"fg")[
+		   class_<fg::MeshBVH::Hit>("bvhhit")
+		   .property("hit", &fg::MeshBVH::Hit::getHit)
+		   .property("distance", &fg::MeshBVH::Hit::getDistance)
+		   .property("point", &fg::MeshBVH::Hit::getPoint)
+		   .property("face", &fg::MeshBVH::Hit::getFace)
+		   .property("u", &fg::MeshBVH::Hit::getU)
+		   .property("v", &fg::MeshBVH::Hit::getV),
+
+		   class_<fg::MeshBVH, boost::shared_ptr<fg::MeshBVH> >("bvh")
+		   .def(constructor<boost::shared_ptr<fg::Mesh> >())
+		   .def("update", &fg::MeshBVH::update)
+		   .def("rebuild", &fg::MeshBVH::rebuild)
+		   .def("raycast", &bvhRaycast)
+		   .def("raycast", &bvhRaycastMax)
+		   .def("raycast", &bvhRaycastMinMax)
+		   .def("closest_point", &bvhClosestPoint)
+		   .def("closest_point", &bvhClosestPointMax)
+		   .def("overlap_sphere", &bvhOverlapSphere)
+		   .def("overlap_box", &bvhOverlapBox)
+		   .def("overlap_triangle", &bvhOverlapTriangle)
+		   .def("overlap_face", &bvhOverlapFace)
+		];
+
+		// fg/spatialhash.h
+		module(L,"fg")[
+		   class_<fg::SpatialHash, boost::shared_ptr<fg::SpatialHash> >("spatial_hash")
+		   .def(constructor<boost::shared_ptr<fg::Mesh> >())
+		   .def(constructor<boost::shared_ptr<fg::Mesh>,double>())
+		   .property("cell_size", &fg::SpatialHash::getCellSize)
+		   .def("update", &fg::SpatialHash::update)
+		   .def("rebuild", &fg::SpatialHash::rebuild)
+		   .def("within", &hashWithin)
+		   .def("nearest", &hashNearest)
+		   .def("pairs_within", &hashPairsWithin)
+		];
+
+		// fg/smoother.h
+		module(L,"fg")[
+		   class_<fg::Smoother, boost::shared_ptr<fg::Smoother> >("_smoother")
+		   .property("lambda", &fg::Smoother::getLambda)
+		   .property("mu", &fg::Smoother::getMu)
+		   .def("smooth", (void(fg::Smoother::*)(Mesh*,int))&fg::Smoother::smooth)
+		   .def("smooth_vertices", &smootherSmoothVertices)
+		   .def("smooth_vertices", &smootherSmoothVerticesWeighted),
+		   def("smoother", &smoother),
+		   def("smoother", &smoother1),
+		   def("cotangent_smoother", &cotangentSmoother),
+		   def("cotangent_smoother", &cotangentSmoother1),
+		   def("cotangent_smoother", &cotangentSmoother2),
+		   def("taubin_smoother", &taubinSmoother),
+		   def("taubin_smoother", &taubinSmoother2)
+		];
+
+		// fg/subdivider.h
+		module(L,"fg")[
+		   class_<fg::Subdivider, boost::shared_ptr<fg::Subdivider> >("_subdivider")
+		   .def("subdivide", (boost::shared_ptr<Mesh>(fg::Subdivider::*)(boost::shared_ptr<Mesh>,int))&fg::Subdivider::subdivide),
+		   def("subdivider", &loopSubdivider),
+		   def("loop_subdivider", &loopSubdivider),
+		   def("butterfly_subdivider", &butterflySubdivider)
 		];
 
 		// fg/meshoperators.h
@@ -445,8 +696,14 @@ namespace fg {
 		   def("getVerticesWithinDistance", getVerticesWithinDistance),
 		   def("nloop", nloop),
 
+		   def("extrude_many", &luaExtrudeMany),
+
 		   def("splitEdge", splitEdge),
 		   def("split_edge", splitEdge),
+		   def("flip_edge", flipEdge),
+		   def("collapse_edge", collapseEdge),
+		   def("noise_displace", &fg::displaceByNoise),
+		   def("noise_colour", &fg::colourByNoise),
 
 		   /// \deprecated
 		   def("_extrude", (void(*)(Mesh*,VertexProxy,int,Vec3,double,double))&fg::extrude)
@@ -27,9 +27,14 @@
 #include "fg/mesh.h"
 
 namespace fg {
-	FaceProxy::FaceProxy(Mesh* m, FaceImpl* fi):Proxy<FaceImpl>(fi),mMesh(m){}
+	FaceProxy::FaceProxy(Mesh* m, FaceImpl* fi):Proxy<FaceImpl>(m->_faceHandles(),fi),mMesh(m){}
 	FaceProxy::~FaceProxy(){}
 
+	FaceImpl* FaceProxy::pImpl(){
+		mMesh->_detach();
+		return Proxy<FaceImpl>::pImpl();
+	}
+
 	shared_ptr<VertexProxy> FaceProxy::getV(int i) const{
 		return mMesh->_newSP(static_cast<VertexImpl*>(constImpl().cV(i)));
 	}
@@ -41,6 +46,7 @@ namespace fg {
 	void FaceProxy::calculateNormal(){
 		vcg::face::ComputeNormal(*pImpl());
 		pImpl()->N().Normalize();
+		mMesh->_touchFace(pImpl());
 	}
 
 	bool FaceProxy::operator==(const FaceProxy& fp) const {
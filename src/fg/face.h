@@ -52,6 +52,9 @@ namespace fg {
 		FaceProxy(Mesh* m, FaceImpl* vi);
 		~FaceProxy();
 
+		using Proxy<FaceImpl>::pImpl; // read-only access through a const proxy
+		FaceImpl* pImpl(); ///< Write access, detaches the mesh first if its storage is shared (see Mesh::clone())
+
 		shared_ptr<VertexProxy> getV(int i) const; ///< Return vertex i, where i is 0, 1 or 2.
 
 		Vec3 getN() const; // hmm, can't be const (because of vcg...)
@@ -65,7 +68,7 @@ namespace fg {
 		Mesh* mMesh;
 	};
 
-	typedef ProxyList<FaceImpl> FaceProxyList;
+	typedef HandleTable<FaceImpl> FaceHandleTable;
 }
 
 std::ostream& operator<<(std::ostream&, const fg::FaceProxy&);
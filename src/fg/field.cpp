@@ -0,0 +1,207 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/field.h"
+#include "fg/functions.h"
+
+#include <luabind/luabind.hpp>
+#include <luabind/function.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace fg {
+	void Field::evalMany(const double* xyz, int n, float* out) const {
+		for(int i=0;i<n;i++){
+			out[i] = eval(xyz[3*i],xyz[3*i+1],xyz[3*i+2]);
+		}
+	}
+
+	SphereField::SphereField(Vec3 centre, double radius)
+	:mCentre(centre)
+	,mRadius(radius)
+	{}
+
+	double SphereField::eval(double x, double y, double z) const {
+		double dx = x-mCentre.X(), dy = y-mCentre.Y(), dz = z-mCentre.Z();
+		return std::sqrt(dx*dx+dy*dy+dz*dz) - mRadius;
+	}
+
+	BoxField::BoxField(Vec3 centre, Vec3 halfSize)
+	:mCentre(centre)
+	,mHalfSize(halfSize)
+	{}
+
+	double BoxField::eval(double x, double y, double z) const {
+		double qx = std::fabs(x-mCentre.X()) - mHalfSize.X();
+		double qy = std::fabs(y-mCentre.Y()) - mHalfSize.Y();
+		double qz = std::fabs(z-mCentre.Z()) - mHalfSize.Z();
+		// distance outside plus (negative) distance inside
+		double ox = std::max(qx,0.), oy = std::max(qy,0.), oz = std::max(qz,0.);
+		return std::sqrt(ox*ox+oy*oy+oz*oz) + std::min(std::max(qx,std::max(qy,qz)),0.);
+	}
+
+	MetaballsField::MetaballsField(double threshold)
+	:mBalls()
+	,mThreshold(threshold)
+	{}
+
+	void MetaballsField::add(Vec3 centre, double radius, double strength){
+		Ball b;
+		b.x = centre.X();
+		b.y = centre.Y();
+		b.z = centre.Z();
+		b.invRadiusSquared = 1./(radius*radius);
+		b.strength = strength;
+		mBalls.push_back(b);
+	}
+
+	double MetaballsField::eval(double x, double y, double z) const {
+		double sum = 0;
+		foreach(const Ball& b, mBalls){
+			double dx = x-b.x, dy = y-b.y, dz = z-b.z;
+			double t = 1 - (dx*dx+dy*dy+dz*dz)*b.invRadiusSquared;
+			if (t>0) sum += b.strength*t*t;
+		}
+		return mThreshold - sum;
+	}
+
+	void MetaballsField::evalMany(const double* xyz, int n, float* out) const {
+		// ball by ball, so the inner loop is over the points
+		std::vector<double> sum(n,0.);
+		foreach(const Ball& b, mBalls){
+			for(int i=0;i<n;i++){
+				double dx = xyz[3*i]-b.x, dy = xyz[3*i+1]-b.y, dz = xyz[3*i+2]-b.z;
+				double t = 1 - (dx*dx+dy*dy+dz*dz)*b.invRadiusSquared;
+				if (t>0) sum[i] += b.strength*t*t;
+			}
+		}
+		for(int i=0;i<n;i++){
+			out[i] = mThreshold - sum[i];
+		}
+	}
+
+	NoiseField::NoiseField(double scale, double amplitude, int octaves)
+	:mScale(scale)
+	,mAmplitude(amplitude)
+	,mOctaves(octaves)
+	{}
+
+	double NoiseField::eval(double x, double y, double z) const {
+		if (mOctaves<=1) return mAmplitude*noise(mScale*x,mScale*y,mScale*z);
+		return mAmplitude*fracSum(mScale*x,mScale*y,mScale*z,mOctaves);
+	}
+
+	void NoiseField::evalMany(const double* xyz, int n, float* out) const {
+		if (n<=0) return;
+		std::vector<double> p(xyz,xyz+3*n);
+		for(int i=0;i<3*n;i++) p[i] *= mScale;
+		std::vector<double> values(n);
+		if (mOctaves<=1) noiseMany(&p[0],n,&values[0]);
+		else fracSumMany(&p[0],n,&values[0],mOctaves);
+		for(int i=0;i<n;i++){
+			out[i] = mAmplitude*values[i];
+		}
+	}
+
+	BlendField::BlendField(Op op, shared_ptr<Field> a, shared_ptr<Field> b, double k)
+	:mOp(op)
+	,mA(a)
+	,mB(b)
+	,mK(k)
+	{}
+
+	double BlendField::blend(double a, double b) const {
+		switch (mOp){
+			case UNION: return std::min(a,b);
+			case INTERSECTION: return std::max(a,b);
+			case DIFFERENCE: return std::max(a,-b);
+			case SMOOTH_UNION: {
+				if (mK<=0) return std::min(a,b);
+				double h = std::min(std::max(0.5 + 0.5*(b-a)/mK,0.),1.);
+				return b + (a-b)*h - mK*h*(1-h);
+			}
+			case SUM: return a+b;
+		}
+		return a;
+	}
+
+	double BlendField::eval(double x, double y, double z) const {
+		return blend(mA->eval(x,y,z),mB->eval(x,y,z));
+	}
+
+	void BlendField::evalMany(const double* xyz, int n, float* out) const {
+		std::vector<float> b(n);
+		mA->evalMany(xyz,n,out);
+		mB->evalMany(xyz,n,&b[0]);
+		for(int i=0;i<n;i++){
+			out[i] = blend(out[i],b[i]);
+		}
+	}
+
+	bool BlendField::isThreadSafe() const {
+		return mA->isThreadSafe() and mB->isThreadSafe();
+	}
+
+	LuaField::LuaField(luabind::object function, bool batched)
+	:mFunction(function)
+	,mBatched(batched)
+	{}
+
+	double LuaField::eval(double x, double y, double z) const {
+		if (mBatched){
+			float r;
+			double xyz[3] = {x,y,z};
+			evalMany(xyz,1,&r);
+			return r;
+		}
+		return luabind::call_function<float>(mFunction,x,y,z);
+	}
+
+	void LuaField::evalMany(const double* xyz, int n, float* out) const {
+		if (!mBatched){
+			Field::evalMany(xyz,n,out);
+			return;
+		}
+
+		lua_State* L = mFunction.interpreter();
+		luabind::object xs = luabind::newtable(L);
+		luabind::object ys = luabind::newtable(L);
+		luabind::object zs = luabind::newtable(L);
+		for(int i=0;i<n;i++){
+			xs[i+1] = xyz[3*i];
+			ys[i+1] = xyz[3*i+1];
+			zs[i+1] = xyz[3*i+2];
+		}
+
+		luabind::object values = luabind::call_function<luabind::object>(mFunction,xs,ys,zs);
+		if (luabind::type(values)!=LUA_TTABLE){
+			throw(std::runtime_error("A batched field function must return an array of values"));
+		}
+		for(int i=0;i<n;i++){
+			out[i] = luabind::object_cast<float>(values[i+1]);
+		}
+	}
+}
@@ -0,0 +1,171 @@
+/**
+ * \file
+ * \brief Scalar fields for building iso-surfaces
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_FIELD_H
+#define FG_FIELD_H
+
+#include <vector>
+
+#include <luabind/object.hpp>
+
+#include "fg/util.h"
+#include "fg/vec3.h"
+
+namespace fg {
+	/**
+	 * \brief A scalar field, e.g., the density function of an iso-surface.
+	 *
+	 * Fields are negative inside a shape and positive outside (like a signed
+	 * distance), so Mesh::Primitives::Iso extracts the surface where the field is 0.
+	 *
+	 * Fields are evaluated in bulk via evalMany(), which Iso calls once per slice
+	 * of grid points. Native fields are thread-safe so the volume can be
+	 * polygonised in parallel (see fg::MarchingCubes).
+	 */
+	class Field {
+	public:
+		virtual ~Field(){}
+
+		/// \brief The value of the field at (x,y,z)
+		virtual double eval(double x, double y, double z) const = 0;
+
+		/**
+		 * \brief Evaluate the field at n points.
+		 *
+		 * @param xyz The points, packed as x0,y0,z0,x1,y1,z1,...
+		 * @param out Receives the n values
+		 */
+		virtual void evalMany(const double* xyz, int n, float* out) const;
+
+		/// \brief True if evalMany() can be called from several threads at once
+		virtual bool isThreadSafe() const {return true;}
+
+		double evalVec(const Vec3& p) const {return eval(p.X(),p.Y(),p.Z());}
+	};
+
+	/// \brief The signed distance to a sphere
+	class SphereField: public Field {
+	public:
+		SphereField(Vec3 centre, double radius);
+		double eval(double x, double y, double z) const;
+	private:
+		Vec3 mCentre;
+		double mRadius;
+	};
+
+	/// \brief The signed distance to an axis-aligned box
+	class BoxField: public Field {
+	public:
+		BoxField(Vec3 centre, Vec3 halfSize);
+		double eval(double x, double y, double z) const;
+	private:
+		Vec3 mCentre;
+		Vec3 mHalfSize;
+	};
+
+	/**
+	 * \brief A set of metaballs
+	 *
+	 * Each ball contributes strength*(1-d^2/r^2)^2 within its radius r, and the
+	 * field is threshold minus the total, so the surface is where the total
+	 * reaches the threshold.
+	 */
+	class MetaballsField: public Field {
+	public:
+		MetaballsField(double threshold = 0.5);
+		void add(Vec3 centre, double radius, double strength = 1);
+		void setThreshold(double t){mThreshold = t;}
+		double getThreshold() const {return mThreshold;}
+		int size() const {return mBalls.size();}
+
+		double eval(double x, double y, double z) const;
+		void evalMany(const double* xyz, int n, float* out) const;
+	private:
+		struct Ball {
+			double x, y, z;
+			double invRadiusSquared;
+			double strength;
+		};
+		std::vector<Ball> mBalls;
+		double mThreshold;
+	};
+
+	/// \brief amplitude*fracSum(scale*p, octaves), e.g., added to another field to roughen it
+	class NoiseField: public Field {
+	public:
+		NoiseField(double scale, double amplitude, int octaves = 1);
+		double eval(double x, double y, double z) const;
+		void evalMany(const double* xyz, int n, float* out) const;
+	private:
+		double mScale;
+		double mAmplitude;
+		int mOctaves;
+	};
+
+	/// \brief Combines two fields
+	class BlendField: public Field {
+	public:
+		enum Op {
+			UNION, ///< min(a,b)
+			INTERSECTION, ///< max(a,b)
+			DIFFERENCE, ///< max(a,-b), i.e., a with b cut out
+			SMOOTH_UNION, ///< min(a,b), rounded off where the fields are within k of each other
+			SUM ///< a+b
+		};
+
+		BlendField(Op op, shared_ptr<Field> a, shared_ptr<Field> b, double k = 0);
+		double eval(double x, double y, double z) const;
+		void evalMany(const double* xyz, int n, float* out) const;
+		bool isThreadSafe() const;
+	private:
+		double blend(double a, double b) const;
+
+		Op mOp;
+		shared_ptr<Field> mA;
+		shared_ptr<Field> mB;
+		double mK;
+	};
+
+	/**
+	 * \brief A field defined by a lua function
+	 *
+	 * If batched the function is called once per slice of the grid with three arrays of
+	 * coordinates (xs,ys,zs) and must return an array of values. Otherwise it
+	 * is called once per point as f(x,y,z). Either way it only runs on the
+	 * thread that owns the lua state.
+	 */
+	class LuaField: public Field {
+	public:
+		LuaField(luabind::object function, bool batched);
+		double eval(double x, double y, double z) const;
+		void evalMany(const double* xyz, int n, float* out) const;
+		bool isThreadSafe() const {return false;}
+	private:
+		luabind::object mFunction;
+		bool mBatched;
+	};
+}
+
+#endif
@@ -76,16 +76,125 @@ namespace fg {
      */
     double turbulence(double x, double y, double z, int nOctaves, double falloff)
     {
-        double sum = abs(noise(x, y, z)); // first octave
+        double sum = std::fabs(noise(x, y, z)); // first octave
         double oct = 2.0;
         for (int i = 2; i < nOctaves; ++i)
         {
-            sum += (abs(noise(x * oct, y * oct, z * oct)) * falloff);
+            sum += (std::fabs(noise(x * oct, y * oct, z * oct)) * falloff);
             falloff /= 2.0;
             oct *= 2.0;
         }
         return sum;
     }
+
+	namespace {
+		const int BLOCK = 16;
+
+		// The gradients of vcg::math::Perlin::grad as vectors, so the corners can be
+		// evaluated without branches. The products are by 0 and +-1, so they are exact
+		// and the sums are the same as Perlin::grad's.
+		const double GRADIENTS[16][3] = {
+			{1,1,0},{-1,1,0},{1,-1,0},{-1,-1,0},
+			{1,0,1},{-1,0,1},{1,0,-1},{-1,0,-1},
+			{0,1,1},{0,-1,1},{0,1,-1},{0,-1,-1},
+			{1,1,0},{0,-1,1},{-1,1,0},{0,-1,-1}
+		};
+
+		inline double grad(int h, double x, double y, double z){
+			const double* g = GRADIENTS[h];
+			return g[0]*x + g[1]*y + g[2]*z;
+		}
+
+		/**
+		 * vcg::math::Perlin::Noise at (scale*x,scale*y,scale*z) for n <= BLOCK points.
+		 * Only hashing the corners is done point by point, the rest is done a step at a
+		 * time for the whole block.
+		 */
+		void noiseBlock(const double* xyz, int n, double scale, double* out){
+			typedef vcg::math::Perlin Perlin;
+			double x[BLOCK], y[BLOCK], z[BLOCK];
+			double u[BLOCK], v[BLOCK], w[BLOCK];
+			int X[BLOCK], Y[BLOCK], Z[BLOCK];
+			for(int i=0;i<n;i++){
+				const double px = xyz[3*i]*scale, py = xyz[3*i+1]*scale, pz = xyz[3*i+2]*scale;
+				const double fx = std::floor(px), fy = std::floor(py), fz = std::floor(pz);
+				X[i] = (int)fx & 255;
+				Y[i] = (int)fy & 255;
+				Z[i] = (int)fz & 255;
+				x[i] = px - fx;
+				y[i] = py - fy;
+				z[i] = pz - fz;
+			}
+			for(int i=0;i<n;i++){
+				u[i] = Perlin::fade(x[i]);
+				v[i] = Perlin::fade(y[i]);
+				w[i] = Perlin::fade(z[i]);
+			}
+
+			// the gradient hashes of the 8 corners
+			int h[8][BLOCK];
+			for(int i=0;i<n;i++){
+				const int A = Perlin::P(X[i])+Y[i], AA = Perlin::P(A)+Z[i], AB = Perlin::P(A+1)+Z[i];
+				const int B = Perlin::P(X[i]+1)+Y[i], BA = Perlin::P(B)+Z[i], BB = Perlin::P(B+1)+Z[i];
+				h[0][i] = Perlin::P(AA) & 15;
+				h[1][i] = Perlin::P(BA) & 15;
+				h[2][i] = Perlin::P(AB) & 15;
+				h[3][i] = Perlin::P(BB) & 15;
+				h[4][i] = Perlin::P(AA+1) & 15;
+				h[5][i] = Perlin::P(BA+1) & 15;
+				h[6][i] = Perlin::P(AB+1) & 15;
+				h[7][i] = Perlin::P(BB+1) & 15;
+			}
+
+			for(int i=0;i<n;i++){
+				const double g0 = grad(h[0][i], x[i]  , y[i]  , z[i]  );
+				const double g1 = grad(h[1][i], x[i]-1, y[i]  , z[i]  );
+				const double g2 = grad(h[2][i], x[i]  , y[i]-1, z[i]  );
+				const double g3 = grad(h[3][i], x[i]-1, y[i]-1, z[i]  );
+				const double g4 = grad(h[4][i], x[i]  , y[i]  , z[i]-1);
+				const double g5 = grad(h[5][i], x[i]-1, y[i]  , z[i]-1);
+				const double g6 = grad(h[6][i], x[i]  , y[i]-1, z[i]-1);
+				const double g7 = grad(h[7][i], x[i]-1, y[i]-1, z[i]-1);
+				out[i] = Perlin::lerp(w[i], Perlin::lerp(v[i], Perlin::lerp(u[i],g0,g1), Perlin::lerp(u[i],g2,g3)),
+				                            Perlin::lerp(v[i], Perlin::lerp(u[i],g4,g5), Perlin::lerp(u[i],g6,g7)));
+			}
+		}
+
+		/// the octaves of fracSum (or turbulence if absolute), which start with noise at scale 1
+		void octavesMany(const double* xyz, int n, double* out, int nOctaves, double falloff, bool absolute){
+			double octave[BLOCK];
+			for(int b=0;b<n;b+=BLOCK){
+				const int m = std::min(BLOCK,n-b);
+				double* sum = out + b;
+				noiseBlock(xyz+3*b,m,1,sum);
+				if (absolute) for(int i=0;i<m;i++) sum[i] = std::fabs(sum[i]);
+
+				double f = falloff;
+				double oct = 2.0;
+				for(int k=2;k<nOctaves;k++){
+					noiseBlock(xyz+3*b,m,oct,octave);
+					if (absolute) for(int i=0;i<m;i++) sum[i] += std::fabs(octave[i])*f;
+					else for(int i=0;i<m;i++) sum[i] += octave[i]*f;
+					f /= 2.0;
+					oct *= 2.0;
+				}
+			}
+		}
+	}
+
+	void noiseMany(const double* xyz, int n, double* out){
+		for(int b=0;b<n;b+=BLOCK){
+			noiseBlock(xyz+3*b,std::min(BLOCK,n-b),1,out+b);
+		}
+	}
+
+	void fracSumMany(const double* xyz, int n, double* out, int nOctaves, double falloff){
+		octavesMany(xyz,n,out,nOctaves,falloff,false);
+	}
+
+	void turbulenceMany(const double* xyz, int n, double* out, int nOctaves, double falloff){
+		octavesMany(xyz,n,out,nOctaves,falloff,true);
+	}
     
     
     /*
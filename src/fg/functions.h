@@ -206,6 +206,17 @@ namespace fg {
     double fracSum(double x, double y, double z, int nOctaves, double falloff = 1.0);
     double turbulence(double x, double y, double z, int nOctaves, double falloff = 1.0);
 
+	/**
+	 * \brief noise, fracSum and turbulence at n points, packed as x0,y0,z0,x1,y1,z1,... (as for Field::evalMany)
+	 *
+	 * These give the same values as calling the scalar functions for each point,
+	 * but evaluate the points in blocks with the per-point work in straight loops,
+	 * which the compiler can vectorise. They run on the calling thread.
+	 */
+	void noiseMany(const double* xyz, int n, double* out);
+	void fracSumMany(const double* xyz, int n, double* out, int nOctaves, double falloff = 1.0);
+	void turbulenceMany(const double* xyz, int n, double* out, int nOctaves, double falloff = 1.0);
+
     /**
      * random currently uses the OS rand function (beware!)
      */
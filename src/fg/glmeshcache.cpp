@@ -0,0 +1,338 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/glmeshcache.h"
+#include "fg/mesh.h"
+#include "fg/meshimpl.h"
+
+#include <algorithm>
+
+#include <boost/detail/lightweight_mutex.hpp>
+
+namespace fg {
+	namespace {
+		// guards changes to sEntries and sReleased, as meshes can be released by any thread
+		boost::detail::lightweight_mutex sMutex;
+	}
+
+	std::map<unsigned int, GLMeshCache::Entry> GLMeshCache::sEntries;
+	std::vector<unsigned int> GLMeshCache::sReleased;
+	bool GLMeshCache::sUseVBOs = true;
+
+	GLMeshCache::Arrays::Arrays()
+	:MeshSnapshot()
+	,indexed(false)
+	,uploaded(false)
+	,built(false)
+	{
+		for(int i=0;i<5;i++) buffers[i] = 0;
+	}
+
+	GLMeshCache::Entry& GLMeshCache::entry(Mesh* m){
+		// only the gl thread changes sEntries, so it can look it up without the lock
+		std::map<unsigned int, Entry>::iterator it = sEntries.find(m->getId());
+		if (it!=sEntries.end()) return it->second;
+		boost::detail::lightweight_mutex::scoped_lock lock(sMutex);
+		return sEntries[m->getId()];
+	}
+
+	GLMeshCache::Arrays& GLMeshCache::smooth(Mesh* m){
+		Arrays& a = entry(m).smooth;
+		if (!a.built){
+			// the journal lets later updates skip the unchanged vertices
+			m->setJournalEnabled(true);
+			buildSmooth(m,a);
+			upload(a);
+		}
+		else if (a.version!=m->getVersion()){
+			std::vector<MeshJournal::Range> vertices, faces;
+			if (a.topologyVersion==m->getTopologyVersion() and m->getJournal().getChangesSince(a.version,vertices,faces)){
+				updateSmooth(m,a,vertices);
+			}
+			else {
+				buildSmooth(m,a);
+				upload(a);
+			}
+		}
+		return a;
+	}
+
+	GLMeshCache::Arrays& GLMeshCache::flat(Mesh* m){
+		Arrays& a = entry(m).flat;
+		if (!a.built or a.version!=m->getVersion()){
+			buildFlat(m,a);
+			upload(a);
+		}
+		return a;
+	}
+
+	void GLMeshCache::buildSmooth(Mesh* m, Arrays& a){
+		a.build(m);
+		a.indexed = true;
+		a.built = true;
+	}
+
+	/// Upload count elements starting at element first
+	template <typename T>
+	static void bufferSubData(GLuint buffer, const std::vector<T>& data, int components, GLuint first, GLuint count){
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, first*components*sizeof(T), count*components*sizeof(T), &data[first*components]);
+	}
+
+	void GLMeshCache::updateSmooth(Mesh* m, Arrays& a, const std::vector<MeshJournal::Range>& vertices){
+		const MeshImpl& mi = *m->_constImpl();
+
+		foreach(const MeshJournal::Range& r, vertices){
+			unsigned int end = std::min<unsigned int>(r.end,mi.vert.size());
+			GLuint first = 0, last = 0;
+			bool any = false;
+			for(unsigned int i=r.begin;i<end;i++){
+				const VertexImpl& v = mi.vert[i];
+				if (v.IsD()) continue;
+				GLuint j = a.remap[i];
+				for(int k=0;k<3;k++){
+					a.positions[3*j+k] = v.cP()[k];
+					a.colours[4*j+k] = v.cC()[k];
+				}
+				a.colours[4*j+3] = v.cC()[3];
+				a.texcoords[2*j] = v.cT().U();
+				a.texcoords[2*j+1] = v.cT().V();
+
+				if (!any) first = j;
+				last = j;
+				any = true;
+			}
+
+			if (any and a.uploaded){
+				GLuint count = last - first + 1;
+				bufferSubData(a.buffers[0],a.positions,3,first,count);
+				bufferSubData(a.buffers[2],a.texcoords,2,first,count);
+				bufferSubData(a.buffers[3],a.colours,4,first,count);
+			}
+		}
+
+		// sync() also changes the normals of the vertices that share a face with a modified
+		// one, so only those are gathered. As in Mesh::syncVertices, if more than a quarter
+		// of the vertices were modified it is cheaper to gather them all.
+		unsigned int count = 0;
+		foreach(const MeshJournal::Range& r, vertices){
+			count += r.end - r.begin;
+		}
+		if (count*4 > mi.vert.size()){
+			for(unsigned int i=0;i<mi.vert.size();i++){
+				const VertexImpl& v = mi.vert[i];
+				if (v.IsD()) continue;
+				GLuint j = a.remap[i];
+				for(int k=0;k<3;k++){
+					a.normals[3*j+k] = v.cN()[k];
+				}
+			}
+			if (a.uploaded and !a.normals.empty()) bufferSubData(a.buffers[1],a.normals,3,0,a.numVertices());
+		}
+		else {
+			// the snapshot indices of the modified vertices and their one-rings
+			std::vector<GLuint> ring;
+			foreach(const MeshJournal::Range& r, vertices){
+				for(unsigned int i=r.begin;i<r.end and i<mi.vert.size();i++){
+					const VertexImpl& v = mi.vert[i];
+					if (v.IsD()) continue;
+					for(vcg::face::VFIterator<FaceImpl> vfi(const_cast<VertexImpl*>(&v));!vfi.End();++vfi){
+						for(int k=0;k<3;k++){
+							const VertexImpl* w = vfi.F()->cV(k);
+							const GLuint j = a.remap[w - &mi.vert[0]];
+							for(int c=0;c<3;c++) a.normals[3*j+c] = w->cN()[c];
+							ring.push_back(j);
+						}
+					}
+				}
+			}
+			std::sort(ring.begin(),ring.end());
+			ring.erase(std::unique(ring.begin(),ring.end()),ring.end());
+
+			// upload runs of nearby vertices together (the ones in between are unchanged)
+			if (a.uploaded){
+				const GLuint GAP = 64;
+				unsigned int n = 0;
+				while (n<ring.size()){
+					unsigned int e = n+1;
+					while (e<ring.size() and ring[e]-ring[e-1]<=GAP) e++;
+					bufferSubData(a.buffers[1],a.normals,3,ring[n],ring[e-1]-ring[n]+1);
+					n = e;
+				}
+			}
+		}
+		if (a.uploaded) glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		a.version = m->getVersion();
+	}
+
+	void GLMeshCache::buildFlat(Mesh* m, Arrays& a){
+		const MeshImpl& mi = *m->_constImpl();
+
+		a.clear();
+
+		a.positions.reserve(9*mi.fn);
+		a.normals.reserve(9*mi.fn);
+		a.texcoords.reserve(6*mi.fn);
+		a.colours.reserve(12*mi.fn);
+
+		for(unsigned int i=0;i<mi.face.size();i++){
+			const FaceImpl& f = mi.face[i];
+			if (f.IsD()) continue;
+			for(int c=0;c<3;c++){
+				const VertexImpl& v = *f.cV(c);
+				for(int k=0;k<3;k++){
+					a.positions.push_back(v.cP()[k]);
+					a.normals.push_back(f.cN()[k]);
+					a.colours.push_back(v.cC()[k]);
+				}
+				a.colours.push_back(v.cC()[3]);
+				a.texcoords.push_back(v.cT().U());
+				a.texcoords.push_back(v.cT().V());
+			}
+		}
+
+		a.indexed = false;
+		a.version = m->getVersion();
+		a.topologyVersion = m->getTopologyVersion();
+		a.built = true;
+	}
+
+	bool GLMeshCache::canUseVBOs(){
+		return sUseVBOs and GLEW_VERSION_1_5;
+	}
+
+	void GLMeshCache::upload(Arrays& a){
+		if (!canUseVBOs()){
+			a.uploaded = false;
+			return;
+		}
+
+		if (a.buffers[0]==0){
+			glGenBuffers(5,a.buffers);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, a.buffers[0]);
+		glBufferData(GL_ARRAY_BUFFER, a.positions.size()*sizeof(GLfloat), a.positions.empty()?NULL:&a.positions[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, a.buffers[1]);
+		glBufferData(GL_ARRAY_BUFFER, a.normals.size()*sizeof(GLfloat), a.normals.empty()?NULL:&a.normals[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, a.buffers[2]);
+		glBufferData(GL_ARRAY_BUFFER, a.texcoords.size()*sizeof(GLfloat), a.texcoords.empty()?NULL:&a.texcoords[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, a.buffers[3]);
+		glBufferData(GL_ARRAY_BUFFER, a.colours.size()*sizeof(GLubyte), a.colours.empty()?NULL:&a.colours[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, a.buffers[4]);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, a.indices.size()*sizeof(GLuint), a.indices.empty()?NULL:&a.indices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		a.uploaded = true;
+	}
+
+	/// With vbos the array pointers are offsets into the bound buffer
+	static const GLvoid* arrayPointer(GLMeshCache::Arrays& a, int buffer, const GLvoid* data){
+		if (a.uploaded){
+			glBindBuffer(GL_ARRAY_BUFFER, a.buffers[buffer]);
+			return NULL;
+		}
+		return data;
+	}
+
+	void GLMeshCache::draw(Arrays& a, GLenum mode, bool useColours, bool useTexcoords, bool useIndices){
+		if (a.positions.empty()) return;
+		bool indexed = useIndices and a.indexed;
+		if (indexed and a.indices.empty()) return; // no faces
+
+		glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(3, GL_FLOAT, 0, arrayPointer(a,0,&a.positions[0]));
+
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_FLOAT, 0, arrayPointer(a,1,&a.normals[0]));
+
+		if (useTexcoords){
+			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+			glTexCoordPointer(2, GL_FLOAT, 0, arrayPointer(a,2,&a.texcoords[0]));
+		}
+
+		if (useColours){
+			glEnableClientState(GL_COLOR_ARRAY);
+			glColorPointer(4, GL_UNSIGNED_BYTE, 0, arrayPointer(a,3,&a.colours[0]));
+		}
+
+		if (indexed){
+			if (a.uploaded){
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, a.buffers[4]);
+				glDrawElements(mode, a.indices.size(), GL_UNSIGNED_INT, NULL);
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			}
+			else {
+				glDrawElements(mode, a.indices.size(), GL_UNSIGNED_INT, &a.indices[0]);
+			}
+		}
+		else {
+			glDrawArrays(mode, 0, a.numVertices());
+		}
+
+		if (a.uploaded) glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glPopClientAttrib();
+	}
+
+	void GLMeshCache::deleteBuffers(Arrays& a){
+		if (a.buffers[0]!=0 and glIsBuffer(a.buffers[0])){
+			glDeleteBuffers(5,a.buffers);
+		}
+		for(int i=0;i<5;i++) a.buffers[i] = 0;
+		a.uploaded = false;
+	}
+
+	void GLMeshCache::release(unsigned int meshId){
+		boost::detail::lightweight_mutex::scoped_lock lock(sMutex);
+		if (sEntries.find(meshId)!=sEntries.end())
+			sReleased.push_back(meshId);
+	}
+
+	void GLMeshCache::collect(){
+		boost::detail::lightweight_mutex::scoped_lock lock(sMutex);
+		foreach(unsigned int id, sReleased){
+			std::map<unsigned int, Entry>::iterator it = sEntries.find(id);
+			if (it==sEntries.end()) continue;
+			deleteBuffers(it->second.smooth);
+			deleteBuffers(it->second.flat);
+			sEntries.erase(it);
+		}
+		sReleased.clear();
+	}
+
+	void GLMeshCache::clear(){
+		boost::detail::lightweight_mutex::scoped_lock lock(sMutex);
+		for(std::map<unsigned int, Entry>::iterator it=sEntries.begin();it!=sEntries.end();++it){
+			deleteBuffers(it->second.smooth);
+			deleteBuffers(it->second.flat);
+		}
+		sEntries.clear();
+		sReleased.clear();
+	}
+}
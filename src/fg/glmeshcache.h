@@ -0,0 +1,127 @@
+/**
+ * \file
+ * \brief Per-mesh vertex/index buffers that persist between frames
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_GLMESHCACHE_H
+#define FG_GLMESHCACHE_H
+
+#include <vector>
+#include <map>
+
+#include <GL/glew.h>
+
+#include "fg/meshjournal.h"
+#include "fg/meshsnapshot.h"
+
+namespace fg {
+	// forward decl
+	class Mesh;
+
+	/**
+	 * \brief Keeps the gl arrays for each rendered mesh alive between frames.
+	 *
+	 * Entries are keyed by Mesh::getId() and are only regathered when
+	 * Mesh::getVersion() differs from the version they were built from. If
+	 * the topology is unchanged the mesh's journal is used to update only the
+	 * vertices that changed.
+	 * If the driver supports vertex buffer objects the arrays are also
+	 * kept on the gpu, otherwise they are drawn as client-side arrays.
+	 *
+	 * When a mesh is destroyed it calls release(), which queues its entry
+	 * for deletion. The queue is flushed by the renderer (i.e., when a gl
+	 * context is current).
+	 */
+	class GLMeshCache {
+	public:
+		/**
+		 * \brief A set of gl arrays drawn together (either indexed or as a triangle soup)
+		 *
+		 * The smooth arrays are a MeshSnapshot, the flat arrays reuse its
+		 * layout but have no indices (and no remap).
+		 */
+		struct Arrays: public MeshSnapshot {
+			Arrays();
+
+			GLuint buffers[5]; ///< vbos for the above (0 if not uploaded)
+			bool indexed; ///< false for a triangle soup
+			bool uploaded;
+			bool built;
+		};
+
+		/**
+		 * \brief Per-mesh entry
+		 *
+		 * smooth shares vertices between faces and is drawn indexed,
+		 * flat duplicates vertices per face (with the face normal) and is
+		 * only built if a flat render is requested.
+		 */
+		struct Entry {
+			Arrays smooth;
+			Arrays flat;
+		};
+
+		/// \brief Retrieve the up-to-date smooth (indexed) arrays for m
+		static Arrays& smooth(Mesh* m);
+
+		/// \brief Retrieve the up-to-date flat (per-face) arrays for m
+		static Arrays& flat(Mesh* m);
+
+		/**
+		 * \brief Draw the arrays
+		 *
+		 * @param mode The gl primitive type (e.g., GL_TRIANGLES)
+		 * @param useColours Enable the per-vertex colour array
+		 * @param useTexcoords Enable the per-vertex texcoord array
+		 * @param useIndices If false the vertices are drawn in order (e.g., for GL_POINTS)
+		 */
+		static void draw(Arrays& a, GLenum mode, bool useColours, bool useTexcoords, bool useIndices = true);
+
+		/// \brief Queue the entry for meshId for deletion. Safe to call without a gl context, and from any thread.
+		static void release(unsigned int meshId);
+
+		/// \brief Delete any queued entries. Requires a current gl context.
+		static void collect();
+
+		/// \brief Delete all the entries. Requires a current gl context.
+		static void clear();
+
+		/// \brief Enable/disable vbos (by default they are used if available)
+		static void setUseVBOs(bool use){sUseVBOs = use;}
+
+	private:
+		static Entry& entry(Mesh* m);
+		static void buildSmooth(Mesh* m, Arrays& a);
+		static void buildFlat(Mesh* m, Arrays& a);
+		static void updateSmooth(Mesh* m, Arrays& a, const std::vector<MeshJournal::Range>& vertices);
+		static void upload(Arrays& a);
+		static void deleteBuffers(Arrays& a);
+		static bool canUseVBOs();
+
+		static std::map<unsigned int, Entry> sEntries;
+		static std::vector<unsigned int> sReleased;
+		static bool sUseVBOs;
+	};
+}
+
+#endif
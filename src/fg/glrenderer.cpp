@@ -31,6 +31,7 @@
 #include "fg/glrenderer_vcg.h" // modified <wrap/gl/trimesh.h>
 
 #include "fg/meshimpl.h"
+#include "fg/glmeshcache.h"
 #include "fg/mat4.h"
 #include "fg/ppm.h"
 #include "fg/gc/interpolator.h"
@@ -60,9 +61,53 @@ namespace fg {
 	std::string GLRenderer::sTexturePath = "../assets/UV.ppm";
 
 	void GLRenderer::renderMesh(Mesh* m, RenderMeshMode rmm, ColourMode cm){
+		// free the buffers of any meshes destroyed since the last render
+		GLMeshCache::collect();
+
+		if (cm==COLOUR_FACE_MANIFOLD){
+			// per-face colour depends on the topology, so use the immediate mode path
+			renderMeshImmediate(m,rmm,cm);
+			return;
+		}
+
+		bool colours = (cm==COLOUR_VERTEX);
+		switch (rmm){
+			case RENDER_FLAT: {
+				GLMeshCache::draw(GLMeshCache::flat(m), GL_TRIANGLES, colours, false);
+				break;
+			}
+			case RENDER_SMOOTH: {
+				GLMeshCache::draw(GLMeshCache::smooth(m), GL_TRIANGLES, colours, false);
+				break;
+			}
+			case RENDER_WIRE: {
+				glPushAttrib(GL_POLYGON_BIT);
+				glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+				GLMeshCache::draw(GLMeshCache::smooth(m), GL_TRIANGLES, colours, false);
+				glPopAttrib();
+				break;
+			}
+			case RENDER_VERTICES: {
+				GLMeshCache::draw(GLMeshCache::smooth(m), GL_POINTS, true, false, false);
+				break;
+			}
+			case RENDER_TEXTURED: {
+				glPushAttrib(GL_TEXTURE_BIT);
+				glEnable(GL_TEXTURE_2D);
+				glBindTexture(GL_TEXTURE_2D, texture());
+				GLMeshCache::draw(GLMeshCache::smooth(m), GL_TRIANGLES, colours, true);
+				glPopAttrib();
+				break;
+			}
+			default: {}
+		}
+	}
+
+	void GLRenderer::renderMeshImmediate(Mesh* m, RenderMeshMode rmm, ColourMode cm){
 		// vcg::GlTrimesh<fg::MeshImpl> tm;
 		MyGLRenderer tm;
-		tm.m = m->_impl();
+		// drawing only reads the mesh, so don't detach a shared one
+		tm.m = const_cast<MeshImpl*>(m->_constImpl());
 		tm.Update();
 
 		switch (rmm){
@@ -86,28 +131,11 @@ namespace fg {
 				break;
 			}
 			case RENDER_TEXTURED: {
-				static bool isTexLoaded = false;
-				static GLuint tex = 0;
-
 				glPushAttrib(GL_TEXTURE_BIT);
 				glEnable(GL_TEXTURE_2D);
-
-				if (!isTexLoaded){
-					// make sure the texture is loaded...
-					Ppm ppm(sTexturePath.c_str()); // "../assets/UV.ppm");
-					if (not ppm.IsValid()){
-						throw(std::runtime_error(std::string("Can't load ") + sTexturePath));
-					}
-					else {
-						tex = ppm.GetGLTex();
-						isTexLoaded = true;
-					}
-
-				}
-				tm.TMId.push_back(tex);
+				tm.TMId.push_back(texture());
 				//tm.Draw<vcg::GLW::DMSmooth, colorMode,vcg::GLW::TMPerVert> ();
 				DrawWrapper<vcg::GLW::DMSmooth, vcg::GLW::TMPerVert>(tm,cm);
-
 				glPopAttrib();
 				break;
 			}
@@ -115,6 +143,28 @@ namespace fg {
 		}
 	}
 
+	GLuint GLRenderer::texture(){
+		static bool isTexLoaded = false;
+		static GLuint tex = 0;
+
+		if (!isTexLoaded){
+			// make sure the texture is loaded...
+			Ppm ppm(sTexturePath.c_str()); // "../assets/UV.ppm");
+			if (not ppm.IsValid()){
+				throw(std::runtime_error(std::string("Can't load ") + sTexturePath));
+			}
+			else {
+				tex = ppm.GetGLTex();
+				isTexLoaded = true;
+			}
+		}
+		return tex;
+	}
+
+	void GLRenderer::clearMeshCache(){
+		GLMeshCache::clear();
+	}
+
 	void GLRenderer::renderMesh(boost::shared_ptr<Mesh> m, RenderMeshMode rmm, ColourMode cm){
 		renderMesh(&*m,rmm,cm);
 	}
@@ -64,6 +64,12 @@ namespace fg {
 		static void renderMesh(boost::shared_ptr<Mesh> m, RenderMeshMode rmm = RENDER_FLAT, ColourMode cm = COLOUR_NONE);
 		static void renderMeshNode(boost::shared_ptr<MeshNode> m, RenderMeshMode rmm = RENDER_FLAT, ColourMode cm = COLOUR_NONE);
 
+		/**
+		 * Release the gl buffers of all cached meshes (see GLMeshCache).
+		 * Must be called while the gl context is current, e.g., before it is destroyed.
+		 */
+		static void clearMeshCache();
+
 		/**
 		 * Render an approximation of a curve interpolator
 		 *
@@ -93,6 +99,12 @@ namespace fg {
 
         static std::string sTexturePath;
 
+        /// the texture used by RENDER_TEXTURED, loaded on first use
+        static GLuint texture();
+
+        /// draw using vcg's immediate mode renderer (no caching)
+        static void renderMeshImmediate(Mesh* m, RenderMeshMode rmm, ColourMode cm);
+
         // shared GLUT helpers..
         static void fghCircleTable(double **sint,double **cost,const int n);
 	};
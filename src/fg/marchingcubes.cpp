@@ -0,0 +1,517 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/marchingcubes.h"
+#include "fg/field.h"
+#include "fg/meshimpl.h"
+#include "fg/parallel.h"
+
+#include <vcg/complex/allocate.h>
+#include <vcg/complex/algorithms/create/emc_lookup_table.h>
+
+#include <boost/cstdint.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <vector>
+
+namespace fg {
+	// The cube corners and edges follow Paul Bourke's numbering (as do the vcg tables):
+	// corners 0-3 are (0,0),(1,0),(1,1),(0,1) on the lower z slice and 4-7 are the same on the upper one.
+	// Edges 0-3 and 4-7 go around the lower and upper slices, 8-11 join corner i to i+4.
+	static const int CORNER_OFFSET[8][3] = {{0,0,0},{1,0,0},{1,1,0},{0,1,0},{0,0,1},{1,0,1},{1,1,1},{0,1,1}};
+	static const int EDGE_CORNERS[12][2] = {{0,1},{1,2},{3,2},{0,3},{4,5},{5,6},{7,6},{4,7},{0,4},{1,5},{2,6},{3,7}};
+	static const int EDGE_AXIS[12] = {0,1,0,1,0,1,0,1,2,2,2,2};
+
+	// The sparse mode works in cubes of BLOCK_SIZE^3 cells
+	static const int BLOCK_SIZE = 8;
+
+	/// n clamped to an int for Parallel::threadsFor, as the number of grid points can overflow one
+	static int loopSize(double n){
+		return n<INT_MAX?(int)n:INT_MAX;
+	}
+
+	/// A grid edge, identified by the grid point it starts at and its axis
+	struct MCEdgeKey {
+		boost::uint64_t point; ///< 64 bits, as there are more grid points than fit in 32 once the resolution is over 1625
+		int axis;
+
+		bool operator==(const MCEdgeKey& k) const {return point==k.point and axis==k.axis;}
+		bool operator<(const MCEdgeKey& k) const {return point<k.point or (point==k.point and axis<k.axis);}
+	};
+
+	/// A vertex on the boundary of a sparse block, which may be shared with a neighbouring block
+	struct MCSeam {
+		MCEdgeKey key;
+		int part;
+		int vertex;
+
+		bool operator<(const MCSeam& s) const {
+			if (!(key==s.key)) return key<s.key;
+			return part<s.part or (part==s.part and vertex<s.vertex);
+		}
+	};
+
+	/**
+	 * The output of one slab or block.
+	 */
+	struct MCPart {
+		std::vector<Vec3> vertices;
+		std::vector<int> triangles; ///< indices into vertices
+
+		// slabs: the vertex on the x/y edge starting at grid point (x,y) of the first/last slice (-1 if none)
+		std::vector<int> firstX, firstY, lastX, lastY;
+
+		// blocks: the vertices on the boundary of the block
+		std::vector<MCSeam> seams;
+	};
+
+	/**
+	 * Walks the cells of a box of the grid, layer by layer.
+	 */
+	class MCBuilder {
+	public:
+		MCBuilder(const Field& field, int resolution, const Vec3& min, const Vec3& max)
+		:mField(field)
+		,mRes(resolution)
+		,mMin(min)
+		,mStep((max-min)/(resolution-1))
+		,mOut(NULL)
+		{}
+
+		/**
+		 * Polygonise the cells [x0,x0+nx)*[y0,y0+ny)*[z0,z0+nz) into out.
+		 * If seams is set the vertices on the boundary of the box are recorded
+		 * in out.seams, otherwise those on the first and last slices are
+		 * recorded in out.firstX, etc.
+		 */
+		void build(MCPart& out, int x0, int y0, int z0, int nx, int ny, int nz, bool seams){
+			mOut = &out;
+			mX0 = x0; mY0 = y0; mZ0 = z0;
+			mNX = nx; mNY = ny; mNZ = nz;
+			mSeams = seams;
+			mStride = nx+1;
+
+			const int slice = (nx+1)*(ny+1);
+			mLower.resize(slice);
+			mUpper.resize(slice);
+			mXYZ.resize(3*slice);
+			mLowerX.assign(slice,-1);
+			mLowerY.assign(slice,-1);
+			mUpperX.resize(slice);
+			mUpperY.resize(slice);
+			mZ.resize(slice);
+
+			sample(z0,mLower);
+			for(int z=0;z<nz;z++){
+				sample(z0+z+1,mUpper);
+				std::fill(mUpperX.begin(),mUpperX.end(),-1);
+				std::fill(mUpperY.begin(),mUpperY.end(),-1);
+				std::fill(mZ.begin(),mZ.end(),-1);
+
+				for(int y=0;y<ny;y++){
+					for(int x=0;x<nx;x++){
+						cell(x,y,z);
+					}
+				}
+
+				// every vertex on the lower slice has now been made
+				if (z==0 and !seams){
+					out.firstX = mLowerX;
+					out.firstY = mLowerY;
+				}
+
+				std::swap(mLower,mUpper);
+				std::swap(mLowerX,mUpperX);
+				std::swap(mLowerY,mUpperY);
+			}
+
+			if (!seams){
+				out.lastX = mLowerX;
+				out.lastY = mLowerY;
+			}
+			mOut = NULL;
+		}
+
+	private:
+		void sample(int z, std::vector<float>& values){
+			const double pz = mMin.Z() + mStep.Z()*z;
+			int n = 0;
+			for(int y=mY0;y<=mY0+mNY;y++){
+				const double py = mMin.Y() + mStep.Y()*y;
+				for(int x=mX0;x<=mX0+mNX;x++){
+					mXYZ[n++] = mMin.X() + mStep.X()*x;
+					mXYZ[n++] = py;
+					mXYZ[n++] = pz;
+				}
+			}
+			mField.evalMany(&mXYZ[0],n/3,&values[0]);
+		}
+
+		Vec3 point(int x, int y, int z) const {
+			return Vec3(mMin.X()+mStep.X()*(mX0+x), mMin.Y()+mStep.Y()*(mY0+y), mMin.Z()+mStep.Z()*(mZ0+z));
+		}
+
+		/// Add the vertex on the edge starting at local grid point (x,y,z) between points a and b
+		int addVertex(int x, int y, int z, int axis, const Vec3& a, float va, const Vec3& b, float vb){
+			double d = vb - va;
+			double t = std::fabs(d)<1e-12?0.5:-va/d;
+			int id = mOut->vertices.size();
+			mOut->vertices.push_back(a + (b-a)*t);
+
+			if (mSeams){
+				// edges along an axis never leave the box along that axis
+				bool boundary =
+					(axis!=0 and (x==0 or x==mNX)) or
+					(axis!=1 and (y==0 or y==mNY)) or
+					(axis!=2 and (z==0 or z==mNZ));
+				if (boundary){
+					MCSeam s;
+					s.key.point = ((boost::uint64_t)(mZ0+z)*mRes + (mY0+y))*mRes + (mX0+x);
+					s.key.axis = axis;
+					s.part = 0;
+					s.vertex = id;
+					mOut->seams.push_back(s);
+				}
+			}
+			return id;
+		}
+
+		void cell(int x, int y, int z){
+			const int i = y*mStride + x;
+			const int c[4] = {i, i+1, i+1+mStride, i+mStride};
+			const float v[8] = {
+				mLower[c[0]],mLower[c[1]],mLower[c[2]],mLower[c[3]],
+				mUpper[c[0]],mUpper[c[1]],mUpper[c[2]],mUpper[c[3]]};
+
+			unsigned char cubetype = 0;
+			for(int k=0;k<8;k++){
+				if (v[k]<0) cubetype |= 1<<k;
+			}
+			const int edges = vcg::tri::EMCLookUpTable::EdgeTable(cubetype);
+			if (edges==0) return;
+
+			int e[12];
+			for(int k=0;k<12;k++){
+				if (!(edges&(1<<k))) continue;
+				const int a = EDGE_CORNERS[k][0], b = EDGE_CORNERS[k][1];
+				const int* o = CORNER_OFFSET[a];
+				const int j = c[a&3];
+				int& id = EDGE_AXIS[k]==2?mZ[j]:
+					EDGE_AXIS[k]==0?(o[2]?mUpperX[j]:mLowerX[j]):(o[2]?mUpperY[j]:mLowerY[j]);
+				if (id<0){
+					id = addVertex(x+o[0],y+o[1],z+o[2],EDGE_AXIS[k],
+						point(x+o[0],y+o[1],z+o[2]),v[a],
+						point(x+CORNER_OFFSET[b][0],y+CORNER_OFFSET[b][1],z+CORNER_OFFSET[b][2]),v[b]);
+				}
+				e[k] = id;
+			}
+
+			// the table's triangles face inwards for a field that is negative inside
+			const int* tris = vcg::tri::EMCLookUpTable::TriTable(cubetype,0);
+			for(int k=0;tris[k]!=-1;k+=3){
+				mOut->triangles.push_back(e[tris[k]]);
+				mOut->triangles.push_back(e[tris[k+2]]);
+				mOut->triangles.push_back(e[tris[k+1]]);
+			}
+		}
+
+		const Field& mField;
+		int mRes;
+		Vec3 mMin, mStep;
+
+		// the current box
+		MCPart* mOut;
+		int mX0, mY0, mZ0, mNX, mNY, mNZ, mStride;
+		bool mSeams;
+
+		// samples of the slices below and above the current layer
+		std::vector<float> mLower, mUpper;
+		std::vector<double> mXYZ;
+
+		// vertex indices on the x and y edges of the lower and upper slices, and on the z edges in between
+		std::vector<int> mLowerX, mLowerY, mUpperX, mUpperY, mZ;
+	};
+
+	/// Copy the parts into m, where remap[p][i] is the mesh index of vertex i of part p
+	static void writeMesh(const std::vector<MCPart>& parts, const std::vector<std::vector<int> >& remap, int numVertices, MeshImpl& m){
+		int numFaces = 0;
+		for(unsigned int p=0;p<parts.size();p++){
+			numFaces += parts[p].triangles.size()/3;
+		}
+
+		vcg::tri::Allocator<MeshImpl>::AddVertices(m,numVertices);
+		vcg::tri::Allocator<MeshImpl>::AddFaces(m,numFaces);
+
+		int f = 0;
+		for(unsigned int p=0;p<parts.size();p++){
+			const MCPart& part = parts[p];
+			const std::vector<int>& r = remap[p];
+			for(unsigned int i=0;i<part.vertices.size();i++){
+				m.vert[r[i]].P() = part.vertices[i];
+			}
+			for(unsigned int i=0;i<part.triangles.size();i+=3,f++){
+				for(int k=0;k<3;k++){
+					m.face[f].V(k) = &m.vert[r[part.triangles[i+k]]];
+				}
+			}
+		}
+	}
+
+	void MarchingCubes::build(const Field& field, int resolution, const Vec3& min, const Vec3& max, MeshImpl& m){
+		if (resolution<2) return;
+		const int layers = resolution-1;
+
+		// fields that aren't thread-safe (e.g., lua fields, which may also throw) are run on this thread
+		int threads = field.isThreadSafe()?Parallel::threadsFor(loopSize((double)resolution*resolution*resolution)):1;
+		const int numSlabs = std::min(threads>1?4*threads:1,layers);
+		std::vector<MCPart> slabs(numSlabs);
+
+		if (threads>1){
+			#pragma omp parallel for num_threads(threads) schedule(dynamic)
+			for(int s=0;s<numSlabs;s++){
+				const int z0 = layers*s/numSlabs, z1 = layers*(s+1)/numSlabs;
+				MCBuilder(field,resolution,min,max).build(slabs[s],0,0,z0,layers,layers,z1-z0,false);
+			}
+		}
+		else {
+			MCBuilder(field,resolution,min,max).build(slabs[0],0,0,0,layers,layers,layers,false);
+		}
+
+		// Stitch the slabs together. A slab's first slice is the previous slab's
+		// last, and both made the same vertices there, so map the later ones onto
+		// the earlier ones.
+		std::vector<std::vector<int> > remap(numSlabs);
+		int numVertices = 0;
+		for(int s=0;s<numSlabs;s++){
+			const MCPart& slab = slabs[s];
+			std::vector<int>& r = remap[s];
+			r.assign(slab.vertices.size(),-1);
+			if (s>0){
+				const MCPart& prev = slabs[s-1];
+				const std::vector<int>& pr = remap[s-1];
+				for(unsigned int i=0;i<slab.firstX.size();i++){
+					if (slab.firstX[i]>=0) r[slab.firstX[i]] = pr[prev.lastX[i]];
+					if (slab.firstY[i]>=0) r[slab.firstY[i]] = pr[prev.lastY[i]];
+				}
+			}
+			for(unsigned int i=0;i<r.size();i++){
+				if (r[i]<0) r[i] = numVertices++;
+			}
+		}
+
+		writeMesh(slabs,remap,numVertices,m);
+	}
+
+	/// A cube of blocks, in block coordinates
+	struct MCRegion {
+		MCRegion(int x_ = 0, int y_ = 0, int z_ = 0, int size_ = 1):x(x_),y(y_),z(z_),size(size_){}
+		int x, y, z, size;
+	};
+
+	/**
+	 * Find the blocks that may contain the surface using an octree: a region
+	 * can only contain a zero if |f(centre)| <= lipschitz * (half its diagonal).
+	 * Each level of the tree is evaluated with one evalMany call.
+	 */
+	static void findBlocksLipschitz(const Field& field, int resolution, const Vec3& min, const Vec3& step, double lipschitz, std::vector<MCRegion>& blocks){
+		const int cells = resolution-1;
+		const int numBlocks = (cells+BLOCK_SIZE-1)/BLOCK_SIZE;
+		int size = 1;
+		while (size<numBlocks) size *= 2;
+
+		std::vector<MCRegion> level(1,MCRegion(0,0,0,size)), next;
+		std::vector<double> xyz;
+		std::vector<double> radii;
+		std::vector<float> values;
+		while (!level.empty()){
+			xyz.clear();
+			radii.clear();
+			for(unsigned int i=0;i<level.size();i++){
+				const MCRegion& r = level[i];
+				double lo[3] = {(double)(r.x*BLOCK_SIZE), (double)(r.y*BLOCK_SIZE), (double)(r.z*BLOCK_SIZE)};
+				double hi[3] = {
+					(double)std::min((r.x+r.size)*BLOCK_SIZE,cells),
+					(double)std::min((r.y+r.size)*BLOCK_SIZE,cells),
+					(double)std::min((r.z+r.size)*BLOCK_SIZE,cells)};
+				xyz.push_back(min.X() + step.X()*(lo[0]+hi[0])/2);
+				xyz.push_back(min.Y() + step.Y()*(lo[1]+hi[1])/2);
+				xyz.push_back(min.Z() + step.Z()*(lo[2]+hi[2])/2);
+				radii.push_back(Vec3(step.X()*(hi[0]-lo[0]), step.Y()*(hi[1]-lo[1]), step.Z()*(hi[2]-lo[2])).Norm()/2);
+			}
+			values.resize(level.size());
+			field.evalMany(&xyz[0],level.size(),&values[0]);
+
+			next.clear();
+			for(unsigned int i=0;i<level.size();i++){
+				if (std::fabs(values[i]) > lipschitz*radii[i]*1.0001) continue;
+				const MCRegion& r = level[i];
+				if (r.size==1){
+					blocks.push_back(r);
+					continue;
+				}
+				const int h = r.size/2;
+				for(int k=0;k<8;k++){
+					MCRegion c(r.x+(k&1)*h, r.y+((k>>1)&1)*h, r.z+((k>>2)&1)*h, h);
+					if (c.x<numBlocks and c.y<numBlocks and c.z<numBlocks) next.push_back(c);
+				}
+			}
+			level.swap(next);
+		}
+	}
+
+	/**
+	 * Find the blocks that may contain the surface by sampling the block
+	 * corners: a block is kept if the signs at its corners differ, and so are
+	 * its neighbours, to catch features that poke through a side of a block
+	 * without enclosing a corner.
+	 */
+	static void findBlocksCoarse(const Field& field, int resolution, const Vec3& min, const Vec3& step, std::vector<MCRegion>& blocks){
+		const int cells = resolution-1;
+		const int nb = (cells+BLOCK_SIZE-1)/BLOCK_SIZE;
+		const int nc = nb+1;
+
+		// signs at the block corners, a slice at a time
+		std::vector<unsigned char> inside(nc*nc*nc);
+		std::vector<double> xyz(3*nc*nc);
+		std::vector<float> values(nc*nc);
+		for(int z=0;z<nc;z++){
+			int n = 0;
+			for(int y=0;y<nc;y++){
+				for(int x=0;x<nc;x++){
+					xyz[n++] = min.X() + step.X()*std::min(x*BLOCK_SIZE,cells);
+					xyz[n++] = min.Y() + step.Y()*std::min(y*BLOCK_SIZE,cells);
+					xyz[n++] = min.Z() + step.Z()*std::min(z*BLOCK_SIZE,cells);
+				}
+			}
+			field.evalMany(&xyz[0],nc*nc,&values[0]);
+			for(int i=0;i<nc*nc;i++){
+				inside[z*nc*nc+i] = values[i]<0;
+			}
+		}
+
+		std::vector<unsigned char> active(nb*nb*nb,0);
+		for(int z=0;z<nb;z++){
+			for(int y=0;y<nb;y++){
+				for(int x=0;x<nb;x++){
+					int count = 0;
+					for(int k=0;k<8;k++){
+						count += inside[((z+CORNER_OFFSET[k][2])*nc + y+CORNER_OFFSET[k][1])*nc + x+CORNER_OFFSET[k][0]];
+					}
+					if (count==0 or count==8) continue;
+					for(int dz=std::max(z-1,0);dz<=std::min(z+1,nb-1);dz++){
+						for(int dy=std::max(y-1,0);dy<=std::min(y+1,nb-1);dy++){
+							for(int dx=std::max(x-1,0);dx<=std::min(x+1,nb-1);dx++){
+								active[(dz*nb+dy)*nb+dx] = 1;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		for(int z=0;z<nb;z++){
+			for(int y=0;y<nb;y++){
+				for(int x=0;x<nb;x++){
+					if (active[(z*nb+y)*nb+x]) blocks.push_back(MCRegion(x,y,z));
+				}
+			}
+		}
+	}
+
+	static void buildBlock(const Field& field, int resolution, const Vec3& min, const Vec3& max, const MCRegion& block, int index, MCPart& part){
+		const int cells = resolution-1;
+		const int x0 = block.x*BLOCK_SIZE, y0 = block.y*BLOCK_SIZE, z0 = block.z*BLOCK_SIZE;
+		MCBuilder(field,resolution,min,max).build(part,x0,y0,z0,
+			std::min(BLOCK_SIZE,cells-x0),std::min(BLOCK_SIZE,cells-y0),std::min(BLOCK_SIZE,cells-z0),true);
+		for(unsigned int i=0;i<part.seams.size();i++){
+			part.seams[i].part = index;
+		}
+	}
+
+	void MarchingCubes::buildSparse(const Field& field, int resolution, const Vec3& min, const Vec3& max, MeshImpl& m, double lipschitz){
+		if (resolution<2) return;
+		const int cells = resolution-1;
+		const Vec3 step = (max-min)/cells;
+
+		std::vector<MCRegion> blocks;
+		if (lipschitz>0) findBlocksLipschitz(field,resolution,min,step,lipschitz,blocks);
+		else findBlocksCoarse(field,resolution,min,step,blocks);
+
+		const int numBlocks = blocks.size();
+		std::vector<MCPart> parts(numBlocks);
+		const int threads = field.isThreadSafe()?Parallel::threadsFor(loopSize((double)numBlocks*BLOCK_SIZE*BLOCK_SIZE*BLOCK_SIZE)):1;
+
+		if (threads>1){
+			#pragma omp parallel for num_threads(threads) schedule(dynamic)
+			for(int b=0;b<numBlocks;b++){
+				buildBlock(field,resolution,min,max,blocks[b],b,parts[b]);
+			}
+		}
+		else {
+			for(int b=0;b<numBlocks;b++){
+				buildBlock(field,resolution,min,max,blocks[b],b,parts[b]);
+			}
+		}
+
+		// Weld the vertices on the block boundaries. Sorting puts copies of
+		// the same grid edge next to each other, the first (lowest block) is kept.
+		std::vector<MCSeam> seams;
+		std::vector<int> offsets(numBlocks+1,0);
+		for(int b=0;b<numBlocks;b++){
+			seams.insert(seams.end(),parts[b].seams.begin(),parts[b].seams.end());
+			offsets[b+1] = offsets[b] + parts[b].vertices.size();
+			std::vector<MCSeam>().swap(parts[b].seams);
+		}
+		std::sort(seams.begin(),seams.end());
+
+		// weld[i] is the (flat) index of the vertex that vertex i is a copy of
+		std::vector<int> weld(offsets[numBlocks],-1);
+		unsigned int first = 0;
+		for(unsigned int i=1;i<seams.size();i++){
+			if (seams[i].key==seams[first].key){
+				weld[offsets[seams[i].part]+seams[i].vertex] = offsets[seams[first].part]+seams[first].vertex;
+			}
+			else {
+				first = i;
+			}
+		}
+
+		std::vector<std::vector<int> > remap(numBlocks);
+		std::vector<int> flat(offsets[numBlocks]);
+		int numVertices = 0;
+		for(int b=0;b<numBlocks;b++){
+			std::vector<int>& r = remap[b];
+			r.resize(parts[b].vertices.size());
+			for(unsigned int i=0;i<r.size();i++){
+				const int j = offsets[b]+i;
+				flat[j] = weld[j]<0?numVertices++:flat[weld[j]];
+				r[i] = flat[j];
+			}
+		}
+
+		writeMesh(parts,remap,numVertices,m);
+	}
+}
@@ -0,0 +1,81 @@
+/**
+ * \file
+ * \brief Parallel marching cubes
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_MARCHINGCUBES_H
+#define FG_MARCHINGCUBES_H
+
+#include "fg/vec3.h"
+
+namespace fg {
+	// forward decl
+	class Field;
+	class MeshImpl;
+
+	/**
+	 * \brief Extracts the zero iso-surface of a Field on a regular grid.
+	 *
+	 * The grid is split into slabs along z which are polygonised concurrently
+	 * (if the field is thread-safe, see fg::Parallel). A slab walks up through
+	 * its cells one layer at a time and only keeps the two slices of samples
+	 * bounding the current layer, so memory grows with resolution^2 rather
+	 * than resolution^3.
+	 *
+	 * Vertices are shared between cells within a slab via per-slice edge
+	 * tables. Neighbouring slabs both create the vertices on the slice they
+	 * share, the duplicates are welded by index when the slabs are stitched
+	 * together (no hashing).
+	 */
+	class MarchingCubes {
+	public:
+		/**
+		 * \brief Polygonise field = 0 into m
+		 *
+		 * @param resolution The number of samples along each axis (>=2)
+		 * @param min,max The corners of the sampled box
+		 * @param m An empty mesh. Only the vertices and faces are set, the topology isn't computed.
+		 */
+		static void build(const Field& field, int resolution, const Vec3& min, const Vec3& max, MeshImpl& m);
+
+		/**
+		 * \brief Polygonise field = 0 into m, only visiting the grid near the surface.
+		 *
+		 * The grid is divided into blocks of 8^3 cells and only the blocks that
+		 * may contain the surface are sampled and polygonised, so the work and
+		 * memory are roughly proportional to the surface area.
+		 *
+		 * If lipschitz > 0 it must bound how fast the field changes
+		 * (|f(a)-f(b)| <= lipschitz*|a-b|, e.g., 1 for a signed distance) and
+		 * the blocks are found with an octree that only culls regions which
+		 * can't contain the surface. Otherwise a block is kept if the field
+		 * changes sign between its corners or those of its neighbours, which
+		 * can miss features that are smaller than a block.
+		 *
+		 * The result is the same as build() wherever a block isn't culled.
+		 */
+		static void buildSparse(const Field& field, int resolution, const Vec3& min, const Vec3& max, MeshImpl& m, double lipschitz = 0);
+	};
+}
+
+#endif
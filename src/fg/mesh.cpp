@@ -27,6 +27,14 @@
 #include "fg/meshimpl.h"
 #include "fg/functions.h"
 #include "fg/util.h"
+#include "fg/glmeshcache.h"
+#include "fg/parallel.h"
+#include "fg/field.h"
+#include "fg/marchingcubes.h"
+#include "fg/meshloader.h"
+#include "fg/subdivider.h"
+#include "fg/refine.h"
+#include "fg/remesh.h"
 
 // luabind
 #include <luabind/function.hpp>
@@ -46,9 +54,6 @@
 #include <vcg/complex/algorithms/smooth.h>
 #include <vcg/complex/algorithms/refine.h>
 
-#include <vcg/complex/algorithms/create/marching_cubes.h>
-#include <vcg/complex/algorithms/create/extended_marching_cubes.h>
-#include <vcg/complex/algorithms/create/mc_trivial_walker.h>
 #include <vcg/complex/algorithms/create/platonic.h>
 
 #include <vcg/complex/algorithms/update/bounding.h>
@@ -68,21 +73,37 @@
 
 #include <boost/foreach.hpp>
 
+#include <algorithm>
+
 using namespace vcg;
 
 namespace fg {
 
+	boost::detail::atomic_count Mesh::sNextId(0);
 
 	Mesh::Mesh()
-	:mpMesh(NULL)
-	,mVertexProxyList()
-	,mFaceProxyList()
+	:mSharedImpl(new MeshImpl())
+	,mpMesh(mSharedImpl.get())
+	,mId(++sNextId - 1)
+	,mVersion(0)
+	,mGeometryVersion(0)
+	,mTopologyVersion(0)
+	,mTopologyId(mId)
+	,mJournal()
+	,mIncrementalSync(true)
+	,mSynced(false)
+	,mSyncedVersion(0)
+	,mSyncedTopologyVersion(0)
+	,mAutoCompact(0)
+	,mVertexHandles(&mpMesh->vert)
+	,mFaceHandles(&mpMesh->face)
 	{
-		mpMesh = new MeshImpl();
+		mJournal.setEnabled(mIncrementalSync);
 	}
 
 	Mesh::~Mesh(){
-		delete mpMesh;
+		// any gpu buffers are freed the next time the renderer runs
+		GLMeshCache::release(mId);
 	}
 
 	/*
@@ -97,9 +118,6 @@ namespace fg {
 			// only return non-dead vertices
 			if (!v.IsD()){
 				r->push_back(_newSP(&v));
-				//boost::shared_ptr<VertexProxy> pvp(new VertexProxy(this, &v));
-				//r->push_back(pvp);
-				//mVertexProxyList.add(pvp);
 			}
 		}
 		return r;
@@ -126,18 +144,45 @@ namespace fg {
 	}
 
 	void Mesh::getBounds(double& minx, double& miny, double& minz, double& maxx, double& maxy, double& maxz){
-		vcg::tri::UpdateBounding<MeshImpl>::Box(*mpMesh);
-		minx = mpMesh->bbox.min.X();
-		miny = mpMesh->bbox.min.Y();
-		minz = mpMesh->bbox.min.Z();
-		maxx = mpMesh->bbox.max.X();
-		maxy = mpMesh->bbox.max.Y();
-		maxz = mpMesh->bbox.max.Z();
+		// the box is kept local rather than stored in mpMesh->bbox, as the storage may be shared
+		const int nv = mpMesh->vert.size();
+		const int threads = Parallel::threadsFor(nv);
+		vcg::Box3d bbox;
+		if (threads<=1){
+			for(int i=0;i<nv;i++){
+				const VertexImpl& v = mpMesh->vert[i];
+				if (!v.IsD()) bbox.Add(v.cP());
+			}
+		}
+		else {
+			// each thread bounds a slice of the vertices, then the boxes are combined
+			// (min and max are exact so this gives the same box as the serial version)
+			std::vector<vcg::Box3d> boxes(threads);
+			#pragma omp parallel num_threads(threads)
+			{
+				vcg::Box3d& box = boxes[Parallel::threadIndex()];
+				#pragma omp for schedule(static)
+				for(int i=0;i<nv;i++){
+					const VertexImpl& v = mpMesh->vert[i];
+					if (!v.IsD()) box.Add(v.cP());
+				}
+			}
+			foreach(const vcg::Box3d& box, boxes){
+				bbox.Add(box);
+			}
+		}
+		minx = bbox.min.X();
+		miny = bbox.min.Y();
+		minz = bbox.min.Z();
+		maxx = bbox.max.X();
+		maxy = bbox.max.Y();
+		maxz = bbox.max.Z();
 	}
 
 	// Modifiers
 	void Mesh::subdivide(int levels){
 		if (levels <= 0) return;
+		_detach();
 
 		// TODO
 
@@ -154,29 +199,114 @@ namespace fg {
 		vcg::tri::UpdateTopology<MeshImpl>::VertexFace(*mpMesh);
 		vcg::tri::UpdateTopology<MeshImpl>::FaceFace(*mpMesh);
 
+		_touchTopology();
 		sync();
 	}
 
 	void Mesh::smoothSubdivide(int levels){
+		Subdivider s(Subdivider::BUTTERFLY);
+		stencilSubdivide(s,levels);
+	}
+
+	void Mesh::loopSubdivide(int levels){
+		Subdivider s(Subdivider::LOOP);
+		stencilSubdivide(s,levels);
+	}
+
+	void Mesh::stencilSubdivide(Subdivider& s, int levels){
 		if (levels <= 0) return;
+		_detach();
 
-		// TODO
+		MeshImpl refined;
+		std::vector<unsigned int> newFaceIndex;
+		s.subdivide(*mpMesh,levels,refined,&newFaceIndex);
 
-		vcg::tri::UpdateTopology<MeshImpl>::FaceFace(*mpMesh);
-		vcg::tri::UpdateTopology<MeshImpl>::VertexFace(*mpMesh);
+		// swapping the containers keeps the elements (and the pointers between them) where they are.
+		// the original vertices keep their indices, the faces move to one of their children
+		mpMesh->vert.swap(refined.vert);
+		mpMesh->face.swap(refined.face);
+		mpMesh->vn = refined.vn;
+		mpMesh->fn = refined.fn;
+		mFaceHandles.remap(newFaceIndex);
 
-		// vcg::face::IsManifold<MeshImpl>;
-		// vcg::face::IsBorder<MeshImpl>;
-		// vcg::face::IsManifold<MeshImpl::FaceType>(mMesh.face[0], 0);
+		_touchTopology();
+		sync();
+	}
 
-		for(int i=0;i<levels;i++){
-			vcg::Refine(*mpMesh,vcg::MidPointButterfly<MeshImpl>());
-			//vcg::Refine(*mpMesh,vcg::MidPoint<MeshImpl>(mpMesh));
+	void Mesh::subdivideFaces(const FaceSet& faces, int levels){
+		if (levels <= 0 or faces.empty()) return;
+		_detach();
+		MeshImpl& m = *mpMesh;
+
+		std::vector<unsigned int> indices;
+		BOOST_FOREACH(const shared_ptr<FaceProxy>& f, faces){
+			const FaceImpl* p = f->pImpl();
+			if (p!=NULL and p>=&m.face.front() and p<=&m.face.back()) indices.push_back(p - &m.face[0]);
 		}
+		refineFaces(m,indices,levels);
 
-		vcg::tri::UpdateTopology<MeshImpl>::VertexFace(*mpMesh);
-		vcg::tri::UpdateTopology<MeshImpl>::FaceFace(*mpMesh);
+		_touchTopology();
+		sync();
+	}
+
+	void Mesh::subdivideVertices(const VertexSet& vertices, int levels){
+		if (levels <= 0 or vertices.empty()) return;
+		_detach();
+		MeshImpl& m = *mpMesh;
 
+		std::vector<unsigned int> indices;
+		BOOST_FOREACH(const shared_ptr<VertexProxy>& v, vertices){
+			VertexImpl* p = v->pImpl();
+			if (p==NULL or p<&m.vert.front() or p>&m.vert.back()) continue;
+			for(vcg::face::VFIterator<FaceImpl> vfi(p);!vfi.End();++vfi){
+				indices.push_back(vfi.F() - &m.face[0]);
+			}
+		}
+		refineFaces(m,indices,levels);
+
+		_touchTopology();
+		sync();
+	}
+
+	int Mesh::adaptiveSubdivide(double maxEdgeLength, double maxError, int maxFaces){
+		sync(); // the curvature error needs the vertex normals
+		_detach();
+		int added = refineAdaptive(*mpMesh,maxEdgeLength,maxError,maxFaces);
+		if (added>0){
+			_touchTopology();
+			sync();
+		}
+		return added;
+	}
+
+	void Mesh::remesh(double targetLength, int iterations){
+		if (targetLength<=0 or iterations<=0) return;
+		_detach();
+		MeshImpl& m = *mpMesh;
+
+		std::vector<unsigned int> indices;
+		for(unsigned int i=0;i<m.face.size();i++){
+			if (!m.face[i].IsD()) indices.push_back(i);
+		}
+		fg::remesh(m,indices,targetLength,iterations);
+
+		_touchTopology();
+		sync();
+	}
+
+	void Mesh::remeshFaces(const FaceSet& faces, double targetLength, int iterations){
+		if (targetLength<=0 or iterations<=0 or faces.empty()) return;
+		_detach();
+		MeshImpl& m = *mpMesh;
+
+		std::vector<unsigned int> indices;
+		BOOST_FOREACH(const shared_ptr<FaceProxy>& f, faces){
+			const FaceImpl* p = f->pImpl();
+			if (p!=NULL and p>=&m.face.front() and p<=&m.face.back()) indices.push_back(p - &m.face[0]);
+		}
+		fg::remesh(m,indices,targetLength,iterations);
+
+		_touchTopology();
 		sync();
 	}
 
@@ -191,16 +321,223 @@ namespace fg {
 		glTriMesh.Draw<vcg::GLW::DMFlat, vcg::GLW::CMNone, vcg::GLW::TMNone> ();
 	}
 
+	/// follow a VF link along its chain until it reaches a live face (or the end of the chain)
+	template <typename Index>
+	static void skipDeletedVF(FaceImpl*& f, Index& i){
+		while (f!=NULL and f->IsD()){
+			FaceImpl* next = f->VFp(i);
+			i = f->VFi(i);
+			f = next;
+		}
+	}
+
+	void Mesh::compact(){
+		if (mpMesh->vn==(int)mpMesh->vert.size() and mpMesh->fn==(int)mpMesh->face.size()) return;
+		_detach();
+		MeshImpl& m = *mpMesh;
+
+		// newIndex[i] is where element i ends up
+		std::vector<unsigned int> newVertexIndex(m.vert.size(),(unsigned int)Handle::INVALID);
+		std::vector<unsigned int> newFaceIndex(m.face.size(),(unsigned int)Handle::INVALID);
+
+		// a VF chain can still pass through a deleted face (if it wasn't unlinked), so step
+		// over those now, while the deleted faces still hold the rest of the chain
+		for(unsigned int i=0;i<m.face.size();i++){
+			FaceImpl& f = m.face[i];
+			if (f.IsD()) continue;
+			for(int j=0;j<3;j++) skipDeletedVF(f.VFp(j),f.VFi(j));
+		}
+		for(unsigned int i=0;i<m.vert.size();i++){
+			VertexImpl& v = m.vert[i];
+			if (!v.IsD()) skipDeletedVF(v.VFp(),v.VFi());
+		}
+
+		// elements only ever move down, so they can be copied in place.
+		// NB: the whole element is copied as ImportData would drop the bones, and it is
+		// copy constructed as vcg's element assignment (InfoOcf::operator=) copies nothing
+		unsigned int n = 0;
+		for(unsigned int i=0;i<m.vert.size();i++){
+			if (m.vert[i].IsD()) continue;
+			if (n!=i){
+				m.vert[n].~VertexImpl();
+				new (&m.vert[n]) VertexImpl(m.vert[i]);
+			}
+			newVertexIndex[i] = n++;
+		}
+		unsigned int nf = 0;
+		for(unsigned int i=0;i<m.face.size();i++){
+			if (m.face[i].IsD()) continue;
+			if (nf!=i){
+				m.face[nf].~FaceImpl();
+				new (&m.face[nf]) FaceImpl(m.face[i]);
+			}
+			newFaceIndex[i] = nf++;
+		}
+
+		// shrinking doesn't reallocate, so the old pointers still index the same storage
+		VertexImpl* vbase = m.vert.empty()?NULL:&m.vert[0];
+		FaceImpl* fbase = m.face.empty()?NULL:&m.face[0];
+		m.vert.resize(n);
+		m.face.resize(nf);
+		m.vn = n;
+		m.fn = nf;
+
+		for(unsigned int i=0;i<nf;i++){
+			FaceImpl& f = m.face[i];
+			for(int j=0;j<3;j++){
+				f.V(j) = vbase + newVertexIndex[f.V(j) - vbase];
+
+				if (f.VFp(j)!=NULL){
+					unsigned int k = newFaceIndex[f.VFp(j) - fbase];
+					assert(k!=Handle::INVALID);
+					f.VFp(j) = fbase + k;
+				}
+
+				if (f.FFp(j)!=NULL){
+					unsigned int k = newFaceIndex[f.FFp(j) - fbase];
+					if (k==Handle::INVALID){
+						// the neighbour is gone, so this is now a border edge
+						f.FFp(j) = &f;
+						f.FFi(j) = j;
+					}
+					else f.FFp(j) = fbase + k;
+				}
+			}
+		}
+
+		for(unsigned int i=0;i<n;i++){
+			VertexImpl& v = m.vert[i];
+			if (v.VFp()==NULL) continue;
+			unsigned int k = newFaceIndex[v.VFp() - fbase];
+			assert(k!=Handle::INVALID);
+			v.VFp() = fbase + k;
+		}
+
+		mVertexHandles.remap(newVertexIndex);
+		mFaceHandles.remap(newFaceIndex);
+		_touchTopology();
+	}
+
 	void Mesh::sync(){
-		//vcg::tri::UpdateNormals<MeshImpl>::PerFace(*mpMesh);
-		//vcg::tri::UpdateNormals<MeshImpl>::NormalizeFace(*mpMesh);
-		vcg::tri::UpdateNormals<MeshImpl>::PerVertexNormalizedPerFace(*mpMesh);
-		vcg::tri::UpdateNormals<MeshImpl>::NormalizeFace(*mpMesh);
-		// vcg::tri::UpdateNormals<MeshImpl>::PerVertexFromCurrentFaceNormal(*mpMesh);
+		if (mAutoCompact>0){
+			MeshImpl& m = *mpMesh;
+			if (m.vert.size()-m.vn > mAutoCompact*m.vert.size() or m.face.size()-m.fn > mAutoCompact*m.face.size()){
+				compact();
+			}
+		}
+
+		if (mIncrementalSync and mSynced and mSyncedTopologyVersion==mTopologyVersion){
+			if (mSyncedVersion==mVersion) return; // nothing has changed
+
+			std::vector<MeshJournal::Range> vertices, faces;
+			if (mJournal.getChangesSince(mSyncedVersion,vertices,faces) and syncVertices(vertices)){
+				mSyncedVersion = mVersion;
+				return;
+			}
+		}
+		syncAll();
+	}
+
+	void Mesh::syncAll(){
+		// Equivalent to UpdateNormals::PerVertexNormalizedPerFace followed by NormalizeFace,
+		// except each vertex gathers the normals of its faces (via the VF adjacency) rather
+		// than the faces scattering into their vertices. This means the loops can run in
+		// parallel without races and the sums are added in the same order no matter how
+		// many threads are used.
+		_detach();
+		const int nf = mpMesh->face.size();
+		const int nv = mpMesh->vert.size();
+		const int threads = Parallel::threadsFor(nf>nv?nf:nv);
+
+		// unnormalized, so larger faces contribute more to the vertex normals
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<nf;i++){
+			FaceImpl& f = mpMesh->face[i];
+			if (!f.IsD()) f.N() = vcg::Normal(f);
+		}
+
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<nv;i++){
+			VertexImpl& v = mpMesh->vert[i];
+			if (v.IsD() or v.VFp()==NULL) continue; // vcg also leaves unreferenced vertices alone
+			NormalType n(0,0,0);
+			for(vcg::face::VFIterator<FaceImpl> vfi(&v);!vfi.End();++vfi){
+				n += vfi.F()->cN();
+			}
+			v.N() = n;
+			v.N().Normalize();
+		}
+
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<nf;i++){
+			FaceImpl& f = mpMesh->face[i];
+			if (!f.IsD()) f.N().Normalize();
+		}
+
+		mSynced = true;
+		mSyncedVersion = mVersion;
+		mSyncedTopologyVersion = mTopologyVersion;
+	}
+
+	bool Mesh::syncVertices(const std::vector<MeshJournal::Range>& ranges){
+		unsigned int count = 0;
+		foreach(const MeshJournal::Range& r, ranges){
+			count += r.end - r.begin;
+		}
+		if (count*4 > mpMesh->vert.size()) return false; // cheaper to do the lot
+
+		// the normals are written, so the storage mustn't be shared with a clone
+		MeshImpl& m = *_impl();
+
+		// the faces around the modified vertices
+		std::vector<FaceImpl*> faces;
+		foreach(const MeshJournal::Range& r, ranges){
+			for(unsigned int i=r.begin;i<r.end and i<m.vert.size();i++){
+				VertexImpl* v = &m.vert[i];
+				if (v->IsD()) continue;
+				for(vcg::face::VFIterator<FaceImpl> vfi(v);!vfi.End();++vfi){
+					faces.push_back(vfi.F());
+				}
+			}
+		}
+		std::sort(faces.begin(),faces.end());
+		faces.erase(std::unique(faces.begin(),faces.end()),faces.end());
+
+		// ... and the vertices of those faces
+		std::vector<VertexImpl*> verts;
+		foreach(FaceImpl* f, faces){
+			for(int k=0;k<3;k++) verts.push_back(f->V(k));
+		}
+		std::sort(verts.begin(),verts.end());
+		verts.erase(std::unique(verts.begin(),verts.end()),verts.end());
+
+		// as in syncAll(), a vertex normal is the normalized sum of the (unnormalized)
+		// normals of its faces, in VF order
+		foreach(VertexImpl* v, verts){
+			NormalType n(0,0,0);
+			for(vcg::face::VFIterator<FaceImpl> vfi(v);!vfi.End();++vfi){
+				n += vcg::Normal(*vfi.F());
+			}
+			v->N() = n;
+			v->N().Normalize();
+		}
+
+		foreach(FaceImpl* f, faces){
+			f->N() = vcg::Normal(*f);
+			f->N().Normalize();
+		}
+		return true;
+	}
+
+	void Mesh::setIncrementalSync(bool incremental){
+		mIncrementalSync = incremental;
+		if (incremental) setJournalEnabled(true);
 	}
 
 	void Mesh::applyTransform(const Mat4& T){
+		_detach();
 		vcg::tri::UpdatePosition<MeshImpl>::Matrix(*mpMesh,T,true);
+		_touchGeometry();
 		/*
 		foreach(VertexImpl& v, mpMesh->vert){
 			// only return non-dead vertices
@@ -214,32 +551,102 @@ namespace fg {
 
 	boost::shared_ptr<Mesh> Mesh::clone(){
 		Mesh* m = new Mesh();
-		_copyMeshIntoMesh(*mpMesh,*m->mpMesh);
+
+		// share the storage, the first write to either mesh detaches it
+		m->mSharedImpl = mSharedImpl;
+		m->mpMesh = mpMesh;
+		m->mVertexHandles.setContainer(&mpMesh->vert);
+		m->mFaceHandles.setContainer(&mpMesh->face);
+
+		// the normals are shared too, so if they are up to date the first sync() has nothing to do
+		m->mIncrementalSync = mIncrementalSync;
+		m->mAutoCompact = mAutoCompact;
+		m->mJournal.setEnabled(mJournal.isEnabled());
+		m->mSynced = mSynced and mSyncedVersion==mVersion and mSyncedTopologyVersion==mTopologyVersion;
+
+		// the connectivity is the same, so topology caches can be shared (see getTopologyId())
+		m->mTopologyId = mTopologyId;
+		m->mTopologyVersion = mTopologyVersion;
+		m->mSyncedTopologyVersion = mTopologyVersion;
 		return boost::shared_ptr<Mesh>(m);
 	}
 
+	bool Mesh::isShared() const {
+		return !mSharedImpl.unique();
+	}
+
+	void Mesh::_detach(){
+		if (mSharedImpl.unique()) return;
+
+		boost::shared_ptr<MeshImpl> copy(new MeshImpl());
+		_copyMeshIntoMesh(*mpMesh,*copy);
+		mSharedImpl = copy;
+		mpMesh = copy.get();
+
+		// the layout is identical so the handles still refer to the same elements
+		mVertexHandles.setContainer(&mpMesh->vert);
+		mFaceHandles.setContainer(&mpMesh->face);
+	}
+
 	MeshImpl* Mesh::_impl(){
+		_detach();
+		return mpMesh;
+	}
+
+	const MeshImpl* Mesh::_constImpl() const {
 		return mpMesh;
 	}
 
 	shared_ptr<VertexProxy> Mesh::_newSP(VertexImpl* v){
-		shared_ptr<VertexProxy> pvp(new VertexProxy(this, v));
-		mVertexProxyList.add(pvp);
-		return pvp;
+		return shared_ptr<VertexProxy>(new VertexProxy(this, v));
 	}
 
 	shared_ptr<FaceProxy> Mesh::_newSP(FaceImpl* f){
-		shared_ptr<FaceProxy> pvp(new FaceProxy(this, f));
-		mFaceProxyList.add(pvp);
-		return pvp;
+		return shared_ptr<FaceProxy>(new FaceProxy(this, f));
+	}
+
+	void Mesh::setJournalEnabled(bool enabled){
+		// changes made while disabled weren't recorded
+		if (enabled and !mJournal.isEnabled()) mJournal.reset(mVersion);
+		mJournal.setEnabled(enabled);
+	}
+
+	void Mesh::_touchVertex(VertexImpl* v){
+		mVersion++;
+		mGeometryVersion++;
+		unsigned int i = v - &mpMesh->vert[0];
+		mJournal.addVertices(mVersion,i,i+1);
+	}
+
+	void Mesh::_touchFace(FaceImpl* f){
+		mVersion++;
+		mGeometryVersion++;
+		unsigned int i = f - &mpMesh->face[0];
+		mJournal.addFaces(mVersion,i,i+1);
+	}
+
+	void Mesh::_touchGeometry(){
+		mVersion++;
+		mGeometryVersion++;
+		mJournal.addVertices(mVersion,0,mpMesh->vert.size());
+		mJournal.addFaces(mVersion,0,mpMesh->face.size());
+	}
+
+	void Mesh::_touchTopology(){
+		mVersion++;
+		mGeometryVersion++;
+		mTopologyVersion++;
+		mTopologyId = mId;
+		// indices aren't comparable across a topology change
+		mJournal.reset(mVersion);
 	}
 
-	VertexProxyList* Mesh::_vpl(){
-		return &mVertexProxyList;
+	VertexHandleTable* Mesh::_vertexHandles(){
+		return &mVertexHandles;
 	}
 
-	FaceProxyList* Mesh::_fpl(){
-		return &mFaceProxyList;
+	FaceHandleTable* Mesh::_faceHandles(){
+		return &mFaceHandles;
 	}
 
 
@@ -305,33 +712,31 @@ namespace fg {
 		return sync(m);
 	}
 
-	boost::shared_ptr<Mesh> Mesh::Primitives::Iso(int resolution, luabind::object& function){
-		typedef vcg::SimpleVolume<vcg::SimpleVoxel> MyVolume;
-		typedef vcg::tri::TrivialWalker<MeshImpl,MyVolume> MyWalker;
-		typedef vcg::tri::MarchingCubes<MeshImpl,MyWalker> MyMarchingCubes;
+	boost::shared_ptr<Mesh> Mesh::Primitives::Iso(int resolution, luabind::object function){
+		return Iso(resolution,shared_ptr<Field>(new LuaField(function,false)));
+	}
 
-		MyVolume volume;
-		MyWalker walker;
+	boost::shared_ptr<Mesh> Mesh::Primitives::Iso(int resolution, shared_ptr<Field> field){
 		Mesh* m = new Mesh();
-
-		volume.Init(Point3i(resolution,resolution,resolution));
-		double invres = 1./(resolution-1);
-		double twoinvres = 2./(resolution-1);
-		for(int i=0;i<resolution;i++){
-			double di = twoinvres*i - 1;
-			for(int j=0;j<resolution;j++){
-				double dj = twoinvres*j - 1;
-				for(int k=0;k<resolution;k++){
-					double dk = twoinvres*k - 1;
-					volume.Val(i,j,k) = luabind::call_function<float>(function,di,dj,dk);
-				}
-			}
+		try {
+			MarchingCubes::build(*field,resolution,Vec3(-1,-1,-1),Vec3(1,1,1),*(m->mpMesh));
 		}
-		MyMarchingCubes	mc(*(m->mpMesh), walker);
-		walker.BuildMesh<MyMarchingCubes>(*(m->mpMesh), volume, mc, 0); //20*20);
-
-		m->applyTransform(Mat4().setTranslate(-1,-1,-1)*Mat4().setScale(2*invres));
+		catch(...){
+			delete m;
+			throw;
+		}
+		return sync(m);
+	}
 
+	boost::shared_ptr<Mesh> Mesh::Primitives::SparseIso(int resolution, shared_ptr<Field> field, double lipschitz){
+		Mesh* m = new Mesh();
+		try {
+			MarchingCubes::buildSparse(*field,resolution,Vec3(-1,-1,-1),Vec3(1,1,1),*(m->mpMesh),lipschitz);
+		}
+		catch(...){
+			delete m;
+			throw;
+		}
 		return sync(m);
 	}
 
@@ -453,13 +858,23 @@ namespace fg {
 	}
 
 	boost::shared_ptr<Mesh> Mesh::Load(boost::filesystem::path file){
-		_FloatMeshImpl fm;
 		std::string filepath = file.string();
-		vcg::tri::io::Importer<_FloatMeshImpl>::Open(fm,filepath.c_str());
-
-		// copy
 		Mesh* m = new Mesh();
-		_copyFloatMeshIntoMesh(fm,*m->_impl());
+		if (MeshLoader::canLoad(filepath)){
+			try {
+				MeshLoader::load(filepath,*m->_impl());
+			}
+			catch(...){
+				delete m;
+				throw;
+			}
+		}
+		else {
+			// other formats go through vcg
+			_FloatMeshImpl fm;
+			vcg::tri::io::Importer<_FloatMeshImpl>::Open(fm,filepath.c_str());
+			_copyFloatMeshIntoMesh(fm,*m->_impl());
+		}
 		m->sync();
 		return boost::shared_ptr<Mesh>(m);
 	}
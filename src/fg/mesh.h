@@ -32,6 +32,7 @@
 #include "fg/face.h"
 #include "fg/mat4.h"
 #include "fg/util.h"
+#include "fg/meshjournal.h"
 
 // Stdlibs
 #include <ostream>
@@ -44,6 +45,7 @@
 // BOOST
 #include <boost/shared_ptr.hpp>
 #include <boost/tuple/tuple.hpp>
+#include <boost/detail/atomic_count.hpp>
 #define BOOST_FILESYSTEM_VERSION 3
 #include <boost/filesystem.hpp>
 
@@ -54,6 +56,8 @@
 namespace fg {
 	// forward decl
 	class MeshImpl;
+	class Field;
+	class Subdivider;
 	
 	/** 
 	 * \brief A triangular mesh in an fg simulation
@@ -85,7 +89,28 @@ namespace fg {
 			static boost::shared_ptr<Mesh> Cone(double r1, double r2, const int SubDiv = 36);
 			static boost::shared_ptr<Mesh> Cylinder(int slices); // , int stacks);
 
-			static boost::shared_ptr<Mesh> Iso(int resolution, luabind::object& function);
+			/**
+			 * \brief Build the iso-surface of function(x,y,z) = 0 over [-1,1]^3.
+			 * Calls the lua function once per grid point, see the Field version for a faster alternative.
+			 */
+			static boost::shared_ptr<Mesh> Iso(int resolution, luabind::object function);
+
+			/**
+			 * \brief Build the iso-surface of field = 0 over [-1,1]^3.
+			 *
+			 * The field is evaluated a slice (a constant-z plane of the grid) at a time
+			 * and polygonised by fg::MarchingCubes, in parallel if the field is thread-safe.
+			 */
+			static boost::shared_ptr<Mesh> Iso(int resolution, shared_ptr<Field> field);
+
+			/**
+			 * \brief Build the iso-surface of field = 0 over [-1,1]^3, only sampling the grid near the surface.
+			 *
+			 * Much faster than Iso() at high resolutions when the surface fills little
+			 * of the volume. lipschitz (if > 0) bounds the rate of change of the field,
+			 * see fg::MarchingCubes::buildSparse.
+			 */
+			static boost::shared_ptr<Mesh> SparseIso(int resolution, shared_ptr<Field> field, double lipschitz = 0);
 
 			private:
 			static boost::shared_ptr<Mesh> sync(Mesh* m);
@@ -150,17 +175,132 @@ namespace fg {
 
 		// Common modifiers
 		void subdivide(int levels); ///< \brief Perform flat subdivision on the mesh
-		void smoothSubdivide(int levels); ///< \brief Perform smooth subdivision on the mesh
+		void smoothSubdivide(int levels); ///< \brief Perform smooth (interpolating butterfly) subdivision on the mesh, see Subdivider
+		void loopSubdivide(int levels); ///< \brief Perform Loop subdivision on the mesh, see Subdivider
 
-		/// \brief Sync will make sure all the topology, normals, etc are fixed..
+		/**
+		 * \brief Perform flat subdivision on some faces only, levels times.
+		 *
+		 * The faces around them are split into transition triangles so there are no cracks
+		 * (see fg/refine.h). Vertices and faces you hold stay valid, each face becomes one of its children.
+		 */
+		void subdivideFaces(const FaceSet& faces, int levels);
+		/// \brief Perform flat subdivision on the faces around some vertices, see subdivideFaces()
+		void subdivideVertices(const VertexSet& vertices, int levels);
+
+		/**
+		 * \brief Split edges until they are shorter than maxEdgeLength and their curvature error is below maxError.
+		 *
+		 * The edges that exceed their limits the most are split first, until the mesh has maxFaces faces.
+		 * A limit <= 0 is ignored. See fg::refineAdaptive().
+		 * @return the number of vertices added
+		 */
+		int adaptiveSubdivide(double maxEdgeLength, double maxError, int maxFaces);
+
+		/**
+		 * \brief Remesh the mesh towards regular triangles with edges of targetLength.
+		 *
+		 * Each iteration splits long edges, collapses short ones, flips edges to even out the
+		 * valences and relaxes the vertices over the surface (see fg::remesh()). The borders stay put.
+		 * Collapsed vertices and faces are deleted (see compact()), the rest stay valid.
+		 */
+		void remesh(double targetLength, int iterations);
+		/// \brief Remesh some faces only, see remesh(). The border of the selection stays put.
+		void remeshFaces(const FaceSet& faces, double targetLength, int iterations);
+
+		/**
+		 * \brief Sync will make sure all the topology, normals, etc are fixed..
+		 *
+		 * If incremental sync is enabled (the default) and the topology hasn't changed
+		 * since the last sync, only the normals of the faces touching modified vertices,
+		 * and of the vertices of those faces, are recomputed. Otherwise it does a syncAll().
+		 */
 		void sync();
 
+		/// \brief Recompute all the normals
+		void syncAll();
+
+		/**
+		 * \brief Enable/disable incremental sync (see sync()).
+		 *
+		 * Incremental sync relies on the mesh journal, so this also enables the journal.
+		 */
+		void setIncrementalSync(bool incremental);
+		bool getIncrementalSync() const {return mIncrementalSync;}
+
+		/**
+		 * \brief Remove deleted vertices and faces from the underlying storage.
+		 *
+		 * Operators like extrude only mark the elements they remove, so a mesh
+		 * that has been modified a lot can end up with many dead slots that every
+		 * full pass (sync, render, export, ...) still has to step over.
+		 * Adjacency is preserved and existing vertex/face proxies stay valid.
+		 */
+		void compact();
+
+		/**
+		 * \brief Compact automatically in sync() when more than fraction of the
+		 * vertices or faces are deleted. 0 disables it (the default).
+		 */
+		void setAutoCompact(double fraction){mAutoCompact = fraction;}
+		double getAutoCompact() const {return mAutoCompact;}
+
 		void applyTransform(const Mat4& T); ///< \brief Applies T to the positions of the vertices. (For each vertex v in mesh, v.pos = T*v.pos) Also syncs at the end so the normals are appropriate.
 
 		/** \brief Create a new mesh identical to this one
+		 *
+		 * The clone shares its vertices and faces with this mesh (copy-on-write)
+		 * until either of them is modified, so cloning is cheap and clones that
+		 * are never changed cost almost no memory.
 		 */
 		boost::shared_ptr<Mesh> clone();
 
+		/// \brief True if the storage is still shared with a clone (or the mesh it was cloned from)
+		bool isShared() const;
+
+		/**
+		 * \brief Returns an identifier that is unique to this mesh (ids are never reused)
+		 */
+		unsigned int getId() const {return mId;}
+
+		/**
+		 * \brief Returns a counter that is incremented whenever the mesh is modified
+		 *
+		 * Caches (e.g., the buffers kept by fg::GLRenderer) compare this against the value
+		 * they last saw to decide whether they need to be rebuilt.
+		 */
+		unsigned int getVersion() const {return mVersion;}
+
+		/// \brief Returns a counter that is incremented whenever a vertex or face attribute (position, normal, colour, uv) changes
+		unsigned int getGeometryVersion() const {return mGeometryVersion;}
+
+		/// \brief Returns a counter that is incremented whenever vertices or faces are added, removed or reconnected
+		unsigned int getTopologyVersion() const {return mTopologyVersion;}
+
+		/**
+		 * \brief Returns the id of the mesh whose connectivity this mesh has.
+		 *
+		 * A clone keeps the topology id and version of the mesh it was cloned from until
+		 * its own topology changes, so together with getTopologyVersion() this identifies
+		 * the connectivity, e.g., for caches that can be shared by clones (see Subdivider).
+		 */
+		unsigned int getTopologyId() const {return mTopologyId;}
+
+		/**
+		 * \brief Enable/disable recording which vertices and faces change (disabled by default)
+		 *
+		 * See getJournal().
+		 */
+		void setJournalEnabled(bool enabled);
+
+		/**
+		 * \brief Retrieve the journal of changed vertex/face ranges
+		 *
+		 * E.g., a cache built at version v can call getJournal().getChangesSince(v,...)
+		 * and, if the topology version hasn't changed, only update the returned ranges.
+		 */
+		const MeshJournal& getJournal() const {return mJournal;}
+
 		/**
 		 * \brief TODO: Merges mesh m into this mesh. NOTE: m is now invalid.
 		 */
@@ -174,20 +314,52 @@ namespace fg {
 		 * Only use these if you know what you are doing.
 		 */
 
-		/// \brief (LOW LEVEL) Return the VCG implementation in this mesh
+		/// \brief (LOW LEVEL) Return the VCG implementation in this mesh. Makes a private copy first if the storage is shared (see clone()).
 		MeshImpl* _impl();
+		const MeshImpl* _constImpl() const; ///< \brief (LOW LEVEL) Read-only access, never copies
+		void _detach(); ///< \brief (LOW LEVEL) Make a private copy of the storage if it is shared
+
+		shared_ptr<VertexProxy> _newSP(VertexImpl*); ///< \brief (LOW LEVEL) Create a new shared_ptr<vertexproxy> referring to the vertex by handle
+		shared_ptr<FaceProxy> _newSP(FaceImpl*); ///< \brief (LOW LEVEL) Create a new shared_ptr<faceproxy> referring to the face by handle
+		VertexHandleTable* _vertexHandles(); ///< \brief (LOW LEVEL)
+		FaceHandleTable* _faceHandles(); ///< \brief (LOW LEVEL)
 
-		shared_ptr<VertexProxy> _newSP(VertexImpl*); ///< \brief (LOW LEVEL) Create a new shared_ptr<vertexproxy> and track it usin the proxylist
-		shared_ptr<FaceProxy> _newSP(FaceImpl*); ///< \brief (LOW LEVEL) Create a new shared_ptr<faceproxy> and track it usin the proxylist
-		VertexProxyList* _vpl(); ///< \brief (LOW LEVEL)
-		FaceProxyList* _fpl(); ///< \brief (LOW LEVEL)
+		/*
+		 * (LOW LEVEL) Mark parts of this mesh as modified.
+		 * Call one of these after changing the MeshImpl directly.
+		 */
+		void _touchVertex(VertexImpl* v); ///< \brief (LOW LEVEL) An attribute of v changed
+		void _touchFace(FaceImpl* f); ///< \brief (LOW LEVEL) An attribute of f changed
+		void _touchGeometry(); ///< \brief (LOW LEVEL) Attributes of any vertex may have changed
+		void _touchTopology(); ///< \brief (LOW LEVEL) Vertices or faces were added, removed or reconnected
 
 		private:
 		Mesh(); // Can't construct a blank mesh.
-		MeshImpl* mpMesh;
-
-		VertexProxyList mVertexProxyList;
-		FaceProxyList mFaceProxyList;
+		boost::shared_ptr<MeshImpl> mSharedImpl; ///< owns the storage, possibly shared with clones
+		MeshImpl* mpMesh; ///< mSharedImpl.get()
+
+		unsigned int mId;
+		unsigned int mVersion;
+		unsigned int mGeometryVersion;
+		unsigned int mTopologyVersion;
+		unsigned int mTopologyId;
+		MeshJournal mJournal;
+		static boost::detail::atomic_count sNextId; ///< atomic, as meshes can be made in worker threads
+
+		bool mIncrementalSync;
+		bool mSynced; ///< true if syncAll() has run at least once
+		unsigned int mSyncedVersion; ///< the version at the last sync
+		unsigned int mSyncedTopologyVersion;
+		double mAutoCompact;
+
+		/// subdivide in place with s, keeping the vertex and face handles valid
+		void stencilSubdivide(Subdivider& s, int levels);
+
+		/// recompute normals around the vertices in ranges, returns false if a syncAll() is preferable
+		bool syncVertices(const std::vector<MeshJournal::Range>& ranges);
+
+		VertexHandleTable mVertexHandles;
+		FaceHandleTable mFaceHandles;
 	};
 }
 
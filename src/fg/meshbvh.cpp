@@ -0,0 +1,722 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/meshbvh.h"
+#include "fg/meshimpl.h"
+#include "fg/parallel.h"
+
+#include <vcg/space/intersection/triangle_triangle3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace fg {
+	typedef vcg::Point3d P3;
+
+	// SAH split candidates per axis (smaller nodes use one bin per face)
+	static const int NUM_BINS = 16;
+
+	// nodes with more faces than this are always split
+	static const int MAX_LEAF_SIZE = 8;
+
+	// cost of visiting a node relative to testing a face
+	static const double TRAVERSAL_COST = 2.0;
+
+	/// An axis aligned box without vcg::Box3's null checks, for the build loops
+	struct BVHBounds {
+		BVHBounds(){
+			for(int a=0;a<3;a++){
+				min[a] = std::numeric_limits<double>::max();
+				max[a] = -std::numeric_limits<double>::max();
+			}
+		}
+		void add(const double* lo, const double* hi){
+			for(int a=0;a<3;a++){
+				if (lo[a]<min[a]) min[a] = lo[a];
+				if (hi[a]>max[a]) max[a] = hi[a];
+			}
+		}
+		void add(const BVHBounds& b){add(b.min,b.max);}
+		bool isNull() const {return min[0]>max[0];}
+		double area() const {
+			if (isNull()) return 0;
+			const double dx = max[0]-min[0], dy = max[1]-min[1], dz = max[2]-min[2];
+			return 2*(dx*dy + dy*dz + dz*dx);
+		}
+		vcg::Box3d box() const {return vcg::Box3d(P3(min[0],min[1],min[2]),P3(max[0],max[1],max[2]));}
+
+		double min[3];
+		double max[3];
+	};
+
+	/// A face being sorted into the tree, the array of these is partitioned in place
+	struct MeshBVH::BuildFace {
+		double min[3];
+		double max[3];
+		double centroid[3];
+		int face;
+	};
+
+	/// A node (still to be split) covering the faces [begin,end)
+	struct MeshBVH::BuildTask {
+		BuildTask(int n, int b, int e, const BVHBounds& bb, const BVHBounds& cb):node(n),begin(b),end(e),bounds(bb),cbounds(cb){}
+		int node;
+		int begin;
+		int end;
+		BVHBounds bounds; ///< of the faces
+		BVHBounds cbounds; ///< of the face centroids
+	};
+
+	struct BVHBin {
+		BVHBin():bounds(),cbounds(),count(0){}
+		BVHBounds bounds;
+		BVHBounds cbounds;
+		int count;
+	};
+
+	/// Maps a face to its bin, as a predicate it sends the faces in bins below split to the left
+	struct BVHBinner {
+		BVHBinner(int a, double m, double s, int n):axis(a),min(m),scale(s),numBins(n),split(0){}
+		BVHBinner(const BVHBinner& b, int k):axis(b.axis),min(b.min),scale(b.scale),numBins(b.numBins),split(k){}
+		template <class F>
+		int bin(const F& f) const {
+			return std::min((int)((f.centroid[axis]-min)*scale),numBins-1);
+		}
+		template <class F>
+		bool operator()(const F& f) const {return bin(f)<split;}
+
+		int axis;
+		double min, scale;
+		int numBins;
+		int split;
+	};
+
+	/**
+	 * Chooses a binned SAH split of the faces in t. If t should be split its faces
+	 * are partitioned so that [t.begin,mid) goes left, left and right are set to the
+	 * child tasks and true is returned, otherwise returns false.
+	 * Uses threads threads for the passes over the faces.
+	 */
+	bool MeshBVH::splitRange(BuildFace* faces, const BuildTask& t, int threads, BuildTask& left, BuildTask& right){
+		const int begin = t.begin, end = t.end, n = end - begin;
+		const BVHBounds& cbounds = t.cbounds;
+		if (n<=1) return false;
+
+		// bin the centroids along the axis they are most spread out on
+		int axis = 0;
+		for(int a=1;a<3;a++){
+			if (cbounds.max[a]-cbounds.min[a] > cbounds.max[axis]-cbounds.min[axis]) axis = a;
+		}
+		const double extent = cbounds.max[axis] - cbounds.min[axis];
+		if (extent<=0){
+			// every centroid is in the same place, split arbitrarily if there are too many
+			if (n<=MAX_LEAF_SIZE) return false;
+			const int mid = begin + n/2;
+			left = BuildTask(-1,begin,mid,BVHBounds(),t.cbounds);
+			right = BuildTask(-1,mid,end,BVHBounds(),t.cbounds);
+			for(int i=begin;i<mid;i++) left.bounds.add(faces[i].min,faces[i].max);
+			for(int i=mid;i<end;i++) right.bounds.add(faces[i].min,faces[i].max);
+			return true;
+		}
+		const int numBins = std::min(n,NUM_BINS);
+		const BVHBinner binOf(axis,cbounds.min[axis],numBins/extent,numBins);
+
+		BVHBin bins[NUM_BINS];
+		if (threads<=1){
+			for(int i=begin;i<end;i++){
+				const BuildFace& f = faces[i];
+				BVHBin& b = bins[binOf.bin(f)];
+				b.bounds.add(f.min,f.max);
+				b.cbounds.add(f.centroid,f.centroid);
+				b.count++;
+			}
+		}
+		else {
+			// each thread fills its own bins, then they are merged (the result is the same)
+			std::vector<BVHBin> tbins(threads*NUM_BINS);
+			#pragma omp parallel num_threads(threads)
+			{
+				BVHBin* local = &tbins[Parallel::threadIndex()*NUM_BINS];
+				#pragma omp for schedule(static)
+				for(int i=begin;i<end;i++){
+					const BuildFace& f = faces[i];
+					BVHBin& b = local[binOf.bin(f)];
+					b.bounds.add(f.min,f.max);
+					b.cbounds.add(f.centroid,f.centroid);
+					b.count++;
+				}
+			}
+			for(int i=0;i<threads;i++){
+				for(int k=0;k<numBins;k++){
+					const BVHBin& tb = tbins[i*NUM_BINS + k];
+					bins[k].bounds.add(tb.bounds);
+					bins[k].cbounds.add(tb.cbounds);
+					bins[k].count += tb.count;
+				}
+			}
+		}
+
+		// sweep the bins for the cheapest split, rightArea[k] and rightCount[k] are for bins [k,numBins)
+		double rightArea[NUM_BINS];
+		int rightCount[NUM_BINS];
+		BVHBounds rightBounds;
+		int count = 0;
+		for(int k=numBins-1;k>0;k--){
+			rightBounds.add(bins[k].bounds);
+			count += bins[k].count;
+			rightArea[k] = rightBounds.area();
+			rightCount[k] = count;
+		}
+
+		int bestSplit = -1;
+		double bestCost = 0;
+		BVHBounds leftBounds;
+		count = 0;
+		for(int k=1;k<numBins;k++){
+			leftBounds.add(bins[k-1].bounds);
+			count += bins[k-1].count;
+			if (count==0 or rightCount[k]==0) continue;
+			double cost = count*leftBounds.area() + rightCount[k]*rightArea[k];
+			if (bestSplit<0 or cost<bestCost){
+				bestSplit = k;
+				bestCost = cost;
+			}
+		}
+
+		const double area = t.bounds.area();
+		if (n<=MAX_LEAF_SIZE and n*area <= TRAVERSAL_COST*area + bestCost) return false;
+
+		// the children's bounds are those of their bins
+		const int mid = std::partition(faces+begin, faces+end, BVHBinner(binOf,bestSplit)) - faces;
+		left = BuildTask(-1,begin,mid,BVHBounds(),BVHBounds());
+		right = BuildTask(-1,mid,end,BVHBounds(),BVHBounds());
+		for(int k=0;k<numBins;k++){
+			BuildTask& child = k<bestSplit?left:right;
+			child.bounds.add(bins[k].bounds);
+			child.cbounds.add(bins[k].cbounds);
+		}
+		return true;
+	}
+
+	void MeshBVH::buildSubtree(BuildFace* faces, std::vector<Node>& nodes, const BuildTask& root){
+		std::vector<BuildTask> stack(1,root);
+		while (!stack.empty()){
+			BuildTask t = stack.back();
+			stack.pop_back();
+			Node& node = nodes[t.node];
+			node.box = t.bounds.box();
+
+			BuildTask left(t), right(t);
+			if (!splitRange(faces,t,1,left,right)){
+				node.start = t.begin;
+				node.count = t.end - t.begin;
+				continue;
+			}
+
+			node.left = nodes.size();
+			node.count = 0;
+			left.node = node.left;
+			right.node = node.left + 1;
+			nodes.resize(nodes.size()+2);
+			stack.push_back(right);
+			stack.push_back(left);
+		}
+	}
+
+	MeshBVH::Hit::Hit()
+	:hit(false)
+	,distance(0)
+	,point(0,0,0)
+	,face()
+	,u(0)
+	,v(0)
+	{}
+
+	MeshBVH::MeshBVH(boost::shared_ptr<Mesh> m)
+	:mMesh(m)
+	,mNodes()
+	,mFaces()
+	,mBuilt(false)
+	,mTopologyVersion(0)
+	,mGeometryVersion(0)
+	{}
+
+	void MeshBVH::update(){
+		if (!mBuilt or mMesh->getTopologyVersion()!=mTopologyVersion){
+			rebuild();
+		}
+		else if (mMesh->getGeometryVersion()!=mGeometryVersion){
+			refit();
+			mGeometryVersion = mMesh->getGeometryVersion();
+		}
+	}
+
+	void MeshBVH::rebuild(){
+		const MeshImpl& m = *mMesh->_constImpl();
+		mBuilt = true;
+		mTopologyVersion = mMesh->getTopologyVersion();
+		mGeometryVersion = mMesh->getGeometryVersion();
+		mNodes.clear();
+		mFaces.clear();
+
+		const int nf = m.face.size();
+		for(int i=0;i<nf;i++){
+			if (!m.face[i].IsD()) mFaces.push_back(i);
+		}
+		const int n = mFaces.size();
+		if (n==0) return;
+
+		std::vector<BuildFace> faces(n);
+		const int threads = Parallel::threadsFor(n);
+		std::vector<BVHBounds> tbounds(threads), tcbounds(threads);
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<n;i++){
+			const FaceImpl& f = m.face[mFaces[i]];
+			BuildFace& b = faces[i];
+			for(int a=0;a<3;a++){
+				b.min[a] = std::min(f.cP(0)[a],std::min(f.cP(1)[a],f.cP(2)[a]));
+				b.max[a] = std::max(f.cP(0)[a],std::max(f.cP(1)[a],f.cP(2)[a]));
+				b.centroid[a] = (f.cP(0)[a] + f.cP(1)[a] + f.cP(2)[a])/3.0;
+			}
+			b.face = mFaces[i];
+			tbounds[Parallel::threadIndex()].add(b.min,b.max);
+			tcbounds[Parallel::threadIndex()].add(b.centroid,b.centroid);
+		}
+
+		BuildTask root(0,0,n,BVHBounds(),BVHBounds());
+		for(int t=0;t<threads;t++){
+			root.bounds.add(tbounds[t]);
+			root.cbounds.add(tcbounds[t]);
+		}
+
+		mNodes.push_back(Node());
+		if (threads<=1){
+			buildSubtree(&faces[0],mNodes,root);
+		}
+		else {
+			buildParallel(&faces[0],root,threads);
+		}
+
+		for(int i=0;i<n;i++) mFaces[i] = faces[i].face;
+	}
+
+	void MeshBVH::buildParallel(BuildFace* faces, const BuildTask& root, int threads){
+		// split the top of the tree (with threaded passes over the faces) until
+		// there are enough subtrees to keep every thread busy
+		const int subtreeSize = std::max((root.end-root.begin)/(4*threads),MAX_LEAF_SIZE);
+		std::vector<BuildTask> pending(1,root);
+		std::vector<BuildTask> subtrees;
+		while (!pending.empty()){
+			BuildTask t = pending.back();
+			pending.pop_back();
+			if (t.end - t.begin <= subtreeSize){
+				subtrees.push_back(t);
+				continue;
+			}
+
+			Node& node = mNodes[t.node];
+			node.box = t.bounds.box();
+
+			BuildTask left(t), right(t);
+			if (!splitRange(faces,t,Parallel::threadsFor(t.end-t.begin),left,right)){
+				node.start = t.begin;
+				node.count = t.end - t.begin;
+				continue;
+			}
+
+			node.left = mNodes.size();
+			node.count = 0;
+			left.node = node.left;
+			right.node = node.left + 1;
+			mNodes.resize(mNodes.size()+2);
+			pending.push_back(right);
+			pending.push_back(left);
+		}
+
+		// build the subtrees in parallel, each in its own array ...
+		const int numSubtrees = subtrees.size();
+		std::vector<std::vector<Node> > local(numSubtrees);
+		#pragma omp parallel for num_threads(threads) schedule(dynamic)
+		for(int i=0;i<numSubtrees;i++){
+			BuildTask t = subtrees[i];
+			t.node = 0;
+			local[i].resize(1);
+			buildSubtree(faces,local[i],t);
+		}
+
+		// ... then append them, the subtree root replaces its placeholder
+		for(int i=0;i<numSubtrees;i++){
+			const int base = mNodes.size() - 1;
+			for(unsigned int j=0;j<local[i].size();j++){
+				Node node = local[i][j];
+				if (node.count==0) node.left += base;
+				if (j==0) mNodes[subtrees[i].node] = node;
+				else mNodes.push_back(node);
+			}
+		}
+	}
+
+	void MeshBVH::refit(){
+		const MeshImpl& m = *mMesh->_constImpl();
+		const int nn = mNodes.size();
+
+		// the leaves are independent ...
+		const int threads = Parallel::threadsFor(mFaces.size());
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<nn;i++){
+			Node& node = mNodes[i];
+			if (node.count==0) continue;
+			node.box.SetNull();
+			for(int j=node.start;j<node.start+node.count;j++){
+				const FaceImpl& f = m.face[mFaces[j]];
+				node.box.Add(f.cP(0));
+				node.box.Add(f.cP(1));
+				node.box.Add(f.cP(2));
+			}
+		}
+
+		// ... then the interior nodes go bottom up, as children always come after their parent
+		for(int i=nn-1;i>=0;i--){
+			Node& node = mNodes[i];
+			if (node.count>0) continue;
+			node.box = mNodes[node.left].box;
+			node.box.Add(mNodes[node.left+1].box);
+		}
+	}
+
+	boost::shared_ptr<FaceProxy> MeshBVH::faceProxy(int index) const {
+		// like Mesh::selectAllFaces() this doesn't detach the storage, the proxy resolves through its handle
+		return mMesh->_newSP(const_cast<FaceImpl*>(&mMesh->_constImpl()->face[index]));
+	}
+
+	/// Entry distance of the ray o + t*d (invD = 1/d) into box, within [tmin,tmax]
+	static bool rayBox(const vcg::Box3d& box, const P3& o, const P3& invD, double tmin, double tmax, double& t){
+		for(int a=0;a<3;a++){
+			double t0 = (box.min[a]-o[a])*invD[a];
+			double t1 = (box.max[a]-o[a])*invD[a];
+			if (t0>t1) std::swap(t0,t1);
+			if (t0>tmin) tmin = t0;
+			if (t1<tmax) tmax = t1;
+			if (tmin>tmax) return false;
+		}
+		t = tmin;
+		return true;
+	}
+
+	/// Moller-Trumbore, hits either side of the triangle
+	static bool rayTriangle(const P3& o, const P3& d, const P3& p0, const P3& p1, const P3& p2, double& t, double& u, double& v){
+		const P3 e1 = p1 - p0;
+		const P3 e2 = p2 - p0;
+		const P3 pv = d ^ e2;
+		const double det = e1 * pv;
+		if (det==0) return false;
+		const double invDet = 1.0/det;
+		const P3 tv = o - p0;
+		u = (tv * pv)*invDet;
+		if (u<0 or u>1) return false;
+		const P3 qv = tv ^ e1;
+		v = (d * qv)*invDet;
+		if (v<0 or u+v>1) return false;
+		t = (e2 * qv)*invDet;
+		return true;
+	}
+
+	/// The point on triangle abc closest to p (see Ericson, Real-Time Collision Detection, 5.1.5)
+	static P3 closestPointTriangle(const P3& p, const P3& a, const P3& b, const P3& c, double& u, double& v){
+		const P3 ab = b - a, ac = c - a, ap = p - a;
+		const double d1 = ab*ap, d2 = ac*ap;
+		if (d1<=0 and d2<=0){u = 0; v = 0; return a;}
+
+		const P3 bp = p - b;
+		const double d3 = ab*bp, d4 = ac*bp;
+		if (d3>=0 and d4<=d3){u = 1; v = 0; return b;}
+
+		const double vc = d1*d4 - d3*d2;
+		if (vc<=0 and d1>=0 and d3<=0){
+			u = d1/(d1 - d3);
+			v = 0;
+			return a + ab*u;
+		}
+
+		const P3 cp = p - c;
+		const double d5 = ab*cp, d6 = ac*cp;
+		if (d6>=0 and d5<=d6){u = 0; v = 1; return c;}
+
+		const double vb = d5*d2 - d1*d6;
+		if (vb<=0 and d2>=0 and d6<=0){
+			u = 0;
+			v = d2/(d2 - d6);
+			return a + ac*v;
+		}
+
+		const double va = d3*d6 - d5*d4;
+		if (va<=0 and (d4-d3)>=0 and (d5-d6)>=0){
+			v = (d4 - d3)/((d4 - d3) + (d5 - d6));
+			u = 1 - v;
+			return b + (c - b)*v;
+		}
+
+		const double denom = 1.0/(va + vb + vc);
+		u = vb*denom;
+		v = vc*denom;
+		return a + ab*u + ac*v;
+	}
+
+	static double squaredDistance(const vcg::Box3d& box, const P3& p){
+		double d2 = 0;
+		for(int a=0;a<3;a++){
+			if (p[a]<box.min[a]) d2 += (box.min[a]-p[a])*(box.min[a]-p[a]);
+			else if (p[a]>box.max[a]) d2 += (p[a]-box.max[a])*(p[a]-box.max[a]);
+		}
+		return d2;
+	}
+
+	static bool overlaps(const vcg::Box3d& a, const vcg::Box3d& b){
+		for(int i=0;i<3;i++){
+			if (a.min[i]>b.max[i] or a.max[i]<b.min[i]) return false;
+		}
+		return true;
+	}
+
+	/// Separating axis test of triangle abc against the box centred at c with half size h (Akenine-Moller)
+	static bool triangleBoxOverlap(const P3& centre, const P3& h, const P3& a, const P3& b, const P3& c){
+		const P3 v[3] = {a - centre, b - centre, c - centre};
+		const P3 e[3] = {v[1] - v[0], v[2] - v[1], v[0] - v[2]};
+
+		// the nine edge x box axis cross products
+		for(int i=0;i<3;i++){
+			for(int j=0;j<3;j++){
+				P3 axis(0,0,0);
+				axis[j] = 1;
+				axis = axis ^ e[i];
+				const double p0 = axis*v[0], p1 = axis*v[1], p2 = axis*v[2];
+				const double r = h[0]*std::fabs(axis[0]) + h[1]*std::fabs(axis[1]) + h[2]*std::fabs(axis[2]);
+				if (std::min(p0,std::min(p1,p2))>r or std::max(p0,std::max(p1,p2))<-r) return false;
+			}
+		}
+
+		// the box axes
+		for(int j=0;j<3;j++){
+			if (std::min(v[0][j],std::min(v[1][j],v[2][j]))>h[j] or std::max(v[0][j],std::max(v[1][j],v[2][j]))<-h[j]) return false;
+		}
+
+		// the triangle's plane
+		const P3 n = e[0] ^ e[1];
+		const double r = h[0]*std::fabs(n[0]) + h[1]*std::fabs(n[1]) + h[2]*std::fabs(n[2]);
+		return std::fabs(n*v[0])<=r;
+	}
+
+	MeshBVH::Hit MeshBVH::raycast(const Vec3& origin, const Vec3& dir, double maxDistance, double minDistance){
+		update();
+		Hit hit;
+		const double len = vcg::Norm(dir);
+		if (mNodes.empty() or len==0) return hit;
+
+		const MeshImpl& m = *mMesh->_constImpl();
+		const P3 o = origin;
+		const P3 d = dir/len;
+		const P3 invD(1.0/d[0],1.0/d[1],1.0/d[2]);
+
+		double best = maxDistance;
+		int bestFace = -1;
+		double t;
+		std::vector<int> stack;
+		stack.push_back(0);
+		while (!stack.empty()){
+			const Node& node = mNodes[stack.back()];
+			stack.pop_back();
+			if (!rayBox(node.box,o,invD,minDistance,best,t)) continue;
+
+			if (node.count>0){
+				for(int i=node.start;i<node.start+node.count;i++){
+					const FaceImpl& f = m.face[mFaces[i]];
+					double u, v;
+					if (rayTriangle(o,d,f.cP(0),f.cP(1),f.cP(2),t,u,v) and t>=minDistance and t<=best){
+						best = t;
+						bestFace = mFaces[i];
+						hit.u = u;
+						hit.v = v;
+					}
+				}
+				continue;
+			}
+
+			// visit the nearer child first
+			double tl, tr;
+			bool hl = rayBox(mNodes[node.left].box,o,invD,minDistance,best,tl);
+			bool hr = rayBox(mNodes[node.left+1].box,o,invD,minDistance,best,tr);
+			if (hl and hr){
+				if (tl<=tr){
+					stack.push_back(node.left+1);
+					stack.push_back(node.left);
+				}
+				else {
+					stack.push_back(node.left);
+					stack.push_back(node.left+1);
+				}
+			}
+			else if (hl) stack.push_back(node.left);
+			else if (hr) stack.push_back(node.left+1);
+		}
+
+		if (bestFace>=0){
+			hit.hit = true;
+			hit.distance = best;
+			hit.point = o + d*best;
+			hit.face = faceProxy(bestFace);
+		}
+		return hit;
+	}
+
+	MeshBVH::Hit MeshBVH::closestPoint(const Vec3& p, double maxDistance){
+		update();
+		Hit hit;
+		if (mNodes.empty()) return hit;
+
+		const MeshImpl& m = *mMesh->_constImpl();
+		double best = maxDistance<std::sqrt(std::numeric_limits<double>::max())?maxDistance*maxDistance:std::numeric_limits<double>::max();
+		int bestFace = -1;
+		std::vector<int> stack;
+		stack.push_back(0);
+		while (!stack.empty()){
+			const Node& node = mNodes[stack.back()];
+			stack.pop_back();
+			if (squaredDistance(node.box,p)>best) continue;
+
+			if (node.count>0){
+				for(int i=node.start;i<node.start+node.count;i++){
+					const FaceImpl& f = m.face[mFaces[i]];
+					double u, v;
+					P3 q = closestPointTriangle(p,f.cP(0),f.cP(1),f.cP(2),u,v);
+					double d2 = vcg::SquaredDistance(p,q);
+					if (d2<best or (d2==best and bestFace<0)){
+						best = d2;
+						bestFace = mFaces[i];
+						hit.point = q;
+						hit.u = u;
+						hit.v = v;
+					}
+				}
+				continue;
+			}
+
+			// visit the nearer child first
+			const double dl = squaredDistance(mNodes[node.left].box,p);
+			const double dr = squaredDistance(mNodes[node.left+1].box,p);
+			if (dl<=dr){
+				stack.push_back(node.left+1);
+				stack.push_back(node.left);
+			}
+			else {
+				stack.push_back(node.left);
+				stack.push_back(node.left+1);
+			}
+		}
+
+		if (bestFace>=0){
+			hit.hit = true;
+			hit.distance = std::sqrt(best);
+			hit.face = faceProxy(bestFace);
+		}
+		return hit;
+	}
+
+	void MeshBVH::candidates(const vcg::Box3d& box, std::vector<int>& faces) const {
+		if (mNodes.empty()) return;
+		std::vector<int> stack;
+		stack.push_back(0);
+		while (!stack.empty()){
+			const Node& node = mNodes[stack.back()];
+			stack.pop_back();
+			if (!overlaps(node.box,box)) continue;
+			if (node.count>0){
+				for(int i=node.start;i<node.start+node.count;i++) faces.push_back(mFaces[i]);
+			}
+			else {
+				stack.push_back(node.left+1);
+				stack.push_back(node.left);
+			}
+		}
+	}
+
+	void MeshBVH::overlapSphere(const Vec3& centre, double radius, Mesh::FaceSet& result){
+		update();
+		const MeshImpl& m = *mMesh->_constImpl();
+		std::vector<int> faces;
+		candidates(vcg::Box3d(centre,radius),faces);
+		for(unsigned int i=0;i<faces.size();i++){
+			const FaceImpl& f = m.face[faces[i]];
+			double u, v;
+			P3 q = closestPointTriangle(centre,f.cP(0),f.cP(1),f.cP(2),u,v);
+			if (vcg::SquaredDistance<double>(centre,q)<=radius*radius) result.push_back(faceProxy(faces[i]));
+		}
+	}
+
+	void MeshBVH::overlapBox(const Vec3& min, const Vec3& max, Mesh::FaceSet& result){
+		update();
+		const MeshImpl& m = *mMesh->_constImpl();
+		const vcg::Box3d box(min,max);
+		const P3 centre = box.Center();
+		const P3 h = box.Dim()/2.0;
+		std::vector<int> faces;
+		candidates(box,faces);
+		for(unsigned int i=0;i<faces.size();i++){
+			const FaceImpl& f = m.face[faces[i]];
+			if (triangleBoxOverlap(centre,h,f.cP(0),f.cP(1),f.cP(2))) result.push_back(faceProxy(faces[i]));
+		}
+	}
+
+	void MeshBVH::overlapTriangle(const Vec3& a, const Vec3& b, const Vec3& c, Mesh::FaceSet& result){
+		overlapTriangle(a,b,c,NULL,result);
+	}
+
+	void MeshBVH::overlapFace(boost::shared_ptr<FaceProxy> f, Mesh::FaceSet& result){
+		const FaceImpl& fi = f->constImpl();
+		const VertexImpl* ignore[3] = {fi.cV(0), fi.cV(1), fi.cV(2)};
+		overlapTriangle(fi.cP(0),fi.cP(1),fi.cP(2),ignore,result);
+	}
+
+	void MeshBVH::overlapTriangle(const Vec3& a, const Vec3& b, const Vec3& c, const VertexImpl* const* ignore, Mesh::FaceSet& result){
+		update();
+		const MeshImpl& m = *mMesh->_constImpl();
+		vcg::Box3d box;
+		box.Set(a);
+		box.Add(b);
+		box.Add(c);
+		std::vector<int> faces;
+		candidates(box,faces);
+		for(unsigned int i=0;i<faces.size();i++){
+			const FaceImpl& f = m.face[faces[i]];
+			if (ignore!=NULL){
+				bool shared = false;
+				for(int j=0;j<3;j++){
+					if (f.cV(j)==ignore[0] or f.cV(j)==ignore[1] or f.cV(j)==ignore[2]) shared = true;
+				}
+				if (shared) continue;
+			}
+			if (vcg::NoDivTriTriIsect<double>(f.cP(0),f.cP(1),f.cP(2),a,b,c)) result.push_back(faceProxy(faces[i]));
+		}
+	}
+}
@@ -0,0 +1,144 @@
+/**
+ * \file
+ * \brief A bounding volume hierarchy over the faces of a mesh
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_MESHBVH_H
+#define FG_MESHBVH_H
+
+#include <vector>
+#include <limits>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vcg/space/box3.h>
+
+#include "fg/vec3.h"
+#include "fg/mesh.h"
+
+namespace fg {
+	/**
+	 * \brief A bounding volume hierarchy (BVH) over the faces of a mesh, for
+	 * ray casts, closest point and overlap queries.
+	 *
+	 * The tree is built with binned SAH splits, the top levels are split first
+	 * and the resulting subtrees are built in parallel (see fg::Parallel).
+	 *
+	 * The BVH remembers the mesh versions it was built from. Each query first
+	 * calls update(), which rebuilds the tree if the mesh topology changed and
+	 * only refits the node bounds if just the vertex positions changed, so a
+	 * BVH can be kept around while a mesh grows.
+	 *
+	 * E.g.,
+	 * \code
+	 * local bvh = fg.bvh(m)
+	 * local h = bvh:raycast(v.p + v.n*0.001, v.n)
+	 * if h.hit then print(h.distance, h.face) end
+	 * \endcode
+	 */
+	class MeshBVH {
+	public:
+		/// \brief The result of a ray cast or closest point query
+		struct Hit {
+			Hit();
+
+			bool hit; ///< false if nothing was found, in which case the other fields are undefined
+			double distance; ///< distance from the ray origin or query point
+			Vec3 point; ///< the point on the face
+			boost::shared_ptr<FaceProxy> face;
+			double u, v; ///< barycentric coordinates of point, i.e., point = (1-u-v)*f.v(0) + u*f.v(1) + v*f.v(2)
+
+			// interface for lua bindings
+			bool getHit() const {return hit;}
+			double getDistance() const {return distance;}
+			Vec3 getPoint() const {return point;}
+			boost::shared_ptr<FaceProxy> getFace() const {return face;}
+			double getU() const {return u;}
+			double getV() const {return v;}
+		};
+
+		/// \brief Create a BVH over the faces of m. The tree is built lazily by the first query.
+		MeshBVH(boost::shared_ptr<Mesh> m);
+
+		/// \brief Rebuild if the topology changed since the last build, refit if only the geometry changed
+		void update();
+
+		/// \brief Rebuild the tree from scratch
+		void rebuild();
+
+		/**
+		 * \brief Find the nearest face hit by the ray origin + t*dir (dir needn't be unit length).
+		 * Faces are hit from either side. Only hits with minDistance <= distance <= maxDistance count.
+		 */
+		Hit raycast(const Vec3& origin, const Vec3& dir, double maxDistance = std::numeric_limits<double>::max(), double minDistance = 0);
+
+		/// \brief Find the point on the mesh closest to p, no further than maxDistance
+		Hit closestPoint(const Vec3& p, double maxDistance = std::numeric_limits<double>::max());
+
+		/// \brief Append the faces within radius of centre to result
+		void overlapSphere(const Vec3& centre, double radius, Mesh::FaceSet& result);
+
+		/// \brief Append the faces that intersect the box [min,max] to result
+		void overlapBox(const Vec3& min, const Vec3& max, Mesh::FaceSet& result);
+
+		/// \brief Append the faces that intersect the triangle abc to result
+		void overlapTriangle(const Vec3& a, const Vec3& b, const Vec3& c, Mesh::FaceSet& result);
+
+		/**
+		 * \brief Append the faces that intersect f to result, ignoring those that share
+		 * a vertex with it (they always touch). Useful for detecting self-intersection.
+		 */
+		void overlapFace(boost::shared_ptr<FaceProxy> f, Mesh::FaceSet& result);
+
+		/// \brief The number of nodes in the tree (0 before it is built)
+		int getNumNodes() const {return mNodes.size();}
+
+	private:
+		struct Node {
+			vcg::Box3d box;
+			int left; ///< interior nodes: index of the left child, the right is at left+1
+			int start; ///< leaves: index of the first face in mFaces
+			int count; ///< leaves: number of faces (0 for interior nodes)
+		};
+
+		struct BuildFace;
+		struct BuildTask;
+
+		static bool splitRange(BuildFace* faces, const BuildTask& t, int threads, BuildTask& left, BuildTask& right);
+		static void buildSubtree(BuildFace* faces, std::vector<Node>& nodes, const BuildTask& root);
+		void buildParallel(BuildFace* faces, const BuildTask& root, int threads);
+		void refit();
+		void candidates(const vcg::Box3d& box, std::vector<int>& faces) const;
+		void overlapTriangle(const Vec3& a, const Vec3& b, const Vec3& c, const VertexImpl* const* ignore, Mesh::FaceSet& result);
+		boost::shared_ptr<FaceProxy> faceProxy(int index) const;
+
+		boost::shared_ptr<Mesh> mMesh;
+		std::vector<Node> mNodes; ///< the root is mNodes[0], children always come after their parent
+		std::vector<int> mFaces; ///< face indices, in leaf order
+		bool mBuilt;
+		unsigned int mTopologyVersion; ///< the mesh versions the tree is up to date with
+		unsigned int mGeometryVersion;
+	};
+}
+
+#endif
@@ -24,6 +24,8 @@
 
 #include "fg/meshimpl.h"
 
+#include <algorithm>
+
 #include <vcg/complex/allocate.h>
 
 #include <vcg/complex/algorithms/update/bounding.h>
@@ -42,47 +44,47 @@ namespace fg {
 		return mNumBones;
 	}
 
-	void _copyMeshIntoMesh(MeshImpl& fm, MeshImpl& m){
-		vcg::tri::Allocator<MeshImpl>::AddVertices(m,fm.vert.size());
-		std::map<VertexImpl*,int> ptrMap;
-		for(int i=0;i<fm.vert.size();i++){
-			ptrMap[&fm.vert[i]] = i;
-
-			// m.vert[i] = fm.vert[i];
-
-			m.vert[i].P() = fm.vert[i].P();
-			m.vert[i].N() = fm.vert[i].N();
-			m.vert[i].C() = fm.vert[i].C();
-
-			// texcoords
-			m.vert[i].T().U() = fm.vert[i].T().U();
-			m.vert[i].T().V() = fm.vert[i].T().V();
+	/// Rebase p from the storage starting at from to the storage starting at to
+	template <typename T>
+	static inline T* rebase(T* p, const T* from, T* to){
+		return p==NULL?NULL:to + (p - from);
+	}
 
-			if (fm.vert[i].IsD()) m.vert[i].SetD();
+	void _copyMeshIntoMesh(MeshImpl& fm, MeshImpl& m){
+		// Copy the elements wholesale (attributes, flags, bones and adjacency),
+		// then point everything at the new storage. The adjacency is already
+		// correct so there's no need to recompute the topology.
+		m.vert = fm.vert;
+		m.face = fm.face;
+		m.vn = fm.vn;
+		m.fn = fm.fn;
+		m.bbox = fm.bbox;
+		if (m.vert.empty() or m.face.empty()) return;
+
+		const VertexImpl* fvbase = &fm.vert[0];
+		const FaceImpl* ffbase = &fm.face[0];
+		VertexImpl* vbase = &m.vert[0];
+		FaceImpl* fbase = &m.face[0];
+
+		const int nv = m.vert.size();
+		const int nf = m.face.size();
+		for(int i=0;i<nv;i++){
+			VertexImpl& v = m.vert[i];
+			v.VFp() = rebase(v.VFp(),ffbase,fbase);
 		}
-
-		vcg::tri::Allocator<MeshImpl>::AddFaces(m,fm.face.size());
-		for(int i=0;i<fm.face.size();i++){
-			FaceImpl* f = &m.face[i];
-			//*f = fm.face[i]; // Copy all attribs
-
-			// Then reassign verts
-			f->V(0) = &m.vert[ptrMap[fm.face[i].V(0)]];
-			f->V(1) = &m.vert[ptrMap[fm.face[i].V(1)]];
-			f->V(2) = &m.vert[ptrMap[fm.face[i].V(2)]];
-
-			if (fm.face[i].IsD()) f->SetD();
+		for(int i=0;i<nf;i++){
+			FaceImpl& f = m.face[i];
+			for(int j=0;j<3;j++){
+				f.V(j) = rebase(f.V(j),fvbase,vbase);
+				f.VFp(j) = rebase(f.VFp(j),ffbase,fbase);
+				f.FFp(j) = rebase(f.FFp(j),ffbase,fbase);
+			}
 		}
-
-		vcg::tri::UpdateTopology<MeshImpl>::VertexFace(m);
-		vcg::tri::UpdateTopology<MeshImpl>::FaceFace(m);
 	}
 
 	void _copyFloatMeshIntoMesh(_FloatMeshImpl& fm, MeshImpl& m){
 		vcg::tri::Allocator<MeshImpl>::AddVertices(m,fm.vert.size());
-		std::map<_FloatVertexImpl*,int> ptrMap;
 		for(int i=0;i<fm.vert.size();i++){
-			ptrMap[&fm.vert[i]] = i;
 			for(int c=0;c<3;c++){
 				m.vert[i].P()[c] = fm.vert[i].P()[c];
 				m.vert[i].N()[c] = fm.vert[i].N()[c];
@@ -94,14 +96,139 @@ namespace fg {
 		}
 
 		vcg::tri::Allocator<MeshImpl>::AddFaces(m,fm.face.size());
-		for(int i=0;i<fm.face.size();i++){
-			FaceImpl* f = &m.face[i];
-			f->V(0) = &m.vert[ptrMap[fm.face[i].V(0)]];
-			f->V(1) = &m.vert[ptrMap[fm.face[i].V(1)]];
-			f->V(2) = &m.vert[ptrMap[fm.face[i].V(2)]];
+		if (!fm.vert.empty()){
+			_FloatVertexImpl* fvbase = &fm.vert[0];
+			for(int i=0;i<fm.face.size();i++){
+				FaceImpl* f = &m.face[i];
+				for(int j=0;j<3;j++){
+					f->V(j) = &m.vert[fm.face[i].V(j) - fvbase];
+				}
+			}
 		}
 
 		vcg::tri::UpdateTopology<MeshImpl>::VertexFace(m);
 		vcg::tri::UpdateTopology<MeshImpl>::FaceFace(m);
 	}
+
+	void _reserve(MeshImpl& m, unsigned int vertices, unsigned int faces){
+		if (m.vert.size()+vertices>m.vert.capacity()){
+			// reserve copy constructs the elements (their assignment doesn't copy anything)
+			const VertexImpl* from = m.vert.empty()?NULL:&m.vert[0];
+			m.vert.reserve(std::max(m.vert.size()+vertices,2*m.vert.capacity()));
+			if (from!=NULL){
+				VertexImpl* to = &m.vert[0];
+				for(unsigned int i=0;i<m.face.size();i++){
+					FaceImpl& f = m.face[i];
+					if (f.IsD()) continue;
+					for(int j=0;j<3;j++) f.V(j) = rebase(f.V(j),from,to);
+				}
+			}
+		}
+		if (m.face.size()+faces>m.face.capacity()){
+			const FaceImpl* from = m.face.empty()?NULL:&m.face[0];
+			m.face.reserve(std::max(m.face.size()+faces,2*m.face.capacity()));
+			if (from!=NULL){
+				FaceImpl* to = &m.face[0];
+				for(unsigned int i=0;i<m.vert.size();i++){
+					VertexImpl& v = m.vert[i];
+					if (!v.IsD()) v.VFp() = rebase(v.VFp(),from,to);
+				}
+				for(unsigned int i=0;i<m.face.size();i++){
+					FaceImpl& f = m.face[i];
+					if (f.IsD()) continue;
+					for(int j=0;j<3;j++){
+						f.VFp(j) = rebase(f.VFp(j),from,to);
+						f.FFp(j) = rebase(f.FFp(j),from,to);
+					}
+				}
+			}
+		}
+	}
+
+	bool _checkTopology(MeshImpl& m, std::ostream& out){
+		if (m.face.empty()) return true;
+		const unsigned int nv = m.vert.size();
+		const unsigned int nf = m.face.size();
+		const VertexImpl* vbase = nv>0?&m.vert[0]:NULL;
+		const FaceImpl* fbase = &m.face[0];
+		int problems = 0;
+
+		// the faces using each vertex
+		std::vector<unsigned int> uses(nv,0);
+		for(unsigned int i=0;i<nf;i++){
+			FaceImpl& f = m.face[i];
+			if (f.IsD()) continue;
+			for(int j=0;j<3;j++){
+				const VertexImpl* v = f.cV(j);
+				if (v==NULL or v<vbase or v>=vbase+nv or v->IsD()){
+					out << "face " << i << ": vertex " << j << " is invalid\n";
+					problems++;
+				}
+				else uses[v-vbase]++;
+			}
+		}
+		if (problems>0) return false;
+
+		for(unsigned int i=0;i<nf;i++){
+			FaceImpl& f = m.face[i];
+			if (f.IsD()) continue;
+			for(int j=0;j<3;j++){
+				const FaceImpl* g = f.cFFp(j);
+				const int k = f.cFFi(j);
+				if (g==NULL or g<fbase or g>=fbase+nf or g->IsD() or k<0 or k>2){
+					out << "face " << i << ": edge " << j << " has an invalid neighbour\n";
+					problems++;
+				}
+				else if (g==&f){
+					if (k!=j){
+						out << "face " << i << ": border edge " << j << " points at edge " << k << "\n";
+						problems++;
+					}
+				}
+				else {
+					const VertexImpl* a = f.cV(j);
+					const VertexImpl* b = f.cV((j+1)%3);
+					const VertexImpl* c = g->cV(k);
+					const VertexImpl* d = g->cV((k+1)%3);
+					if (!((a==d and b==c) or (a==c and b==d))){
+						out << "face " << i << ": edge " << j << " isn't shared by its neighbour " << (g-fbase) << "\n";
+						problems++;
+					}
+					else if (g->cFFp(k)==&f and g->cFFi(k)!=j){
+						out << "face " << i << ": edge " << j << " and its neighbour " << (g-fbase) << " disagree\n";
+						problems++;
+					}
+				}
+			}
+		}
+
+		for(unsigned int i=0;i<nv;i++){
+			VertexImpl& v = m.vert[i];
+			if (v.IsD()) continue;
+			// stop after one too many, in case the list is a cycle
+			unsigned int n = 0;
+			FaceImpl* f = v.VFp();
+			int z = v.VFi();
+			while (f!=NULL and n<=uses[i]){
+				if (f<fbase or f>=fbase+nf or f->IsD() or z<0 or z>2 or f->cV(z)!=&v){
+					out << "vertex " << i << ": its VF list has a face that doesn't use it\n";
+					problems++;
+					break;
+				}
+				n++;
+				FaceImpl* next = f->VFp(z);
+				z = f->VFi(z);
+				f = next;
+			}
+			if (f==NULL and n!=uses[i]){
+				out << "vertex " << i << ": its VF list has " << n << " faces, it is used by " << uses[i] << "\n";
+				problems++;
+			}
+			else if (f!=NULL and n>uses[i]){
+				out << "vertex " << i << ": its VF list is too long (or a cycle)\n";
+				problems++;
+			}
+		}
+		return problems==0;
+	}
 }
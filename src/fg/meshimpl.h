@@ -28,6 +28,7 @@
 #ifndef FG_MESHIMPL_H
 #define FG_MESHIMPL_H
 
+#include <iostream>
 #include <vector>
 #include "fg/vec3.h"
 #include "fg/mesh.h"
@@ -134,8 +135,24 @@ namespace fg {
 		vcg::face::InfoOcf> {};
 	class _FloatMeshImpl: public vcg::tri::TriMesh< std::vector< _FloatVertexImpl>, std::vector< _FloatFaceImpl > > {};
 
-	void _copyMeshIntoMesh(MeshImpl& fm, MeshImpl& m);
+	void _copyMeshIntoMesh(MeshImpl& fm, MeshImpl& m); ///< m must be empty, copies everything including adjacency and bones
 	void _copyFloatMeshIntoMesh(_FloatMeshImpl& fm, MeshImpl& m);
+
+	/**
+	 * Make room for adding the given number of vertices and faces to m without moving the
+	 * existing ones, so pointers into m stay valid while they are added. If the storage has
+	 * to grow it grows geometrically and every pointer in m is fixed, like vcg's Allocator
+	 * does, so over many calls the fix-up is amortised.
+	 */
+	void _reserve(MeshImpl& m, unsigned int vertices, unsigned int faces);
+
+	/**
+	 * Check the FF and VF adjacency of m: each FF neighbour shares the edge (and points
+	 * back, unless the edge is non-manifold) and each vertex's VF list holds exactly the
+	 * faces that use it. Reports the problems to out. It visits the whole mesh, so the
+	 * operators only call it when built with FG_CHECK_TOPOLOGY defined.
+	 */
+	bool _checkTopology(MeshImpl& m, std::ostream& out = std::cerr);
 }
 
 #endif
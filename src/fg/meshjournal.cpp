@@ -0,0 +1,89 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/meshjournal.h"
+
+namespace fg {
+	// how many of the most recent entries are checked for a merge
+	static const int MERGE_WINDOW = 8;
+
+	MeshJournal::MeshJournal()
+	:mEntries()
+	,mStart(0)
+	,mMaxEntries(256)
+	,mEnabled(false)
+	{}
+
+	void MeshJournal::addVertices(unsigned int version, unsigned int begin, unsigned int end){
+		add(version,false,begin,end);
+	}
+
+	void MeshJournal::addFaces(unsigned int version, unsigned int begin, unsigned int end){
+		add(version,true,begin,end);
+	}
+
+	void MeshJournal::add(unsigned int version, bool face, unsigned int begin, unsigned int end){
+		if (!mEnabled or begin>=end) return;
+
+		// merge with a recent entry if possible
+		int last = (int)mEntries.size() - 1;
+		for(int i=last;i>=0 and i>last-MERGE_WINDOW;i--){
+			Entry& e = mEntries[i];
+			if (e.face==face and begin<=e.range.end and end>=e.range.begin){
+				if (begin<e.range.begin) e.range.begin = begin;
+				if (end>e.range.end) e.range.end = end;
+				e.version = version;
+				return;
+			}
+		}
+
+		if (mEntries.size()>=mMaxEntries){
+			// too fragmented to be useful
+			reset(version);
+			return;
+		}
+
+		Entry e;
+		e.version = version;
+		e.face = face;
+		e.range = Range(begin,end);
+		mEntries.push_back(e);
+	}
+
+	void MeshJournal::reset(unsigned int version){
+		mEntries.clear();
+		mStart = version;
+	}
+
+	bool MeshJournal::getChangesSince(unsigned int since, std::vector<Range>& vertices, std::vector<Range>& faces) const {
+		if (!mEnabled or since<mStart) return false;
+		for(unsigned int i=0;i<mEntries.size();i++){
+			const Entry& e = mEntries[i];
+			if (e.version<=since) continue;
+			if (e.face) faces.push_back(e.range);
+			else vertices.push_back(e.range);
+		}
+		return true;
+	}
+}
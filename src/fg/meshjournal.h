@@ -0,0 +1,91 @@
+/**
+ * \file
+ * \brief Records which parts of a mesh have been modified
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_MESHJOURNAL_H
+#define FG_MESHJOURNAL_H
+
+#include <vector>
+
+namespace fg {
+	/**
+	 * \brief A journal of the vertex and face index ranges that have changed in a mesh.
+	 *
+	 * Each entry is a range of indices into MeshImpl::vert or MeshImpl::face,
+	 * stamped with the mesh version (see Mesh::getVersion()) at which it last
+	 * changed. Overlapping or adjacent ranges are merged as they are added, so
+	 * e.g., setting the position of every vertex in order results in a single entry.
+	 *
+	 * Indices are only stable while the topology is unchanged, so Mesh resets
+	 * the journal whenever the topology changes.
+	 */
+	class MeshJournal {
+	public:
+		/// \brief A half-open range of indices [begin,end)
+		struct Range {
+			Range(unsigned int b = 0, unsigned int e = 0):begin(b),end(e){}
+			unsigned int begin;
+			unsigned int end;
+		};
+
+		MeshJournal();
+
+		inline bool isEnabled() const {return mEnabled;}
+		inline void setEnabled(bool e){mEnabled = e;}
+
+		/// \brief When there are more than this many entries the journal is reset (default 256)
+		inline void setMaxEntries(unsigned int n){mMaxEntries = n;}
+
+		void addVertices(unsigned int version, unsigned int begin, unsigned int end);
+		void addFaces(unsigned int version, unsigned int begin, unsigned int end);
+
+		/// \brief Forget all entries. Changes up to and including version can no longer be queried.
+		void reset(unsigned int version);
+
+		/**
+		 * \brief Collect the ranges that changed after version since.
+		 *
+		 * @return false if the journal doesn't go back that far (e.g., it was disabled,
+		 * overflowed or the topology changed), in which case the caller should assume
+		 * everything has changed.
+		 */
+		bool getChangesSince(unsigned int since, std::vector<Range>& vertices, std::vector<Range>& faces) const;
+
+	private:
+		struct Entry {
+			unsigned int version;
+			bool face;
+			Range range;
+		};
+
+		void add(unsigned int version, bool face, unsigned int begin, unsigned int end);
+
+		std::vector<Entry> mEntries;
+		unsigned int mStart; ///< the journal holds every change with a version > mStart
+		unsigned int mMaxEntries;
+		bool mEnabled;
+	};
+}
+
+#endif
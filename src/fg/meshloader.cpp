@@ -0,0 +1,855 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/meshloader.h"
+#include "fg/meshimpl.h"
+#include "fg/parallel.h"
+
+#include <vcg/complex/allocate.h>
+#include <wrap/ply/plylib.h>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fg {
+	/**
+	 * A read-only memory mapping of a whole file
+	 */
+	class MappedFile {
+	public:
+		MappedFile(const std::string& path);
+		~MappedFile();
+
+		const char* begin() const {return mData;}
+		const char* end() const {return mData+mSize;}
+		size_t size() const {return mSize;}
+
+	private:
+		// non-copyable
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+		const char* mData;
+		size_t mSize;
+	#ifdef WIN32
+		HANDLE mFile;
+		HANDLE mMapping;
+	#endif
+	};
+
+	#ifdef WIN32
+	MappedFile::MappedFile(const std::string& path)
+	:mData(NULL)
+	,mSize(0)
+	,mFile(INVALID_HANDLE_VALUE)
+	,mMapping(NULL)
+	{
+		mFile = CreateFileA(path.c_str(),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+		if (mFile==INVALID_HANDLE_VALUE) throw std::runtime_error("Can't open " + path);
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(mFile,&size)){
+			CloseHandle(mFile);
+			throw std::runtime_error("Can't read " + path);
+		}
+		mSize = size.QuadPart;
+		if (mSize==0) return;
+
+		mMapping = CreateFileMapping(mFile,NULL,PAGE_READONLY,0,0,NULL);
+		if (mMapping!=NULL) mData = (const char*) MapViewOfFile(mMapping,FILE_MAP_READ,0,0,0);
+		if (mData==NULL){
+			if (mMapping!=NULL) CloseHandle(mMapping);
+			CloseHandle(mFile);
+			throw std::runtime_error("Can't map " + path);
+		}
+	}
+
+	MappedFile::~MappedFile(){
+		if (mData!=NULL) UnmapViewOfFile(mData);
+		if (mMapping!=NULL) CloseHandle(mMapping);
+		CloseHandle(mFile);
+	}
+	#else
+	MappedFile::MappedFile(const std::string& path)
+	:mData(NULL)
+	,mSize(0)
+	{
+		int fd = open(path.c_str(),O_RDONLY);
+		if (fd<0) throw std::runtime_error("Can't open " + path);
+
+		struct stat st;
+		if (fstat(fd,&st)<0){
+			close(fd);
+			throw std::runtime_error("Can't read " + path);
+		}
+		mSize = st.st_size;
+		if (mSize>0){
+			void* p = mmap(NULL,mSize,PROT_READ,MAP_PRIVATE,fd,0);
+			if (p==MAP_FAILED){
+				close(fd);
+				throw std::runtime_error("Can't map " + path);
+			}
+			mData = (const char*) p;
+		}
+		close(fd);
+	}
+
+	MappedFile::~MappedFile(){
+		if (mData!=NULL) munmap((void*)mData,mSize);
+	}
+	#endif
+
+	// OBJ parsing
+	// NB: the mapped file isn't null-terminated so everything is bounded by end
+
+	static inline bool isSpace(char c){return c==' ' or c=='\t' or c=='\r';}
+	static inline bool isDigit(char c){return c>='0' and c<='9';}
+
+	static inline const char* skipSpace(const char* p, const char* end){
+		while (p<end and isSpace(*p)) p++;
+		return p;
+	}
+
+	/// The start of the next line
+	static inline const char* nextLine(const char* p, const char* end){
+		while (p<end and *p!='\n') p++;
+		return p<end?p+1:end;
+	}
+
+	/// Parse an int at p, advancing p past it
+	static inline bool parseInt(const char*& p, const char* end, int& out){
+		bool neg = false;
+		if (p<end and (*p=='-' or *p=='+')) neg = *p++=='-';
+		if (p>=end or !isDigit(*p)) return false;
+		int v = 0;
+		while (p<end and isDigit(*p)) v = v*10 + (*p++ - '0');
+		out = neg?-v:v;
+		return true;
+	}
+
+	/// Parse a number (e.g., -1.5e-3) at p, advancing p past it
+	static inline bool parseDouble(const char*& p, const char* end, double& out){
+		bool neg = false;
+		if (p<end and (*p=='-' or *p=='+')) neg = *p++=='-';
+		double mantissa = 0;
+		int exponent = 0, digits = 0;
+		while (p<end and isDigit(*p)){
+			mantissa = mantissa*10 + (*p++ - '0');
+			digits++;
+		}
+		if (p<end and *p=='.'){
+			p++;
+			while (p<end and isDigit(*p)){
+				mantissa = mantissa*10 + (*p++ - '0');
+				exponent--;
+				digits++;
+			}
+		}
+		if (digits==0) return false;
+		if (p<end and (*p=='e' or *p=='E')){
+			p++;
+			int e;
+			if (!parseInt(p,end,e)) return false;
+			exponent += e;
+		}
+		double v = exponent<0?mantissa/std::pow(10.,-exponent):mantissa*std::pow(10.,exponent);
+		out = neg?-v:v;
+		return true;
+	}
+
+	/// A contiguous range of lines of an OBJ file
+	struct OBJChunk {
+		const char* begin;
+		const char* end;
+		int numVertices, numTexCoords, numTriangles; // in this chunk
+		int vertexOffset, texCoordOffset, triangleOffset; // of the first element of this chunk
+		bool ok;
+	};
+
+	/// First pass: count the elements in a chunk
+	static void countOBJ(OBJChunk& c){
+		c.numVertices = c.numTexCoords = c.numTriangles = 0;
+		const char* end = c.end;
+		for(const char* p = c.begin;p<end;p = nextLine(p,end)){
+			p = skipSpace(p,end);
+			if (end-p<2) continue;
+			if (p[0]=='v' and isSpace(p[1])) c.numVertices++;
+			else if (p[0]=='v' and p[1]=='t' and end-p>2 and isSpace(p[2])) c.numTexCoords++;
+			else if (p[0]=='f' and isSpace(p[1])){
+				int n = 0;
+				p++;
+				while (true){
+					p = skipSpace(p,end);
+					if (p>=end or *p=='\n') break;
+					n++;
+					while (p<end and !isSpace(*p) and *p!='\n') p++;
+				}
+				if (n>=3) c.numTriangles += n-2;
+			}
+		}
+	}
+
+	/// Resolve a (1-based or negative relative) OBJ index
+	static inline int objIndex(int i, int count){
+		return i>0?i-1:count+i;
+	}
+
+	/**
+	 * Second pass: parse a chunk into its part of the mesh.
+	 * texCoords and cornerTexCoords (the texture coordinate index of each
+	 * triangle corner) are empty if the file has no texture coordinates.
+	 */
+	static void parseOBJ(OBJChunk& c, MeshImpl& m, std::vector<float>& texCoords, std::vector<int>& cornerTexCoords){
+		const int numVertices = m.vert.size(), numTexCoords = texCoords.size()/2;
+		int v = c.vertexOffset, t = c.texCoordOffset, f = c.triangleOffset;
+		std::vector<int> poly, polyTex;
+		const char* end = c.end;
+		c.ok = false;
+
+		for(const char* p = c.begin;p<end;p = nextLine(p,end)){
+			p = skipSpace(p,end);
+			if (end-p<2) continue;
+			if (p[0]=='v' and isSpace(p[1])){
+				// x y z [r g b [a]]
+				double x[7];
+				int n = 0;
+				p++;
+				while (n<7){
+					p = skipSpace(p,end);
+					if (!parseDouble(p,end,x[n])) break;
+					n++;
+				}
+				if (n<3) return;
+
+				VertexImpl& vert = m.vert[v++];
+				vert.P() = Vec3(x[0],x[1],x[2]);
+				vert.N() = Vec3(0,0,0);
+				vert.T().U() = vert.T().V() = 0; // unless the faces give it one
+				if (n>=6){
+					// as vcg's importer, colours may be in [0,1] or [0,255]
+					double scale = (x[3]<=1 and x[4]<=1 and x[5]<=1)?255:1;
+					double alpha = n>=7?x[6]:1;
+					vert.C() = vcg::Color4b(
+						(unsigned char)(x[3]*scale),(unsigned char)(x[4]*scale),
+						(unsigned char)(x[5]*scale),(unsigned char)(alpha*scale));
+				}
+				else {
+					vert.C() = vcg::Color4b::LightGray;
+				}
+			}
+			else if (p[0]=='v' and p[1]=='t' and end-p>2 and isSpace(p[2])){
+				double uv[2] = {0,0};
+				p += 2;
+				for(int k=0;k<2;k++){
+					p = skipSpace(p,end);
+					if (!parseDouble(p,end,uv[k]) and k==0) return;
+				}
+				texCoords[2*t] = uv[0];
+				texCoords[2*t+1] = uv[1];
+				t++;
+			}
+			else if (p[0]=='f' and isSpace(p[1])){
+				// v, v/vt, v//vn or v/vt/vn
+				poly.clear();
+				polyTex.clear();
+				p++;
+				while (true){
+					p = skipSpace(p,end);
+					if (p>=end or *p=='\n') break;
+
+					int i, ti = 0;
+					if (!parseInt(p,end,i)) return;
+					i = objIndex(i,v);
+					if (i<0 or i>=numVertices) return;
+					poly.push_back(i);
+
+					if (p<end and *p=='/'){
+						p++;
+						if (p<end and *p!='/' and !parseInt(p,end,ti)) return;
+					}
+					if (ti!=0){
+						ti = objIndex(ti,t);
+						if (ti<0 or ti>=numTexCoords) return;
+					}
+					else ti = -1;
+					polyTex.push_back(ti);
+
+					// skip the normal
+					while (p<end and !isSpace(*p) and *p!='\n') p++;
+				}
+
+				// triangulate as a fan
+				for(int k=1;k+1<(int)poly.size();k++,f++){
+					FaceImpl& face = m.face[f];
+					face.V(0) = &m.vert[poly[0]];
+					face.V(1) = &m.vert[poly[k]];
+					face.V(2) = &m.vert[poly[k+1]];
+					if (!cornerTexCoords.empty()){
+						cornerTexCoords[3*f] = polyTex[0];
+						cornerTexCoords[3*f+1] = polyTex[k];
+						cornerTexCoords[3*f+2] = polyTex[k+1];
+					}
+				}
+			}
+		}
+		c.ok = true;
+	}
+
+	void MeshLoader::loadOBJ(const std::string& path, MeshImpl& m){
+		MappedFile file(path);
+
+		// split the file into chunks of whole lines
+		const int threads = Parallel::threadsFor(file.size()/32);
+		const int numChunks = threads>1?4*threads:1;
+		std::vector<OBJChunk> chunks(numChunks);
+		const char* p = file.begin();
+		for(int i=0;i<numChunks;i++){
+			chunks[i].begin = p;
+			if (i==numChunks-1) p = file.end();
+			else {
+				const char* target = file.begin() + (file.size()*(i+1))/numChunks;
+				if (target>p) p = nextLine(target,file.end());
+			}
+			chunks[i].end = p;
+		}
+
+		#pragma omp parallel for num_threads(threads) schedule(dynamic)
+		for(int i=0;i<numChunks;i++){
+			countOBJ(chunks[i]);
+		}
+
+		int numVertices = 0, numTexCoords = 0, numTriangles = 0;
+		for(int i=0;i<numChunks;i++){
+			OBJChunk& c = chunks[i];
+			c.vertexOffset = numVertices;
+			c.texCoordOffset = numTexCoords;
+			c.triangleOffset = numTriangles;
+			numVertices += c.numVertices;
+			numTexCoords += c.numTexCoords;
+			numTriangles += c.numTriangles;
+		}
+
+		vcg::tri::Allocator<MeshImpl>::AddVertices(m,numVertices);
+		vcg::tri::Allocator<MeshImpl>::AddFaces(m,numTriangles);
+		std::vector<float> texCoords(2*numTexCoords);
+		std::vector<int> cornerTexCoords(numTexCoords>0?3*numTriangles:0,-1);
+
+		#pragma omp parallel for num_threads(threads) schedule(dynamic)
+		for(int i=0;i<numChunks;i++){
+			parseOBJ(chunks[i],m,texCoords,cornerTexCoords);
+		}
+		for(int i=0;i<numChunks;i++){
+			if (!chunks[i].ok) throw std::runtime_error("Malformed OBJ file " + path);
+		}
+
+		// OBJ texture coordinates are per corner, as with vcg's importer the last one wins
+		for(unsigned int i=0;i<cornerTexCoords.size();i++){
+			const int t = cornerTexCoords[i];
+			if (t<0) continue;
+			VertexImpl* v = m.face[i/3].V(i%3);
+			v->T().U() = texCoords[2*t];
+			v->T().V() = texCoords[2*t+1];
+		}
+	}
+
+	// PLY parsing
+
+	struct PLYVertex {
+		double p[3];
+		unsigned char c[4];
+		float uv[2];
+	};
+
+	struct PLYFace {
+		int* v; ///< allocated by plylib
+		int n;
+	};
+
+	/// Read a scalar property, whatever its type in the file
+	static bool plyAddToRead(vcg::ply::PlyFile& pf, const char* elem, const char* prop, int memtype, size_t offset){
+		for(unsigned int i=0;i<pf.elements.size();i++){
+			if (pf.elements[i].name!=elem) continue;
+			vcg::ply::PlyProperty* p = pf.elements[i].FindProp(prop);
+			if (p==NULL or p->islist) return false;
+			return pf.AddToRead(elem,prop,p->tipo,memtype,offset,0,0,0,0,0)!=-1;
+		}
+		return false;
+	}
+
+	/// Read a list property of ints, whatever its type in the file
+	static bool plyAddListToRead(vcg::ply::PlyFile& pf, const char* elem, const char* prop, size_t offset, size_t countOffset){
+		for(unsigned int i=0;i<pf.elements.size();i++){
+			if (pf.elements[i].name!=elem) continue;
+			vcg::ply::PlyProperty* p = pf.elements[i].FindProp(prop);
+			if (p==NULL or !p->islist) return false;
+			return pf.AddToRead(elem,prop,p->tipo,vcg::ply::T_INT,offset,1,1,p->tipoindex,vcg::ply::T_INT,countOffset)!=-1;
+		}
+		return false;
+	}
+
+	void MeshLoader::loadPLY(const std::string& path, MeshImpl& m){
+		using namespace vcg::ply;
+
+		PlyFile pf;
+		if (pf.Open(path.c_str(),PlyFile::MODE_READ)==-1) throw std::runtime_error("Can't open " + path);
+
+		if (!plyAddToRead(pf,"vertex","x",T_DOUBLE,offsetof(PLYVertex,p)) or
+			!plyAddToRead(pf,"vertex","y",T_DOUBLE,offsetof(PLYVertex,p)+sizeof(double)) or
+			!plyAddToRead(pf,"vertex","z",T_DOUBLE,offsetof(PLYVertex,p)+2*sizeof(double))){
+			throw std::runtime_error("PLY file has no vertex positions " + path);
+		}
+		bool colour =
+			plyAddToRead(pf,"vertex","red",T_UCHAR,offsetof(PLYVertex,c)) and
+			plyAddToRead(pf,"vertex","green",T_UCHAR,offsetof(PLYVertex,c)+1) and
+			plyAddToRead(pf,"vertex","blue",T_UCHAR,offsetof(PLYVertex,c)+2);
+		bool alpha = colour and plyAddToRead(pf,"vertex","alpha",T_UCHAR,offsetof(PLYVertex,c)+3);
+		bool tex =
+			(plyAddToRead(pf,"vertex","s",T_FLOAT,offsetof(PLYVertex,uv)) and
+			 plyAddToRead(pf,"vertex","t",T_FLOAT,offsetof(PLYVertex,uv)+sizeof(float))) or
+			(plyAddToRead(pf,"vertex","texture_u",T_FLOAT,offsetof(PLYVertex,uv)) and
+			 plyAddToRead(pf,"vertex","texture_v",T_FLOAT,offsetof(PLYVertex,uv)+sizeof(float)));
+		if (!plyAddListToRead(pf,"face","vertex_indices",offsetof(PLYFace,v),offsetof(PLYFace,n)))
+			plyAddListToRead(pf,"face","vertex_index",offsetof(PLYFace,v),offsetof(PLYFace,n));
+
+		// the faces, triangulated as fans
+		std::vector<int> triangles;
+
+		PLYVertex pv;
+		pv.c[3] = 255;
+		PLYFace pface;
+		for(unsigned int e=0;e<pf.elements.size();e++){
+			const int n = pf.ElemNumber(e);
+			pf.SetCurElement(e);
+			if (!strcmp(pf.ElemName(e),"vertex")){
+				vcg::tri::Allocator<MeshImpl>::AddVertices(m,n);
+				for(int i=0;i<n;i++){
+					if (pf.Read(&pv)==-1) throw std::runtime_error("PLY file is too short " + path);
+					VertexImpl& v = m.vert[i];
+					v.P() = Vec3(pv.p[0],pv.p[1],pv.p[2]);
+					v.N() = Vec3(0,0,0);
+					v.C() = colour?vcg::Color4b(pv.c[0],pv.c[1],pv.c[2],alpha?pv.c[3]:255):vcg::Color4b::LightGray;
+					v.T().U() = tex?pv.uv[0]:0;
+					v.T().V() = tex?pv.uv[1]:0;
+				}
+			}
+			else if (!strcmp(pf.ElemName(e),"face")){
+				triangles.reserve(3*n);
+				for(int i=0;i<n;i++){
+					pface.v = NULL;
+					pface.n = 0;
+					if (pf.Read(&pface)==-1){
+						free(pface.v);
+						throw std::runtime_error("PLY file is too short " + path);
+					}
+					for(int k=1;k+1<pface.n;k++){
+						triangles.push_back(pface.v[0]);
+						triangles.push_back(pface.v[k]);
+						triangles.push_back(pface.v[k+1]);
+					}
+					free(pface.v);
+				}
+			}
+			else {
+				// skip
+				for(int i=0;i<n;i++){
+					if (pf.Read(&pv)==-1) throw std::runtime_error("PLY file is too short " + path);
+				}
+			}
+		}
+
+		const int numVertices = m.vert.size();
+		for(unsigned int i=0;i<triangles.size();i++){
+			if (triangles[i]<0 or triangles[i]>=numVertices) throw std::runtime_error("PLY file has a bad vertex index " + path);
+		}
+
+		const int numTriangles = triangles.size()/3;
+		vcg::tri::Allocator<MeshImpl>::AddFaces(m,numTriangles);
+		const int threads = Parallel::threadsFor(numTriangles);
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<numTriangles;i++){
+			for(int k=0;k<3;k++){
+				m.face[i].V(k) = &m.vert[triangles[3*i+k]];
+			}
+		}
+	}
+
+	// FGM cache
+
+	static const char FGM_MAGIC[4] = {'F','G','M','\0'};
+	static const unsigned int FGM_VERSION = 1;
+	static const unsigned int FGM_ENDIAN = 0x01020304; ///< caches written on a machine with the other byte order are rejected
+
+	/// Identifies the file a cache was made from
+	struct FGMSource {
+		FGMSource():size(0),time(0),hash(0){}
+		double size;
+		double time; ///< last write time
+		unsigned int hash; ///< of the first and last 64KB
+	};
+
+	/// The header of an .fgm file, followed by the arrays in FGMLayout
+	struct FGMHeader {
+		char magic[4];
+		unsigned int version;
+		unsigned int endian;
+		unsigned int numVertices;
+		unsigned int numFaces;
+		unsigned int sourceHash;
+		double sourceSize;
+		double sourceTime;
+	};
+
+	/**
+	 * The byte offsets of the arrays in an .fgm file. Each is 8-byte aligned.
+	 * Positions and texture coordinates are kept as doubles so a cached mesh is
+	 * identical to a loaded one, normals are floats as Mesh::sync() recomputes them.
+	 * Adjacency is stored as element indices (-1 for none) and edge/corner numbers.
+	 */
+	struct FGMLayout {
+		FGMLayout(unsigned int nv, unsigned int nf){
+			size_t o = sizeof(FGMHeader);
+			positions = o; o = align(o + 3*nv*sizeof(double));
+			normals = o; o = align(o + 3*nv*sizeof(float));
+			texCoords = o; o = align(o + 2*nv*sizeof(double));
+			colours = o; o = align(o + 4*nv);
+			vertexVF = o; o = align(o + nv*sizeof(int));
+			vertexVFi = o; o = align(o + nv);
+			faces = o; o = align(o + 3*nf*sizeof(int));
+			faceFF = o; o = align(o + 3*nf*sizeof(int));
+			faceFFi = o; o = align(o + 3*nf);
+			faceVF = o; o = align(o + 3*nf*sizeof(int));
+			faceVFi = o; o = align(o + 3*nf);
+			size = o;
+		}
+		static size_t align(size_t o){return (o+7)&~(size_t)7;}
+
+		size_t positions, normals, texCoords, colours, vertexVF, vertexVFi;
+		size_t faces, faceFF, faceFFi, faceVF, faceVFi;
+		size_t size;
+	};
+
+	static FGMSource stampSource(const std::string& path){
+		FGMSource s;
+		s.size = boost::filesystem::file_size(boost::filesystem::path(path));
+		s.time = boost::filesystem::last_write_time(boost::filesystem::path(path));
+
+		// FNV-1a
+		const size_t window = 64*1024;
+		std::vector<unsigned char> buffer(window);
+		unsigned int h = 2166136261u;
+		FILE* f = fopen(path.c_str(),"rb");
+		if (f!=NULL){
+			size_t n = fread(&buffer[0],1,window,f);
+			for(size_t i=0;i<n;i++) h = (h^buffer[i])*16777619u;
+			if (s.size>2*window and fseek(f,-(long)window,SEEK_END)==0){
+				n = fread(&buffer[0],1,window,f);
+				for(size_t i=0;i<n;i++) h = (h^buffer[i])*16777619u;
+			}
+			fclose(f);
+		}
+		s.hash = h;
+		return s;
+	}
+
+	template <typename T>
+	static inline T* at(char* base, size_t offset){return (T*)(base+offset);}
+
+	template <typename T>
+	static inline const T* at(const char* base, size_t offset){return (const T*)(base+offset);}
+
+	static bool writeFGM(const std::string& path, const MeshImpl& cm, const FGMSource& source){
+		// NB: vcg's VFAdj components have no const accessors for the VF indices
+		// (the empty defaults return 0), so go through the non-const ones
+		MeshImpl& m = const_cast<MeshImpl&>(cm);
+		const int nv = m.vert.size(), nf = m.face.size();
+		if (m.vn!=nv or m.fn!=nf) return false; // not compact
+
+		FGMLayout layout(nv,nf);
+		std::vector<char> data(layout.size,0);
+		char* base = &data[0];
+
+		FGMHeader& header = *at<FGMHeader>(base,0);
+		memcpy(header.magic,FGM_MAGIC,4);
+		header.version = FGM_VERSION;
+		header.endian = FGM_ENDIAN;
+		header.numVertices = nv;
+		header.numFaces = nf;
+		header.sourceHash = source.hash;
+		header.sourceSize = source.size;
+		header.sourceTime = source.time;
+
+		const VertexImpl* v0 = nv>0?&m.vert[0]:NULL;
+		const FaceImpl* f0 = nf>0?&m.face[0]:NULL;
+		const int threads = Parallel::threadsFor(nf>nv?nf:nv);
+
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<nv;i++){
+			VertexImpl& v = m.vert[i];
+			for(int k=0;k<3;k++){
+				at<double>(base,layout.positions)[3*i+k] = v.P()[k];
+				at<float>(base,layout.normals)[3*i+k] = v.N()[k];
+				at<unsigned char>(base,layout.colours)[4*i+k] = v.C()[k];
+			}
+			at<unsigned char>(base,layout.colours)[4*i+3] = v.C()[3];
+			at<double>(base,layout.texCoords)[2*i] = v.T().U();
+			at<double>(base,layout.texCoords)[2*i+1] = v.T().V();
+			at<int>(base,layout.vertexVF)[i] = v.VFp()!=NULL?v.VFp()-f0:-1;
+			at<signed char>(base,layout.vertexVFi)[i] = v.VFi();
+		}
+
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<nf;i++){
+			FaceImpl& f = m.face[i];
+			for(int k=0;k<3;k++){
+				at<int>(base,layout.faces)[3*i+k] = f.V(k)-v0;
+				at<int>(base,layout.faceFF)[3*i+k] = f.FFp(k)!=NULL?f.FFp(k)-f0:-1;
+				at<signed char>(base,layout.faceFFi)[3*i+k] = f.FFi(k);
+				at<int>(base,layout.faceVF)[3*i+k] = f.VFp(k)!=NULL?f.VFp(k)-f0:-1;
+				at<signed char>(base,layout.faceVFi)[3*i+k] = f.VFi(k);
+			}
+		}
+
+		// write to a temporary and rename so a half-written cache is never read
+		std::string tmp = path + ".tmp";
+		FILE* file = fopen(tmp.c_str(),"wb");
+		if (file==NULL) return false;
+		bool ok = fwrite(base,1,data.size(),file)==data.size();
+		ok = fclose(file)==0 and ok;
+		try {
+			if (ok){
+				if (boost::filesystem::exists(path)) boost::filesystem::remove(path);
+				boost::filesystem::rename(tmp,path);
+			}
+			else boost::filesystem::remove(tmp);
+		}
+		catch(boost::filesystem::filesystem_error&){
+			return false;
+		}
+		return ok;
+	}
+
+	/**
+	 * Read a mapped .fgm file into m (which must be empty).
+	 * If source is given the cache must have been made from it.
+	 * @return false if the file is stale or corrupt (m is left empty)
+	 */
+	static bool readFGM(const MappedFile& file, MeshImpl& m, const FGMSource* source){
+		if (file.size()<sizeof(FGMHeader)) return false;
+
+		const char* base = file.begin();
+		FGMHeader header;
+		memcpy(&header,base,sizeof(FGMHeader));
+		if (memcmp(header.magic,FGM_MAGIC,4)!=0 or header.version!=FGM_VERSION or header.endian!=FGM_ENDIAN) return false;
+		if (source!=NULL and (header.sourceSize!=source->size or header.sourceTime!=source->time or header.sourceHash!=source->hash)) return false;
+
+		FGMLayout layout(header.numVertices,header.numFaces);
+		if (layout.size!=file.size()) return false;
+		const int nv = header.numVertices, nf = header.numFaces;
+
+		vcg::tri::Allocator<MeshImpl>::AddVertices(m,nv);
+		vcg::tri::Allocator<MeshImpl>::AddFaces(m,nf);
+		VertexImpl* v0 = nv>0?&m.vert[0]:NULL;
+		FaceImpl* f0 = nf>0?&m.face[0]:NULL;
+		const int threads = Parallel::threadsFor(nf>nv?nf:nv);
+		int bad = 0;
+
+		#pragma omp parallel for num_threads(threads) schedule(static) reduction(|:bad)
+		for(int i=0;i<nv;i++){
+			VertexImpl& v = m.vert[i];
+			const double* p = at<double>(base,layout.positions) + 3*i;
+			const float* n = at<float>(base,layout.normals) + 3*i;
+			const unsigned char* c = at<unsigned char>(base,layout.colours) + 4*i;
+			v.P() = Vec3(p[0],p[1],p[2]);
+			v.N() = Vec3(n[0],n[1],n[2]);
+			v.C() = vcg::Color4b(c[0],c[1],c[2],c[3]);
+			v.T().U() = at<double>(base,layout.texCoords)[2*i];
+			v.T().V() = at<double>(base,layout.texCoords)[2*i+1];
+
+			const int vf = at<int>(base,layout.vertexVF)[i];
+			const int vfi = at<signed char>(base,layout.vertexVFi)[i];
+			bad |= vf<-1 or vf>=nf or (vf>=0 and (vfi<0 or vfi>2));
+			v.VFp() = vf>=0?f0+vf:NULL;
+			v.VFi() = vfi;
+		}
+
+		#pragma omp parallel for num_threads(threads) schedule(static) reduction(|:bad)
+		for(int i=0;i<nf;i++){
+			FaceImpl& f = m.face[i];
+			for(int k=0;k<3;k++){
+				const int vi = at<int>(base,layout.faces)[3*i+k];
+				const int ff = at<int>(base,layout.faceFF)[3*i+k];
+				const int vf = at<int>(base,layout.faceVF)[3*i+k];
+				const int ffi = at<signed char>(base,layout.faceFFi)[3*i+k];
+				const int vfi = at<signed char>(base,layout.faceVFi)[3*i+k];
+				bad |= vi<0 or vi>=nv or ff<-1 or ff>=nf or vf<-1 or vf>=nf or ffi<0 or ffi>2 or (vf>=0 and (vfi<0 or vfi>2));
+				if (bad) continue;
+				f.V(k) = v0+vi;
+				f.FFp(k) = ff>=0?f0+ff:NULL;
+				f.FFi(k) = ffi;
+				f.VFp(k) = vf>=0?f0+vf:NULL;
+				f.VFi(k) = vfi;
+			}
+		}
+
+		if (bad){
+			m.Clear();
+			return false;
+		}
+		return true;
+	}
+
+	static bool readFGM(const std::string& path, MeshImpl& m, const FGMSource* source){
+		if (!boost::filesystem::exists(path)) return false;
+		try {
+			MappedFile file(path);
+			return readFGM(file,m,source);
+		}
+		catch(std::runtime_error&){
+			return false;
+		}
+	}
+
+	bool MeshLoader::sCacheEnabled = true;
+
+	void MeshLoader::setCacheEnabled(bool enabled){
+		sCacheEnabled = enabled;
+	}
+
+	bool MeshLoader::getCacheEnabled(){
+		return sCacheEnabled;
+	}
+
+	bool MeshLoader::saveFGM(const std::string& path, const MeshImpl& m){
+		return writeFGM(path,m,FGMSource());
+	}
+
+	bool MeshLoader::canLoad(const std::string& path){
+		std::string::size_type dot = path.rfind('.');
+		if (dot==std::string::npos) return false;
+		std::string ext = path.substr(dot+1);
+		std::transform(ext.begin(),ext.end(),ext.begin(),::tolower);
+		return ext=="obj" or ext=="ply" or ext=="fgm";
+	}
+
+	void MeshLoader::load(const std::string& path, MeshImpl& m){
+		std::string::size_type dot = path.rfind('.');
+		std::string ext = dot==std::string::npos?"":path.substr(dot+1);
+		std::transform(ext.begin(),ext.end(),ext.begin(),::tolower);
+
+		if (ext=="fgm"){
+			if (!readFGM(path,m,NULL)) throw std::runtime_error("Bad fgm file " + path);
+			return;
+		}
+
+		const std::string cache = path + ".fgm";
+		FGMSource source;
+		if (sCacheEnabled and boost::filesystem::exists(path)){
+			source = stampSource(path);
+			if (readFGM(cache,m,&source)) return;
+		}
+
+		if (ext=="obj") loadOBJ(path,m);
+		else if (ext=="ply") loadPLY(path,m);
+		else throw std::runtime_error("Unsupported mesh format " + path);
+
+		buildTopology(m);
+
+		// failing to write the cache (e.g., a read-only directory) isn't an error
+		if (sCacheEnabled) writeFGM(cache,m,source);
+	}
+
+	void MeshLoader::buildTopology(MeshImpl& m){
+		const int nv = m.vert.size(), nf = m.face.size();
+
+		// VF: each vertex heads a list of its faces, in reverse order (as UpdateTopology::VertexFace)
+		for(int i=0;i<nv;i++){
+			m.vert[i].VFp() = NULL;
+			m.vert[i].VFi() = 0;
+		}
+		for(int i=0;i<nf;i++){
+			FaceImpl& f = m.face[i];
+			if (f.IsD()) continue;
+			for(int j=0;j<3;j++){
+				VertexImpl* v = f.V(j);
+				f.VFp(j) = v->VFp();
+				f.VFi(j) = v->VFi();
+				v->VFp() = &f;
+				v->VFi() = j;
+			}
+		}
+
+		// FF: the faces sharing each edge are found by walking the VF list of
+		// one of its vertices. Each face only writes its own links so this can
+		// run in parallel. Non-manifold edges get a ring of faces ordered by
+		// index, as UpdateTopology::FaceFace does.
+		const int threads = Parallel::threadsFor(nf);
+		#pragma omp parallel num_threads(threads)
+		{
+			std::vector<std::pair<FaceImpl*,int> > ring;
+
+			#pragma omp for schedule(static)
+			for(int i=0;i<nf;i++){
+				FaceImpl& f = m.face[i];
+				if (f.IsD()) continue;
+				for(int z=0;z<3;z++){
+					VertexImpl* v0 = f.V(z);
+					VertexImpl* v1 = f.V((z+1)%3);
+					ring.clear();
+					for(vcg::face::VFIterator<FaceImpl> vfi(v0);!vfi.End();++vfi){
+						FaceImpl* g = vfi.F();
+						const int j = vfi.I();
+						if (g->V((j+1)%3)==v1) ring.push_back(std::make_pair(g,j));
+						else if (g->V((j+2)%3)==v1) ring.push_back(std::make_pair(g,(j+2)%3));
+					}
+					std::sort(ring.begin(),ring.end());
+
+					// the next face after f in the ring
+					unsigned int k = 0;
+					while (k<ring.size() and !(ring[k].first==&f and ring[k].second==z)) k++;
+					const std::pair<FaceImpl*,int>& next = ring[(k+1)%ring.size()];
+					f.FFp(z) = next.first;
+					f.FFi(z) = next.second;
+				}
+			}
+		}
+	}
+}
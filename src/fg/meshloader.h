@@ -0,0 +1,86 @@
+/**
+ * \file
+ * \brief Fast loading of OBJ and PLY files
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_MESHLOADER_H
+#define FG_MESHLOADER_H
+
+#include <string>
+
+namespace fg {
+	// forward decl
+	class MeshImpl;
+
+	/**
+	 * \brief Loads OBJ and PLY files straight into a MeshImpl.
+	 *
+	 * OBJ files are memory-mapped and parsed in parallel chunks: a first pass
+	 * counts the elements in each chunk so the mesh can be sized up front, a
+	 * second pass parses each chunk into its slice of the mesh. PLY files
+	 * (ascii or binary) are read with plylib. The VF and FF adjacency is built
+	 * from the loaded faces without the sorting vcg's UpdateTopology does.
+	 *
+	 * Polygons are triangulated as fans. Vertex colours and texture
+	 * coordinates are kept (or light gray and zero if the file has none),
+	 * normals are zeroed (Mesh::sync() recomputes them).
+	 *
+	 * Loaded meshes are cached next to their source as binary .fgm files
+	 * (e.g., blob.obj.fgm) holding the vertex data, faces and adjacency, so the
+	 * next load is a memory map and a copy. A cache is only used if the size,
+	 * modification time and a hash of the start and end of the source match
+	 * those it was made from, otherwise it is rebuilt.
+	 */
+	class MeshLoader {
+	public:
+		/// \brief True if the file's extension is one the loader reads (.obj, .ply or .fgm)
+		static bool canLoad(const std::string& path);
+
+		/// \brief Enable or disable the .fgm cache (enabled by default)
+		static void setCacheEnabled(bool enabled);
+		static bool getCacheEnabled();
+
+		/**
+		 * \brief Write m (including its adjacency) as an .fgm file.
+		 * @return false if the file couldn't be written or m has deleted elements
+		 */
+		static bool saveFGM(const std::string& path, const MeshImpl& m);
+
+		/**
+		 * \brief Load the file into m, which must be empty.
+		 * Throws std::runtime_error if the file can't be read or is malformed.
+		 */
+		static void load(const std::string& path, MeshImpl& m);
+
+		/// \brief Build the VF and FF adjacency of m (equivalent to UpdateTopology's VertexFace and FaceFace)
+		static void buildTopology(MeshImpl& m);
+
+	private:
+		static void loadOBJ(const std::string& path, MeshImpl& m);
+		static void loadPLY(const std::string& path, MeshImpl& m);
+
+		static bool sCacheEnabled;
+	};
+}
+
+#endif
@@ -25,6 +25,12 @@
 #include "fg/meshoperators.h"
 #include "fg/meshoperators_vcg.h"
 #include "fg/meshimpl.h"
+#include "fg/nring.h"
+#include "fg/functions.h"
+#include "fg/parallel.h"
+
+#include <algorithm>
+#include <stdexcept>
 
 #include <vcg/simplex/vertex/base.h>
 #include <vcg/simplex/vertex/component_ocf.h>
@@ -33,164 +39,209 @@
 #include <vcg/simplex/face/pos.h>
 #include <vcg/complex/complex.h>
 #include <vcg/complex/allocate.h>
-#include <vcg/complex/algorithms/nring.h>
 #include <vcg/complex/algorithms/update/topology.h>
 #include <vcg/complex/algorithms/update/color.h>
 
 namespace fg {
 	void extrude(Mesh* m, VertexProxy v, double distance){
-		Extrude::VPUpdateList vpul = m->_vpl()->getUpdateList();
-		Extrude::FPUpdateList fpul = m->_fpl()->getUpdateList();
-
+		// detach first, so the vertex is resolved in the mesh being changed
+		MeshImpl* mesh = m->_impl();
 		VertexImpl* impl = v.pImpl();
 		Extrude::extrude(
 				// static_cast<Extrude::MyMesh*>(m->impl()),
-				m->_impl(),
+				mesh,
 				// static_cast<Extrude::Vertex*&>(),
 				impl,
-				vpul,
-				fpul,
 				1,
 				static_cast<vcg::Point3d>(v.pImpl()->N()),
 				distance);
 		//,0.);
+		m->_touchTopology();
 	}
 
 	void extrude(Mesh* m, VertexProxy v, int width, Vec3 direction, double length, double expand){
-		Extrude::VPUpdateList vpul = m->_vpl()->getUpdateList();
-		Extrude::FPUpdateList fpul = m->_fpl()->getUpdateList();
+		MeshImpl* mesh = m->_impl();
 		VertexImpl* impl = v.pImpl();
 		Extrude::extrude(
-				m->_impl(),
+				mesh,
 				impl,
-				vpul,
-				fpul,
 				width,
 				static_cast<vcg::Point3d>(direction),
 				length,
 				expand);
+		m->_touchTopology();
 	}
 
 	void extrude(Mesh* m, VertexProxy v, int w, Vec3 direction, double magnitude){
-		Extrude::VPUpdateList vpul = m->_vpl()->getUpdateList();
-		Extrude::FPUpdateList fpul = m->_fpl()->getUpdateList();
+		MeshImpl* mesh = m->_impl();
 		VertexImpl* impl = v.pImpl();
 		Extrude::extrude(
-				m->_impl(),
+				mesh,
 				impl,
-				vpul,
-				fpul,
 				w,
 				static_cast<vcg::Point3d>(direction),
 				magnitude);
+		m->_touchTopology();
+	}
+
+	std::vector<boost::shared_ptr<Mesh::VertexSet> > extrudeMany(Mesh* m, const Mesh::VertexSet& vertices, const std::vector<Vec3>& directions, const std::vector<double>& magnitudes){
+		const unsigned int n = vertices.size();
+		if (!directions.empty() and directions.size()!=n){
+			throw std::runtime_error("extrude_many: expected a direction for each vertex");
+		}
+		if (magnitudes.size()!=1 and magnitudes.size()!=n){
+			throw std::runtime_error("extrude_many: expected a magnitude for each vertex");
+		}
+
+		MeshImpl* impl = m->_impl();
+		std::vector<VertexImpl*> centres;
+		std::vector<vcg::Point3d> dirs;
+		std::vector<double> mags;
+		BOOST_FOREACH(const shared_ptr<VertexProxy>& v, vertices){
+			VertexImpl* p = v->pImpl();
+			const unsigned int i = centres.size();
+			centres.push_back(p);
+			if (!directions.empty()) dirs.push_back(static_cast<vcg::Point3d>(directions[i]));
+			else dirs.push_back(p!=NULL?p->cN():vcg::Point3d(0,0,0));
+			mags.push_back(magnitudes.size()==1?magnitudes[0]:magnitudes[i]);
+		}
+
+		std::vector<std::vector<VertexImpl*> > caps = Extrude::extrudeMany(impl,centres,dirs,mags);
+		m->_touchTopology();
+
+		std::vector<boost::shared_ptr<Mesh::VertexSet> > loops;
+		for(unsigned int i=0;i<caps.size();i++){
+			boost::shared_ptr<Mesh::VertexSet> l(new Mesh::VertexSet());
+			BOOST_FOREACH(VertexImpl* v, caps[i]){
+				l->push_back(m->_newSP(v));
+			}
+			loops.push_back(l);
+		}
+		return loops;
 	}
 
 	boost::shared_ptr<Mesh::VertexSet> getVerticesAtDistance(Mesh* m, VertexProxy v, int n){
-		vcg::tri::Nring<MeshImpl>::clearFlags(m->_impl()); // Probably necessary..
-		vcg::tri::Nring<MeshImpl> ring(v.pImpl(),m->_impl());
-		ring.expand(n); // NB: expand(2 or more) will not give the verts in proper sequence, have to fix this...
+		NRing ring(static_cast<const VertexProxy&>(v).pImpl()); // read only, so a shared mesh isn't detached
+		ring.expand(n);
 		Mesh::VertexSet* l = new Mesh::VertexSet();
 		BOOST_FOREACH(VertexImpl* v, ring.lastV){
-			// l->push_back(boost::shared_ptr<VertexProxy>(new VertexProxy(m,v)));
 			l->push_back(m->_newSP(v));
 		}
-		ring.clear();
 		return boost::shared_ptr<Mesh::VertexSet>(l);
 	}
 
 	boost::shared_ptr<Mesh::VertexSet> getVerticesWithinDistance(Mesh* m, VertexProxy v, int n){
-		vcg::tri::Nring<MeshImpl>::clearFlags(m->_impl()); // Probably necessary..
-		vcg::tri::Nring<MeshImpl> ring(v.pImpl(),m->_impl());
-		ring.expand(n); // NB: expand(2 or more) will not give the verts in proper sequence, have to fix this...
+		NRing ring(static_cast<const VertexProxy&>(v).pImpl()); // read only, so a shared mesh isn't detached
+		ring.expand(n);
 		Mesh::VertexSet* l = new Mesh::VertexSet();
 		BOOST_FOREACH(VertexImpl* v, ring.allV){
-			// l->push_back(boost::shared_ptr<VertexProxy>(new VertexProxy(m,v)));
 			l->push_back(m->_newSP(v));
 		}
-		ring.clear();
 		return boost::shared_ptr<Mesh::VertexSet>(l);
 	}
 
-	typedef MeshImpl MyMesh;
-	// typedef typename MyMesh::VertexType VertexType;
-
-	typedef MyMesh::VertexType Vertex;
-	typedef MyMesh::VertexPointer VertexPointer;
-	typedef MyMesh::FaceType Face;
-	typedef MyMesh::FacePointer FacePointer;
-
-
 	boost::shared_ptr<Mesh::VertexSet> nloop(Mesh* mp, VertexProxy vp, int w){
-		Vertex* v = vp.pImpl();
-		MyMesh* m = mp->_impl();
-
-		// select the n-ring of faces
-		vcg::tri::Nring<MyMesh>::clearFlags(m); // Probably necessary..
-		vcg::tri::Nring<MyMesh> ring(v,m);
+		// NRing orders the outer ring along the border of the faces inside it
+		NRing ring(static_cast<const VertexProxy&>(vp).pImpl());
 		ring.expand(w);
-		std::vector<FacePointer> internalFaces = ring.allF;
-		std::vector<FacePointer> lastF = ring.lastF;
-		// std::vector<VertexPointer> edgeLoop = ring.lastV;
-
-		// extract the ordered edgeLoop from the Nring
-		std::vector<VertexPointer> lastV = ring.lastV;
-		std::vector<VertexPointer> edgeLoop;
-		Vertex* v0 = lastV[0];
-		edgeLoop.push_back(v0);
-		Vertex* oldV = v0;
-		std::vector<VertexPointer>::iterator lastVEnd = std::remove(lastV.begin(), lastV.end(), v0);;
-		while (lastVEnd!=lastV.begin()){
-			// find neighbour of v0 in internal Faces
-			bool foundNextItem = false;
-			BOOST_FOREACH(FacePointer fp, lastF){
-				for(int k=0;k<3;k++){
-					if (fp->V(k)==oldV){
-						Vertex* nextV = fp->V((k+1)%3);
-						std::vector<VertexPointer>::iterator it = std::find(lastV.begin(),lastVEnd,nextV);
-						if (it!=lastVEnd){
-							// found the next vertex
-							edgeLoop.push_back(nextV);
-							oldV = nextV;
-							foundNextItem = true;
-							lastVEnd = std::remove(lastV.begin(), lastVEnd, nextV);
-							break;
-						}
-						else {
-							// do nothing
-						}
-					}
-				} // exit break
-
-				if (foundNextItem) break;
-			}
-
-			if (foundNextItem==false) {
-				// the
-				throw("Didn't find the next vertex in the edge loop");
-				break;
-			}
-		}
-		// implicitly, the last element should be connected to the first
 
-		// Construct a vertex set from the ring
 		Mesh::VertexSet* l = new Mesh::VertexSet();
 		BOOST_FOREACH(VertexImpl* v, ring.lastV){
 			l->push_back(mp->_newSP(v));
 		}
-
-		ring.clear();
-		/*
-		if (!isEdgeLoop(edgeLoop)){
-			throw("Edge loop is either not connected or not closed.");
-		}
-		*/
 		return boost::shared_ptr<Mesh::VertexSet>(l);
 	}
 
 	void splitEdge(Mesh* m, Pos p){
-		Extrude::VPUpdateList vpul = m->_vpl()->getUpdateList();
-		Extrude::FPUpdateList fpul = m->_fpl()->getUpdateList();
+		MeshImpl* mesh = m->_impl();
+		vcg::face::Pos<fg::FaceImpl> vcgpos(p.getF()->pImpl(),p.getE(),p.getV()->pImpl());
+		Extrude::splitEdge(mesh,vcgpos);
+		m->_touchTopology();
+	}
+
+	bool flipEdge(Mesh* m, Pos p){
+		MeshImpl* mesh = m->_impl();
 		vcg::face::Pos<fg::FaceImpl> vcgpos(p.getF()->pImpl(),p.getE(),p.getV()->pImpl());
-		Extrude::splitEdge(m->_impl(),vcgpos,vpul,fpul);
+		if (!Extrude::flipEdge(mesh,vcgpos)) return false;
+		m->_touchTopology();
+		return true;
+	}
+
+	bool collapseEdge(Mesh* m, Pos p){
+		MeshImpl* mesh = m->_impl();
+		vcg::face::Pos<fg::FaceImpl> vcgpos(p.getF()->pImpl(),p.getE(),p.getV()->pImpl());
+		const vcg::Point3d midpoint = (vcgpos.F()->P(vcgpos.E()) + vcgpos.F()->P((vcgpos.E()+1)%3))/2;
+		// the faces either side of the edge and the other end of it are deleted
+		FaceImpl* f1 = vcgpos.F();
+		FaceImpl* f2 = f1->FFp(vcgpos.E());
+		VertexImpl* b = (f1->V(vcgpos.E())==vcgpos.V())?f1->V((vcgpos.E()+1)%3):f1->V(vcgpos.E());
+		if (!Extrude::collapseEdge(mesh,vcgpos,midpoint)) return false;
+		m->_vertexHandles()->invalidate(b - &mesh->vert[0]);
+		m->_faceHandles()->invalidate(f1 - &mesh->face[0]);
+		m->_faceHandles()->invalidate(f2 - &mesh->face[0]);
+		m->_touchTopology();
+		return true;
+	}
+
+	namespace {
+		/// the noise (see displaceByNoise) at every vertex slot of m, in parallel
+		void noiseAtVertices(const MeshImpl& m, double frequency, int nOctaves, double falloff, bool turbulent, std::vector<double>& values){
+			const int n = m.vert.size();
+			values.resize(n);
+			if (n==0) return;
+
+			// each chunk gathers its points so the noise can be evaluated in bulk
+			const int CHUNK = 256;
+			const int chunks = (n+CHUNK-1)/CHUNK;
+			const int threads = Parallel::threadsFor(n);
+			#pragma omp parallel for num_threads(threads) schedule(static)
+			for(int c=0;c<chunks;c++){
+				const int begin = c*CHUNK, count = std::min(CHUNK,n-begin);
+				double xyz[3*CHUNK];
+				for(int i=0;i<count;i++){
+					const vcg::Point3d& p = m.vert[begin+i].cP();
+					for(int k=0;k<3;k++) xyz[3*i+k] = p[k]*frequency;
+				}
+				double* out = &values[begin];
+				if (turbulent) turbulenceMany(xyz,count,out,std::max(nOctaves,1),falloff);
+				else if (nOctaves<=1) noiseMany(xyz,count,out);
+				else fracSumMany(xyz,count,out,nOctaves,falloff);
+			}
+		}
+	}
+
+	void displaceByNoise(Mesh* m, double frequency, double amplitude, int nOctaves, double falloff, bool turbulent){
+		m->sync(); // for the normals
+		MeshImpl& mesh = *m->_impl();
+		std::vector<double> values;
+		noiseAtVertices(mesh,frequency,nOctaves,falloff,turbulent,values);
+
+		const int n = mesh.vert.size();
+		const int threads = Parallel::threadsFor(n);
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<n;i++){
+			VertexImpl& v = mesh.vert[i];
+			if (!v.IsD()) v.P() += v.cN()*(amplitude*values[i]);
+		}
+		m->_touchGeometry();
+		m->sync();
+	}
+
+	void colourByNoise(Mesh* m, double frequency, int nOctaves, double falloff, bool turbulent){
+		MeshImpl& mesh = *m->_impl();
+		std::vector<double> values;
+		noiseAtVertices(mesh,frequency,nOctaves,falloff,turbulent,values);
+
+		const int n = mesh.vert.size();
+		const int threads = Parallel::threadsFor(n);
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<n;i++){
+			VertexImpl& v = mesh.vert[i];
+			if (v.IsD()) continue;
+			const double t = turbulent?values[i]:0.5+0.5*values[i];
+			const unsigned char grey = (unsigned char)(255*std::max(0.0,std::min(1.0,t)) + 0.5);
+			v.C()[0] = v.C()[1] = v.C()[2] = grey;
+		}
+		m->_touchGeometry();
 	}
 }
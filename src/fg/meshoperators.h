@@ -35,6 +35,7 @@
 #include "fg/pos.h"
 
 #include <list>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 
@@ -78,16 +79,35 @@ namespace fg {
 	 */
 	void extrude(Mesh* m, VertexProxy v, int width, Vec3 direction, double magnitude);
 
+	/**
+	 * \brief Extrude the faces around many vertices at once.
+	 *
+	 * As with extrude(m,v,dir,magnitude) in core/extrude.lua, the faces around each vertex are extruded
+	 * along its direction: the vertex moves magnitude along it, and the new loop of vertices around
+	 * it (the cap) lies in the plane perpendicular to it. Every fan is checked before the mesh is
+	 * modified, and the mesh is reallocated once, so this is much faster than extruding one at a time.
+	 *
+	 * \param directions One per vertex, or none to use the vertex normals
+	 * \param magnitudes One per vertex, or one for all of them
+	 * \return The cap loop around each vertex
+	 * \throws std::runtime_error if a vertex is on a border, or too close to another (their faces overlap)
+	 *
+	 * \ingroup meshops
+	 */
+	std::vector<boost::shared_ptr<Mesh::VertexSet> > extrudeMany(Mesh* m, const Mesh::VertexSet& vertices, const std::vector<Vec3>& directions, const std::vector<double>& magnitudes);
+
 
 	/**
-	 * \brief Get all vertices (unordered) lying a distance n (in edges) surrounding a vertex.
+	 * \brief Get all vertices lying a distance n (in edges) surrounding a vertex, in cyclic order.
+	 * The cost depends only on the size of the ring, not the mesh (see NRing).
 	 *
 	 * \ingroup meshops
 	 */
 	boost::shared_ptr<Mesh::VertexSet> getVerticesAtDistance(Mesh* m, VertexProxy v, int n);
 
 	/**
-	 * \brief Get all vertices lying at distance n or less (in edges) surrounding a vertex.
+	 * \brief Get all vertices lying at distance n or less (in edges) surrounding a vertex,
+	 * ring by ring, each ring in cyclic order.
 	 *
 	 * \ingroup meshops
 	 */
@@ -104,6 +124,41 @@ namespace fg {
 	 * \ingroup meshops
 	 */
 	void splitEdge(Mesh* m, Pos p);
+
+	/**
+	 * \brief Flip the edge pointed to by Pos p, so it joins the other corners of its two faces
+	 * @return false if the edge can't be flipped (e.g., it is on a border)
+	 * \ingroup meshops
+	 */
+	bool flipEdge(Mesh* m, Pos p);
+
+	/**
+	 * \brief Collapse the edge pointed to by Pos p into its midpoint
+	 * The vertex p.getV() is kept, the other vertex and the faces on the edge are deleted.
+	 * @return false if the edge can't be collapsed without making the mesh non-manifold
+	 * \ingroup meshops
+	 */
+	bool collapseEdge(Mesh* m, Pos p);
+
+	/**
+	 * \brief Move each vertex along its normal by amplitude times the noise at frequency*p.
+	 *
+	 * With nOctaves > 1 the noise is fracSum (or turbulence if turbulent is true) with
+	 * that many octaves and falloff. The noise is evaluated in blocks (see noiseMany) and
+	 * in parallel (see fg::Parallel), which is much faster than calling noise per vertex.
+	 *
+	 * \ingroup meshops
+	 */
+	void displaceByNoise(Mesh* m, double frequency, double amplitude, int nOctaves = 1, double falloff = 1.0, bool turbulent = false);
+
+	/**
+	 * \brief Set the colour of each vertex to a grey level from the noise at frequency*p (as for displaceByNoise).
+	 *
+	 * The noise is mapped from [-1,1] to black and white, or from [0,1] for turbulence. The alpha is kept.
+	 *
+	 * \ingroup meshops
+	 */
+	void colourByNoise(Mesh* m, double frequency, int nOctaves = 1, double falloff = 1.0, bool turbulent = false);
 }
 
 #endif
@@ -1,666 +1,737 @@
-/**
- * \file
- * \author ben
- * 
- * \cond showlicense
- * \verbatim
- * --------------------------------------------------------------
- *    ___     
- *   |  _|___ 
- *   |  _| . | fg: real-time procedural 
- *   |_| |_  | animation and generation 
- *       |___| of 3D forms
- *
- *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
- *   Monash University, Australia. All rights reserved.
- *
- *   Use of this software is governed by the terms outlined in 
- *   the LICENSE file.
- * 
- * --------------------------------------------------------------
- * \endverbatim
- * \endcond
- */
-
-#include "fg/meshoperators_vcg.h"
-#include "fg/util.h"
-
-#include <list>
-#include <set>
-#include <algorithm>
-#include <cstring>
-#include <cstdlib>
-#include <cstdio>
-#include <ctime>
-#include <iostream>
-
-// #include <boost/foreach.hpp> // in fg/util.h
-// #include <boost/tuple/tuple.hpp> // in fg/util.h
-
-#include <vcg/simplex/vertex/base.h>
-#include <vcg/simplex/vertex/component_ocf.h>
-#include <vcg/simplex/face/base.h>
-#include <vcg/simplex/face/component_ocf.h>
-#include <vcg/simplex/face/pos.h>
-#include <vcg/complex/complex.h>
-#include <vcg/complex/allocate.h>
-#include <vcg/complex/algorithms/nring.h>
-#include <vcg/complex/algorithms/update/topology.h>
-#include <vcg/complex/algorithms/update/color.h>
-
-namespace fg {
-	void Extrude::error(const char* msg){
-		std::cerr << "Extrude: " << msg;
-		exit(-1);
-	}
-
-	std::set<Extrude::VertexPointer> Extrude::extrude(MyMesh* m, Vertex*& v, VPUpdateList& vpul, FPUpdateList& fpul, int width, vcg::Point3d direction, double length, double expand){
-		assert (width >= 1);
-
-		vcg::Point3d center = v->P();
-		// select the one-ring of faces
-		vcg::tri::Nring<MyMesh>::clearFlags(m); // Probably necessary..
-		vcg::tri::Nring<MyMesh> ring(v,m);
-		ring.expand(width); // NB: expand(2 or more) will not give the verts in proper sequence, have to fix this...
-		std::vector<FacePointer> internalFaces = ring.allF;
-		std::vector<FacePointer> lastF = ring.lastF;
-		// std::vector<VertexPointer> edgeLoop = ring.lastV;
-
-		// extract the ordered edgeLoop from the Nring
-		std::vector<VertexPointer> lastV = ring.lastV;
-		std::vector<VertexPointer> edgeLoop;
-		Vertex* v0 = lastV[0];
-		edgeLoop.push_back(v0);
-		Vertex* oldV = v0;
-		std::vector<VertexPointer>::iterator lastVEnd = std::remove(lastV.begin(), lastV.end(), v0);;
-		while (lastVEnd!=lastV.begin()){
-			// find neighbour of v0 in internal Faces
-			bool foundNextItem = false;
-			BOOST_FOREACH(FacePointer fp, lastF){
-				for(int k=0;k<3;k++){
-					if (fp->V(k)==oldV){
-						Vertex* nextV = fp->V((k+1)%3);
-						std::vector<VertexPointer>::iterator it = std::find(lastV.begin(),lastVEnd,nextV);
-						if (it!=lastVEnd){
-							// found the next vertex
-							edgeLoop.push_back(nextV);
-							oldV = nextV;
-							foundNextItem = true;
-							lastVEnd = std::remove(lastV.begin(), lastVEnd, nextV);
-							break;
-						}
-						else {
-							// do nothing
-						}
-					}
-				} // exit break
-
-				if (foundNextItem) break;
-			}
-
-			if (foundNextItem==false) {
-				// the
-				throw("Didn't find the next vertex in the edge loop");
-				break;
-			}
-		}
-		// implicitly, the last element should be connected to the first
-
-		// clear ring here, as its internal refs will get screwed up when
-		// we add verts later on..
-		ring.clear();
-
-		if (!isEdgeLoop(edgeLoop)){
-			throw("Edge loop is either not connected or not closed.");
-		}
-
-		// Duplicate vertices of edge ring
-		// (v' corresponding to v in the edge ring)
-		// insideedgeLoop[i] = edgeLoop[i]'
-		std::vector<Vertex*> insideEdgeLoop;
-		int newVertsStartIndex = m->vert.size();
-
-		// Add new vertices, but note that we need to
-		// update the pointers to v and each edgeLoop vertex
-		std::vector<VertexPointer*> vtxPtrs;
-		BOOST_FOREACH(VertexPointer& ev, edgeLoop){
-			vtxPtrs.push_back(&ev);
-		}
-		vtxPtrs.push_back(&v);
-		BOOST_FOREACH(VertexPointer*& ev, vpul){
-			vtxPtrs.push_back(ev);
-		}
-
-		vcg::tri::Allocator<MyMesh>::AddVertices(*m,edgeLoop.size(),vtxPtrs);
-
-		int di = 0;
-		BOOST_FOREACH(Vertex* ev, edgeLoop){
-			Vertex* nv = &m->vert[newVertsStartIndex + di];
-			insideEdgeLoop.push_back(nv);
-			nv->P() = ev->P(); //  + direction*amount; // moved later..
-			di++;
-		}
-
-		// For all v in edgeLoop
-		// for all f attached to v
-		// If f is an inside face, then reattach it to v'
-
-		// The reattachments we need to perform
-		// (f,i,v) set f->V(i)=v
-		typedef boost::tuple<Face*,int,Vertex*> FivTuple;
-		std::list<FivTuple> faceAdjustments;
-
-		for(int i=0;i<edgeLoop.size();i++){
-			Vertex* ve = edgeLoop[i];
-			Vertex* vm1 = edgeLoop[(i-1+edgeLoop.size())%edgeLoop.size()];
-			Vertex* vp1 = edgeLoop[(i+1)%edgeLoop.size()];
-			Vertex* vd = insideEdgeLoop[i];
-
-			// How to find inside faces?
-			// 1. first find the face that contains ve,vp1
-			Face* startFace = NULL;
-			int startIndex = 0; // The index of ve in startFace
-
-			//std::cerr << "ve: " << ve << "\n";
-
-			vcg::face::VFIterator<Face> vfi(ve); //initialize the iterator to the first face
-			for(;!vfi.End();++vfi)
-			{
-				Face* f = vfi.F();
-				// std::cerr << "f: " << f << "\n";
-
-				int k=0;
-				for(;k<3;k++){
-					if (f->V(k)==ve && f->V((k+1)%3)==vp1){
-						startFace = f;
-						startIndex = k;
-						break;
-					}
-				}
-				if (k==3) continue;
-				else {
-					// we have found the start face
-					break;
-				}
-			}
-
-			if (startFace==NULL){
-				// An error has occurred
-				// The edge ring is not connected properly
-				// TODO: Throw an informative error message
-				throw("edge loop probably not fully connected or closed");
-			}
-
-			// 2. Next, iterate from this face, until we find the endFace
-			// the endFace contains vm1,ve in order
-			int cycle = 0; // track how many iterations we do and stop if too many
-			vcg::face::Pos<Face> p(startFace,(startIndex+2)%3,ve);
-			do {
-				// std::cerr << ".\n";
-				// Find index of ve in p.f
-				int index = 0;
-				for(;index<3;index++)
-				{ if (p.f->V(index)==ve) break; }
-				assert(index!=3);
-				faceAdjustments.push_back(boost::make_tuple(p.f,index,vd));
-
-				// iterate to next face, stopping when we cross the edgering
-				// i.e., edge p.E() joins ve and vm1
-				// as p.E() always starts at ve, we just need to check vm1
-				p.FlipF();
-				if (p.f->V((p.E()+1)%3)==vm1) break;
-				// else
-				p.FlipE();
-
-				cycle++;
-			} while (cycle < 1000); // shouldnt have more than 1000 neighbour faces!
-			if (cycle>=1000){
-				throw("Either your vertices have a really high degree (>1000), or the extrusion algorithm might be caught in an infinite loop around a vertex! Check your edge-ring or topology correctness.");
-			}
-		}
-
-		BOOST_FOREACH(FivTuple& a, faceAdjustments){
-			Face* f = a.get<0>(); // this form doesnt seem to work
-			// Face* f = FivTuple::get<0>(a);
-			int i = a.get<1>(); // FivTuple::get<1>(a);
-			Vertex* v = a.get<2>(); // FivTuple::get<2>(a);
-			f->V(i) = v;
-		}
-
-		// Finally, for all pairs of edges, create two new triangles
-		// between them
-		int newFacesStartIndex = m->face.size();
-
-		std::vector<FacePointer*> facePointersToUpdate;
-		BOOST_FOREACH(FacePointer& f, internalFaces){
-			facePointersToUpdate.push_back(&f);
-		}
-		BOOST_FOREACH(FacePointer*& fv, fpul){
-			facePointersToUpdate.push_back(fv);
-		}
-		vcg::tri::Allocator<MyMesh>::AddFaces(*m,edgeLoop.size()*2,facePointersToUpdate);
-		for(int i=0;i<edgeLoop.size();i++){
-			Vertex* ve = edgeLoop[i];
-			Vertex* vp1 = edgeLoop[(i+1)%edgeLoop.size()];
-			Vertex* vd = insideEdgeLoop[i];
-			Vertex* vdp1 = insideEdgeLoop[(i+1)%insideEdgeLoop.size()];
-
-			Face* f1 = &m->face[newFacesStartIndex+2*i];
-			Face* f2 = &m->face[newFacesStartIndex+2*i+1];
-			f1->V(0) = ve;
-			f1->V(1) = vp1;
-			f1->V(2) = vd;
-			f2->V(0) = vd;
-			f2->V(1) = vp1;
-			f2->V(2) = vdp1;
-		}
-
-		// finally move all the internal faces
-		// NB: make sure each vertex is only moved once
-		std::set<VertexPointer> internalVerts;
-		BOOST_FOREACH(FacePointer f, internalFaces){
-			internalVerts.insert(f->V(0));
-			internalVerts.insert(f->V(1));
-			internalVerts.insert(f->V(2));
-			// f->C() = vcg::Color4b::Red;
-		}
-
-		// Shift each vertex
-		// And make sure they are aligned perpendicular to the extrusion direction
-		double ddotd = direction.dot(direction);
-		double vdotd = v->P().dot(direction);
-		vcg::Point3d newCenter = center + direction*length;
-
-		BOOST_FOREACH(VertexPointer p, internalVerts){
-
-			if (p==v){
-				p->P() = newCenter; // direction*2*length;
-			}
-			else {
-				p->P() += direction*(length + (vdotd-p->P().dot(direction))/ddotd);
-
-				// plus the expansion
-				vcg::Point3d exp = (newCenter-p->P())*-expand;
-				p->P() += exp;
-			}
-		}
-
-
-		// Do a big ass topo update
-		// TODO: can efficiencize this by manually fixing ptrs etc above
-		vcg::tri::UpdateTopology<MyMesh>::FaceFace(*m);
-		vcg::tri::UpdateTopology<MyMesh>::VertexFace(*m);
-
-		return internalVerts;
-	}
-
-	std::set<Extrude::VertexPointer> Extrude::extrude(MyMesh* m, Vertex*& v, VPUpdateList& vpul, FPUpdateList& fpul, int width, vcg::Point3d direction, double length)
-	{
-		assert (width >= 1);
-
-		vcg::Point3d center = v->P();
-		// select the one-ring of faces
-		vcg::tri::Nring<MyMesh>::clearFlags(m); // Probably necessary..
-		vcg::tri::Nring<MyMesh> ring(v,m);
-		ring.expand(width); // NB: expand(2 or more) will not give the verts in proper sequence, so have to order them properly
-		std::vector<FacePointer> internalFaces = ring.allF;
-		std::vector<FacePointer> lastF = ring.lastF;
-		// std::vector<VertexPointer> edgeLoop = ring.lastV;
-
-		// extract the ordered edgeLoop from the Nring
-		std::vector<VertexPointer> lastV = ring.lastV;
-		std::vector<VertexPointer> edgeLoop;
-		Vertex* v0 = lastV[0];
-		edgeLoop.push_back(v0);
-		Vertex* oldV = v0;
-		std::vector<VertexPointer>::iterator lastVEnd = std::remove(lastV.begin(), lastV.end(), v0);;
-		while (lastVEnd!=lastV.begin()){
-			// find neighbour of v0 in internal Faces
-			bool foundNextItem = false;
-			BOOST_FOREACH(FacePointer fp, lastF){
-				for(int k=0;k<3;k++){
-					if (fp->V(k)==oldV){
-						Vertex* nextV = fp->V((k+1)%3);
-						std::vector<VertexPointer>::iterator it = std::find(lastV.begin(),lastVEnd,nextV);
-						if (it!=lastVEnd){
-							// found the next vertex
-							edgeLoop.push_back(nextV);
-							oldV = nextV;
-							foundNextItem = true;
-							lastVEnd = std::remove(lastV.begin(), lastVEnd, nextV);
-							break;
-						}
-						else {
-							// do nothing
-						}
-					}
-				} // exit break
-
-				if (foundNextItem) break;
-			}
-
-			if (foundNextItem==false) {
-				// the
-				throw("Didn't find the next vertex in the edge loop");
-				break;
-			}
-		}
-		// implicitly, the last element should be connected to the first
-
-		// clear ring here, as its internal refs will get screwed up when
-		// we add verts later on..
-		ring.clear();
-
-		if (!isEdgeLoop(edgeLoop)){
-			throw("Edge loop is either not connected or not closed.");
-		}
-
-		// Duplicate vertices of edge ring
-		// (v' corresponding to v in the edge ring)
-		// insideedgeLoop[i] = edgeLoop[i]'
-		std::vector<Vertex*> insideEdgeLoop;
-		int newVertsStartIndex = m->vert.size();
-
-		// Add new vertices, but note that we need to
-		// update the pointers to v and each edgeLoop vertex
-		std::vector<VertexPointer*> vtxPtrs;
-		BOOST_FOREACH(VertexPointer& ev, edgeLoop){
-			vtxPtrs.push_back(&ev);
-		}
-		vtxPtrs.push_back(&v);
-		BOOST_FOREACH(VertexPointer*& ev, vpul){
-			vtxPtrs.push_back(ev);
-		}
-
-		vcg::tri::Allocator<MyMesh>::AddVertices(*m,edgeLoop.size(),vtxPtrs);
-
-		int di = 0;
-		BOOST_FOREACH(Vertex* ev, edgeLoop){
-			Vertex* nv = &m->vert[newVertsStartIndex + di];
-			insideEdgeLoop.push_back(nv);
-			nv->P() = ev->P(); //  + direction*amount; // moved later..
-			di++;
-		}
-
-		// For all v in edgeLoop
-		// for all f attached to v
-		// If f is an inside face, then reattach it to v'
-
-		// The reattachments we need to perform
-		// (f,i,v) set f->V(i)=v
-		typedef boost::tuple<Face*,int,Vertex*> FivTuple;
-		std::list<FivTuple> faceAdjustments;
-
-		for(int i=0;i<edgeLoop.size();i++){
-			Vertex* ve = edgeLoop[i];
-			Vertex* vm1 = edgeLoop[(i-1+edgeLoop.size())%edgeLoop.size()];
-			Vertex* vp1 = edgeLoop[(i+1)%edgeLoop.size()];
-			Vertex* vd = insideEdgeLoop[i];
-
-			// How to find inside faces?
-			// 1. first find the face that contains ve,vp1
-			Face* startFace = NULL;
-			int startIndex = 0; // The index of ve in startFace
-
-			//std::cerr << "ve: " << ve << "\n";
-
-			vcg::face::VFIterator<Face> vfi(ve); //initialize the iterator to the first face
-			for(;!vfi.End();++vfi)
-			{
-				Face* f = vfi.F();
-				// std::cerr << "f: " << f << "\n";
-
-				int k=0;
-				for(;k<3;k++){
-					if (f->V(k)==ve && f->V((k+1)%3)==vp1){
-						startFace = f;
-						startIndex = k;
-						break;
-					}
-				}
-				if (k==3) continue;
-				else {
-					// we have found the start face
-					break;
-				}
-			}
-
-			if (startFace==NULL){
-				// An error has occurred
-				// The edge ring is not connected properly
-				// TODO: Throw an informative error message
-				throw("edge loop probably not fully connected or closed");
-			}
-
-			// 2. Next, iterate from this face, until we find the endFace
-			// the endFace contains vm1,ve in order
-			int cycle = 0; // track how many iterations we do and stop if too many
-			vcg::face::Pos<Face> p(startFace,(startIndex+2)%3,ve);
-			do {
-				// std::cerr << ".\n";
-				// Find index of ve in p.f
-				int index = 0;
-				for(;index<3;index++)
-				{ if (p.f->V(index)==ve) break; }
-				assert(index!=3);
-				faceAdjustments.push_back(boost::make_tuple(p.f,index,vd));
-
-				// iterate to next face, stopping when we cross the edgering
-				// i.e., edge p.E() joins ve and vm1
-				// as p.E() always starts at ve, we just need to check vm1
-				p.FlipF();
-				if (p.f->V((p.E()+1)%3)==vm1) break;
-				// else
-				p.FlipE();
-
-				cycle++;
-			} while (cycle < 1000); // shouldnt have more than 1000 neighbour faces!
-			if (cycle>=1000){
-				throw("Either your vertices have a really high degree (>1000), or the extrusion algorithm might be caught in an infinite loop around a vertex! Check your edge-ring or topology correctness.");
-			}
-		}
-
-		BOOST_FOREACH(FivTuple& a, faceAdjustments){
-			Face* f = a.get<0>(); // this form doesnt seem to work
-			// Face* f = FivTuple::get<0>(a);
-			int i = a.get<1>(); // FivTuple::get<1>(a);
-			Vertex* v = a.get<2>(); // FivTuple::get<2>(a);
-			f->V(i) = v;
-		}
-
-		// Finally, for all pairs of edges, create two new triangles
-		// between them
-		int newFacesStartIndex = m->face.size();
-
-		std::vector<FacePointer*> facePointersToUpdate;
-		BOOST_FOREACH(FacePointer& f, internalFaces){
-			facePointersToUpdate.push_back(&f);
-		}
-		BOOST_FOREACH(FacePointer*& fv, fpul){
-			facePointersToUpdate.push_back(fv);
-		}
-		vcg::tri::Allocator<MyMesh>::AddFaces(*m,edgeLoop.size()*2,facePointersToUpdate);
-		for(int i=0;i<edgeLoop.size();i++){
-			Vertex* ve = edgeLoop[i];
-			Vertex* vp1 = edgeLoop[(i+1)%edgeLoop.size()];
-			Vertex* vd = insideEdgeLoop[i];
-			Vertex* vdp1 = insideEdgeLoop[(i+1)%insideEdgeLoop.size()];
-
-			Face* f1 = &m->face[newFacesStartIndex+2*i];
-			Face* f2 = &m->face[newFacesStartIndex+2*i+1];
-			f1->V(0) = ve;
-			f1->V(1) = vp1;
-			f1->V(2) = vd;
-			f2->V(0) = vd;
-			f2->V(1) = vp1;
-			f2->V(2) = vdp1;
-		}
-
-		// finally move all the internal faces
-		// NB: make sure each vertex is only moved once
-		std::set<VertexPointer> internalVerts;
-		BOOST_FOREACH(FacePointer f, internalFaces){
-			internalVerts.insert(f->V(0));
-			internalVerts.insert(f->V(1));
-			internalVerts.insert(f->V(2));
-			// f->C() = vcg::Color4b::Red;
-		}
-
-		// Shift each vertex
-		Vec3 diff = direction*length;
-		BOOST_FOREACH(VertexPointer p, internalVerts){
-			p->P() += diff;
-		}
-
-		// Do a big ass topo update
-		// TODO: can make efficient by manually fixing ptrs etc above
-		vcg::tri::UpdateTopology<MyMesh>::FaceFace(*m);
-		vcg::tri::UpdateTopology<MyMesh>::VertexFace(*m);
-
-		// XXX: for debugging only!
-		//vcg::tri::UpdateTopology<MyMesh>::TestFaceFace(*m);
-		//vcg::tri::UpdateTopology<MyMesh>::TestVertexFace(*m);
-
-		return internalVerts;
-	}
-
-	void Extrude::splitEdge(MyMesh* m, Extrude::Pos& pos, VPUpdateList& vpul, FPUpdateList& fpul){
-		/*
-		 * Given pos = (v,e,f)
-		 * find the following elements...
-		 *
-		 * v4----v3
-		 * |f2__/ |
-		 * | /  f1|
-		 * v1----v2
-		 * And the midpoint=(v1+v3)/2
-		 */
-
-		VertexPointer v1,v2,v3,v4;
-		FacePointer f1, f2;
-
-		v1 = pos.V();
-		f1 = pos.F();
-
-		pos.FlipE();
-		pos.FlipV();
-		v2 = pos.V();
-		pos.FlipV();
-		pos.FlipE();
-
-		pos.FlipV();
-		v3 = pos.V();
-		pos.FlipV();
-
-		pos.FlipF();
-		f2 = pos.F();
-		pos.FlipE();
-		pos.FlipV();
-		v4 = pos.V();
-
-		assert(v1!=v2 and v1!=v3 and v1!=v4 and v2!=v3 and v2!=v4 and v3!=v4 and f1!=f2 and "splitEdge failed, is edge correctly formed?");
-
-		// NOTE: pos is now useless/invalid
-
-		Vec3 midpoint = (v1->P() + v3->P())/2;
-
-		// Delete f',f, and update any pointers
-		vcg::tri::Allocator<MyMesh>::DeleteFace(*m,*f1);
-		vcg::tri::Allocator<MyMesh>::DeleteFace(*m,*f2);
-		foreach(FacePointer*& fv, fpul){
-			if (*fv==f1 or *fv==f2){
-				*fv = NULL;
-			}
-		}
-
-		/*
-		 * Add a new vertex, vn, to the midpoint.
-		 * And update the all the vertex pointers, including v1-v4
-		 */
-		VertexPointer vn;
-
-		std::vector<VertexPointer*> vtxPtrs;
-		vtxPtrs.push_back(&v1);
-		vtxPtrs.push_back(&v2);
-		vtxPtrs.push_back(&v3);
-		vtxPtrs.push_back(&v4);
-		BOOST_FOREACH(VertexPointer*& ev, vpul){
-			vtxPtrs.push_back(ev);
-		}
-		VertexIterator newvi = vcg::tri::Allocator<MyMesh>::AddVertices(*m,1,vtxPtrs);
-		vn = &*newvi;
-		vn->P() = midpoint;
-
-		// TODO: Interpolate other parameters, e.g., colour and uv?
-
-		// Add the four new faces,
-		// with appropriate topological pointers
-		// and recomputed normals?
-		std::vector<FacePointer*> facePointersToUpdate;
-		//f1,f2 are gone
-		//facePointersToUpdate.push_back(&f1);
-		//facePointersToUpdate.push_back(&f2);
-		BOOST_FOREACH(FacePointer*& fv, fpul){
-			facePointersToUpdate.push_back(fv);
-		}
-		FaceIterator fi = vcg::tri::Allocator<MyMesh>::AddFaces(*m,4,facePointersToUpdate);
-
-		VertexPointer faces[][3] = {
-				{v1,v2,vn},
-				{v2,v3,vn},
-				{v3,v4,vn},
-				{v4,v1,vn}
-		};
-
-		int index = 0;
-		for(;fi!=m->face.end();fi++,index++)
-		{
-			FacePointer face = &*fi;
-			face->V(0) = faces[index][0];
-			face->V(1) = faces[index][1];
-			face->V(2) = faces[index][2];
-		}
-		assert(index==4 and "splitEdge failed, four edges not added");
-
-		// Do a big ass topo update
-		// TODO: can make efficient by manually fixing ptrs etc above
-		vcg::tri::UpdateTopology<MyMesh>::FaceFace(*m);
-		vcg::tri::UpdateTopology<MyMesh>::VertexFace(*m);
-
-		// Debugging:
-		// vcg::tri::UpdateTopology<MyMesh>::TestVertexFace(*m);
-		// vcg::tri::UpdateTopology<MyMesh>::TestFaceFace(*m);
-	}
-
-	/**
-	 * Checks if loop is a connected closed edge loop.
-	 *
-	 * @param loop
-	 * @return
-	 */
-	bool Extrude::isEdgeLoop(std::vector<MyMesh::VertexPointer>& loop){
-		//std::cout << "isEdgeLoop: loop.size = " << loop.size() << "\n";
-
-		if (loop.size()<3) return false;
-		MyMesh::VertexPointer p = loop[loop.size()-1];
-		BOOST_FOREACH(MyMesh::VertexPointer np, loop){
-			// p should be connected to np
-			bool isPConnectedToNP = false;
-			vcg::face::VFIterator<MyMesh::FaceType> vfi(p);
-			while(!vfi.End()){
-				if (vfi.f->V(0)==np || vfi.f->V(1)==np || vfi.f->V(2)==np)
-				{
-					isPConnectedToNP = true;
-					break;
-				}
-				++vfi;
-			}
-
-			if (!isPConnectedToNP){
-				return false;
-			}
-			p = np;
-		}
-		return true;
-	}
-}
+/**
+ * \file
+ * \author ben
+ * 
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___     
+ *   |  _|___ 
+ *   |  _| . | fg: real-time procedural 
+ *   |_| |_  | animation and generation 
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in 
+ *   the LICENSE file.
+ * 
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/meshoperators_vcg.h"
+#include "fg/nring.h"
+#include "fg/util.h"
+
+#include <set>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+// #include <boost/foreach.hpp> // in fg/util.h
+// #include <boost/tuple/tuple.hpp> // in fg/util.h
+
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
+#include <vcg/simplex/vertex/base.h>
+#include <vcg/simplex/vertex/component_ocf.h>
+#include <vcg/simplex/face/base.h>
+#include <vcg/simplex/face/component_ocf.h>
+#include <vcg/simplex/face/pos.h>
+#include <vcg/complex/complex.h>
+#include <vcg/complex/allocate.h>
+#include <vcg/complex/algorithms/update/topology.h>
+#include <vcg/complex/algorithms/update/color.h>
+
+namespace fg {
+	void Extrude::error(const char* msg){
+		std::cerr << "Extrude: " << msg;
+		exit(-1);
+	}
+
+	namespace {
+		const unsigned int NONE = 0xffffffff;
+
+		/// One region being extruded, by index as the containers are reallocated
+		struct Extrusion {
+			Extrusion():centre(NONE),magnitude(0),firstVertex(0),firstFace(0){}
+
+			unsigned int centre; ///< the vertex the region was grown from
+			std::vector<unsigned int> faces; ///< the region, these faces move onto the cap
+			std::vector<unsigned int> ring; ///< the border of the region, in order
+			std::vector<unsigned int> edgeFace; ///< the region face on the ring edge ring[j],ring[j+1]
+			std::vector<int> edgeIndex; ///< and the index of the edge in it
+			std::vector<unsigned int> outer; ///< the face across the ring edge (or NONE at a border)
+			std::vector<int> outerEdge;
+			std::vector<std::vector<std::pair<unsigned int,int> > > corners; ///< the region faces at ring[j], and the index of ring[j] in them
+			vcg::Point3d direction;
+			double magnitude;
+			unsigned int firstVertex; ///< the cap vertices
+			unsigned int firstFace; ///< the side faces, two per ring edge
+		};
+
+		/// which extrusion (and slot of its ring) a ring edge belongs to, by face*3+edge
+		typedef boost::unordered_map<unsigned int, std::pair<unsigned int,unsigned int> > EdgeOwners;
+
+		void extrudeError(unsigned int i, const char* msg){
+			std::ostringstream oss;
+			oss << "extrude_many: vertex " << (i+1) << " " << msg;
+			throw std::runtime_error(oss.str());
+		}
+
+		/// replace the VF list of v with faces (the face and the index of v in it)
+		void linkVertexFaces(VertexImpl* v, const std::vector<std::pair<FaceImpl*,int> >& faces){
+			v->VFp() = NULL;
+			v->VFi() = 0;
+			for(int i=faces.size()-1;i>=0;i--){
+				FaceImpl* f = faces[i].first;
+				int z = faces[i].second;
+				f->VFp(z) = v->VFp();
+				f->VFi(z) = v->VFi();
+				v->VFp() = f;
+				v->VFi() = z;
+			}
+		}
+
+		/// add corner z of f to the VF list of v
+		void addVertexFace(VertexImpl* v, FaceImpl* f, int z){
+			f->VFp(z) = v->VFp();
+			f->VFi(z) = v->VFi();
+			v->VFp() = f;
+			v->VFi() = z;
+		}
+
+		/// remove corner z of f from the VF list of v, walking the list as far as it
+		void removeVertexFace(VertexImpl* v, FaceImpl* f, int z){
+			if (v->VFp()==f and v->VFi()==z){
+				v->VFp() = f->VFp(z);
+				v->VFi() = f->VFi(z);
+				return;
+			}
+			for(vcg::face::VFIterator<FaceImpl> vfi(v);!vfi.End();++vfi){
+				FaceImpl* p = vfi.F();
+				const int i = vfi.I();
+				if (p->VFp(i)==f and p->VFi(i)==z){
+					p->VFp(i) = f->VFp(z);
+					p->VFi(i) = f->VFi(z);
+					return;
+				}
+			}
+			assert(!"removeVertexFace: the face isn't in the list");
+		}
+
+		void linkFaces(FaceImpl* a, int i, FaceImpl* b, int j){
+			a->FFp(i) = b;
+			a->FFi(i) = j;
+			b->FFp(j) = a;
+			b->FFi(j) = i;
+		}
+
+		/**
+		 * Find the border of the region e.faces, which must be a single loop (it can
+		 * run along a border of the mesh), and the region faces at each vertex of it.
+		 * Only the region and the faces around its border are visited.
+		 * @return an error message, or NULL
+		 */
+		const char* findBorder(MeshImpl& m, Extrusion& e){
+			VertexImpl* vbase = &m.vert[0];
+			FaceImpl* fbase = &m.face[0];
+			boost::unordered_set<unsigned int> inside(e.faces.begin(),e.faces.end());
+
+			// the border edge starting at each border vertex
+			boost::unordered_map<unsigned int,std::pair<unsigned int,int> > next;
+			for(unsigned int i=0;i<e.faces.size();i++){
+				FaceImpl& f = m.face[e.faces[i]];
+				for(int k=0;k<3;k++){
+					FaceImpl* g = f.FFp(k);
+					if (g!=&f and inside.count(g-fbase)) continue;
+					if (g!=&f and g->FFp(f.FFi(k))!=&f) return "has a non-manifold edge around it";
+					if (!next.insert(std::make_pair(f.V(k)-vbase,std::make_pair(e.faces[i],k))).second){
+						return "has faces whose border touches itself";
+					}
+				}
+			}
+			if (next.empty()) return "has faces with no border";
+
+			unsigned int a = next.begin()->first;
+			for(unsigned int j=0;j<next.size();j++){
+				if (j>0 and a==e.ring[0]) return "has faces whose border isn't a single loop";
+				boost::unordered_map<unsigned int,std::pair<unsigned int,int> >::const_iterator it = next.find(a);
+				if (it==next.end()) return "has faces whose border isn't a single loop";
+				FaceImpl& f = m.face[it->second.first];
+				const int k = it->second.second;
+				e.ring.push_back(a);
+				e.edgeFace.push_back(it->second.first);
+				e.edgeIndex.push_back(k);
+				if (f.FFp(k)==&f){
+					e.outer.push_back(NONE);
+					e.outerEdge.push_back(0);
+				}
+				else {
+					e.outer.push_back(f.FFp(k)-fbase);
+					e.outerEdge.push_back(f.FFi(k));
+				}
+				a = f.V((k+1)%3)-vbase;
+			}
+			if (a!=e.ring[0]) return "has faces whose border isn't a single loop";
+
+			e.corners.resize(e.ring.size());
+			for(unsigned int j=0;j<e.ring.size();j++){
+				for(vcg::face::VFIterator<FaceImpl> vfi(&m.vert[e.ring[j]]);!vfi.End();++vfi){
+					const unsigned int fi = vfi.F()-fbase;
+					if (inside.count(fi)) e.corners[j].push_back(std::make_pair(fi,vfi.I()));
+				}
+			}
+			return NULL;
+		}
+
+		/**
+		 * Detach the region of each extrusion from the rest of the mesh: its border
+		 * vertices are duplicated (the cap vertices, which start where the ring is)
+		 * and two side faces join each ring edge to the cap. The FF and VF adjacency
+		 * are patched locally, so the cost only depends on the size of the regions.
+		 * The regions must not overlap, but they can share ring edges.
+		 */
+		void stitch(MeshImpl& m, std::vector<Extrusion>& extrusions){
+			unsigned int numNew = 0;
+			EdgeOwners owners;
+			boost::unordered_set<unsigned int> inside;
+			for(unsigned int i=0;i<extrusions.size();i++){
+				const Extrusion& e = extrusions[i];
+				numNew += e.ring.size();
+				for(unsigned int j=0;j<e.ring.size();j++) owners[3*e.edgeFace[j]+e.edgeIndex[j]] = std::make_pair(i,j);
+				inside.insert(e.faces.begin(),e.faces.end());
+			}
+			if (numNew==0) return;
+
+			// Allocate everything at once, the existing elements don't move after this
+			_reserve(m,numNew,2*numNew);
+			const unsigned int firstVertex = m.vert.size();
+			const unsigned int firstFace = m.face.size();
+			vcg::tri::Allocator<MeshImpl>::AddVertices(m,numNew);
+			vcg::tri::Allocator<MeshImpl>::AddFaces(m,2*numNew);
+			for(unsigned int i=0,nv=firstVertex,nf=firstFace;i<extrusions.size();i++){
+				extrusions[i].firstVertex = nv;
+				extrusions[i].firstFace = nf;
+				nv += extrusions[i].ring.size();
+				nf += 2*extrusions[i].ring.size();
+			}
+
+			// Move the regions onto the caps and stitch the side faces in
+			// Each ring edge l[j],l[j+1] gets the side faces s1 = (l[j],l[j+1],c[j]) and s2 = (c[j],l[j+1],c[j+1])
+			BOOST_FOREACH(Extrusion& e, extrusions){
+				const unsigned int n = e.ring.size();
+				for(unsigned int j=0;j<n;j++){
+					const VertexImpl& l = m.vert[e.ring[j]];
+					VertexImpl& c = m.vert[e.firstVertex+j];
+					c.P() = l.cP();
+					c.N() = l.cN();
+					c.C() = l.cC();
+					c.T() = l.cT();
+					for(unsigned int k=0;k<e.corners[j].size();k++){
+						m.face[e.corners[j][k].first].V(e.corners[j][k].second) = &c;
+					}
+				}
+
+				for(unsigned int j=0;j<n;j++){
+					const unsigned int jn = (j+1)%n;
+					const unsigned int jp = (j+n-1)%n;
+					FaceImpl& f = m.face[e.edgeFace[j]];
+					FaceImpl* s1 = &m.face[e.firstFace+2*j];
+					FaceImpl* s2 = s1+1;
+					s1->V(0) = &m.vert[e.ring[j]];
+					s1->V(1) = &m.vert[e.ring[jn]];
+					s1->V(2) = &m.vert[e.firstVertex+j];
+					s2->V(0) = &m.vert[e.firstVertex+j];
+					s2->V(1) = &m.vert[e.ring[jn]];
+					s2->V(2) = &m.vert[e.firstVertex+jn];
+
+					linkFaces(&f,e.edgeIndex[j],s2,2);
+					linkFaces(s1,1,s2,0);
+					linkFaces(s1,2,&m.face[e.firstFace+2*jp+1],1);
+
+					if (e.outer[j]==NONE){
+						s1->FFp(0) = s1;
+						s1->FFi(0) = 0;
+						continue;
+					}
+					EdgeOwners::const_iterator it = owners.find(3*e.outer[j]+e.outerEdge[j]);
+					if (it==owners.end()){
+						linkFaces(s1,0,&m.face[e.outer[j]],e.outerEdge[j]);
+					}
+					else {
+						// two extrusions share this ring edge, so their side faces meet
+						const Extrusion& other = extrusions[it->second.first];
+						linkFaces(s1,0,&m.face[other.firstFace+2*it->second.second],0);
+					}
+				}
+			}
+
+			// Fix the VF lists of the ring vertices (which lose the regions and gain the side faces)
+			// and then make those of the cap vertices. The ring vertices are done first as
+			// their lists are walked and still pass through the faces of other regions.
+			std::vector<std::pair<FaceImpl*,int> > faces;
+			BOOST_FOREACH(Extrusion& e, extrusions){
+				const unsigned int n = e.ring.size();
+				for(unsigned int j=0;j<n;j++){
+					VertexImpl* l = &m.vert[e.ring[j]];
+					faces.clear();
+					for(vcg::face::VFIterator<FaceImpl> vfi(l);!vfi.End();++vfi){
+						if (inside.count(vfi.F()-&m.face[0])==0) faces.push_back(std::make_pair(vfi.F(),vfi.I()));
+					}
+					FaceImpl* s1 = &m.face[e.firstFace+2*j];
+					FaceImpl* s1p = &m.face[e.firstFace+2*((j+n-1)%n)];
+					faces.push_back(std::make_pair(s1,0));
+					faces.push_back(std::make_pair(s1p,1));
+					faces.push_back(std::make_pair(s1p+1,1));
+					linkVertexFaces(l,faces);
+				}
+			}
+			BOOST_FOREACH(Extrusion& e, extrusions){
+				const unsigned int n = e.ring.size();
+				for(unsigned int j=0;j<n;j++){
+					VertexImpl* c = &m.vert[e.firstVertex+j];
+					FaceImpl* s1 = &m.face[e.firstFace+2*j];
+					FaceImpl* s2p = &m.face[e.firstFace+2*((j+n-1)%n)+1];
+					faces.clear();
+					for(unsigned int k=0;k<e.corners[j].size();k++){
+						faces.push_back(std::make_pair(&m.face[e.corners[j][k].first],e.corners[j][k].second));
+					}
+					faces.push_back(std::make_pair(s1,2));
+					faces.push_back(std::make_pair(s1+1,0));
+					faces.push_back(std::make_pair(s2p,2));
+					linkVertexFaces(c,faces);
+				}
+			}
+		}
+
+		/// Detach the faces within width of v (see stitch), returning the vertices of those faces
+		std::set<VertexImpl*> extrudeRegion(MeshImpl& m, VertexImpl*& v, int width){
+			NRing ring(v);
+			ring.expand(width);
+
+			std::vector<Extrusion> extrusions(1);
+			Extrusion& e = extrusions[0];
+			e.centre = v-&m.vert[0];
+			BOOST_FOREACH(FaceImpl* f, ring.allF){
+				e.faces.push_back(f-&m.face[0]);
+			}
+			const char* msg = findBorder(m,e);
+			if (msg!=NULL) throw std::runtime_error(std::string("extrude: the vertex ")+msg);
+
+			stitch(m,extrusions);
+#ifdef FG_CHECK_TOPOLOGY
+			assert(_checkTopology(m));
+#endif
+
+			v = &m.vert[e.centre];
+			std::set<VertexImpl*> internalVerts;
+			BOOST_FOREACH(unsigned int fi, e.faces){
+				for(int k=0;k<3;k++) internalVerts.insert(m.face[fi].V(k));
+			}
+			return internalVerts;
+		}
+	}
+
+	std::set<Extrude::VertexPointer> Extrude::extrude(MyMesh* m, Vertex*& v, int width, vcg::Point3d direction, double length, double expand){
+		assert (width >= 1);
+
+		std::set<VertexPointer> internalVerts = extrudeRegion(*m,v,width);
+
+		// Shift each vertex
+		// And make sure they are aligned perpendicular to the extrusion direction
+		vcg::Point3d center = v->P();
+		double ddotd = direction.dot(direction);
+		double vdotd = center.dot(direction);
+		vcg::Point3d newCenter = center + direction*length;
+
+		BOOST_FOREACH(VertexPointer p, internalVerts){
+			if (p==v){
+				p->P() = newCenter;
+			}
+			else {
+				p->P() += direction*(length + (vdotd-p->P().dot(direction))/ddotd);
+
+				// plus the expansion
+				vcg::Point3d exp = (newCenter-p->P())*-expand;
+				p->P() += exp;
+			}
+		}
+		return internalVerts;
+	}
+
+	std::set<Extrude::VertexPointer> Extrude::extrude(MyMesh* m, Vertex*& v, int width, vcg::Point3d direction, double length)
+	{
+		assert (width >= 1);
+
+		std::set<VertexPointer> internalVerts = extrudeRegion(*m,v,width);
+
+		// Shift each vertex
+		Vec3 diff = direction*length;
+		BOOST_FOREACH(VertexPointer p, internalVerts){
+			p->P() += diff;
+		}
+		return internalVerts;
+	}
+
+	std::vector<std::vector<Extrude::VertexPointer> > Extrude::extrudeMany(MyMesh* m, const std::vector<VertexPointer>& centres, const std::vector<vcg::Point3d>& directions, const std::vector<double>& magnitudes){
+		assert(centres.size()==directions.size() and centres.size()==magnitudes.size());
+
+		// 1. Find and check every fan before touching the mesh
+		std::vector<Extrusion> extrusions(centres.size());
+		boost::unordered_map<unsigned int,unsigned int> regions; // which extrusion a face is in
+		for(unsigned int i=0;i<centres.size();i++){
+			Vertex* v = centres[i];
+			if (v==NULL or v->IsD()) extrudeError(i,"doesn't exist");
+			if (directions[i].SquaredNorm()==0) extrudeError(i,"has no direction");
+
+			Extrusion& e = extrusions[i];
+			e.centre = v - &m->vert[0];
+			e.direction = directions[i];
+			e.magnitude = magnitudes[i];
+			for(vcg::face::VFIterator<Face> vfi(v);!vfi.End();++vfi){
+				const unsigned int fi = vfi.F() - &m->face[0];
+				if (!regions.insert(std::make_pair(fi,i)).second){
+					std::ostringstream oss;
+					oss << "is too close to vertex " << (regions[fi]+1) << ", their faces overlap";
+					extrudeError(i,oss.str().c_str());
+				}
+				e.faces.push_back(fi);
+			}
+			if (e.faces.size()<3) extrudeError(i,"has too few faces");
+
+			const char* msg = findBorder(*m,e);
+			if (msg!=NULL) extrudeError(i,msg);
+			if (std::find(e.ring.begin(),e.ring.end(),e.centre)!=e.ring.end()) extrudeError(i,"is on a border");
+		}
+
+		// 2. Stitch the fans in, then put the caps in the plane perpendicular
+		// to the direction (like extrude() in core/extrude.lua) and move the centre
+		stitch(*m,extrusions);
+#ifdef FG_CHECK_TOPOLOGY
+		assert(_checkTopology(*m));
+#endif
+
+		std::vector<std::vector<VertexPointer> > caps(extrusions.size());
+		for(unsigned int i=0;i<extrusions.size();i++){
+			const Extrusion& e = extrusions[i];
+			Vertex& centre = m->vert[e.centre];
+			const vcg::Point3d v0 = centre.P();
+			const vcg::Point3d& d = e.direction;
+			const double ddotd = d*d;
+			for(unsigned int j=0;j<e.ring.size();j++){
+				Vertex* c = &m->vert[e.firstVertex+j];
+				c->P() += d*(e.magnitude + ((v0-c->P())*d)/ddotd);
+				caps[i].push_back(c);
+			}
+			centre.P() = v0 + d*e.magnitude;
+		}
+		return caps;
+	}
+
+	void Extrude::splitEdge(MyMesh* m, Extrude::Pos& pos){
+		/*
+		 * Given pos = (v,e,f), with the edge a->b in f1 and b->a in f2
+		 *
+		 *     c              c
+		 *    / \            /|\
+		 *   / f1\          / | \
+		 *  a-----b  ==>   a--m--b
+		 *   \ f2/          \ | /
+		 *    \ /            \|/
+		 *     d              d
+		 *
+		 * f1 becomes (a,m,c) and f2 (b,m,d), in place, and the new faces are
+		 * g1 = (m,b,c) and g2 = (m,a,d). At a border there is no f2 (or g2).
+		 * Only the adjacency of these faces and their neighbours is updated.
+		 */
+		const int z1 = pos.E();
+		{
+			FacePointer f = pos.F();
+			if (f->FFp(z1)!=f and f->FFp(z1)->FFp(f->FFi(z1))!=f) throw std::runtime_error("split_edge: the edge isn't manifold");
+		}
+
+		// NOTE: pos is now useless/invalid, as the faces may move here
+		const unsigned int fi = pos.F() - &m->face[0];
+		_reserve(*m,1,2);
+		FacePointer f1 = &m->face[fi];
+		FacePointer f2 = f1->FFp(z1);
+		const int z2 = f1->FFi(z1);
+		const bool border = (f2==f1);
+		VertexPointer a = f1->V(z1);
+		VertexPointer b = f1->V((z1+1)%3);
+		VertexPointer c = f1->V((z1+2)%3);
+		VertexPointer d = border?NULL:f2->V((z2+2)%3);
+
+		VertexPointer vm = &*vcg::tri::Allocator<MyMesh>::AddVertices(*m,1);
+		vm->P() = (a->P() + b->P())/2;
+		vm->N() = a->N() + b->N();
+		if (vm->N().SquaredNorm()>0) vm->N().Normalize();
+		else vm->N() = a->N();
+		for(int k=0;k<4;k++) vm->C()[k] = (unsigned char)(((int)a->C()[k]+b->C()[k]+1)/2);
+		vm->T().P() = (a->T().P()+b->T().P())*0.5;
+		vm->T().N() = a->T().N();
+
+		FacePointer g1 = &*vcg::tri::Allocator<MyMesh>::AddFaces(*m,border?1:2);
+		FacePointer g2 = border?NULL:g1+1;
+
+		// the faces that were on the edges moving to g1 and g2
+		FacePointer n1 = f1->FFp((z1+1)%3);
+		const int i1 = f1->FFi((z1+1)%3);
+		FacePointer n2 = border?NULL:f2->FFp((z2+1)%3);
+		const int i2 = border?0:f2->FFi((z2+1)%3);
+
+		// b leaves f1 (and a leaves f2) for m
+		removeVertexFace(b,f1,(z1+1)%3);
+		f1->V((z1+1)%3) = vm;
+		g1->V(0) = vm; g1->V(1) = b; g1->V(2) = c;
+		if (!border){
+			removeVertexFace(a,f2,(z2+1)%3);
+			f2->V((z2+1)%3) = vm;
+			g2->V(0) = vm; g2->V(1) = a; g2->V(2) = d;
+		}
+
+		linkFaces(f1,(z1+1)%3,g1,2);
+		if (n1==f1) linkFaces(g1,1,g1,1);
+		else linkFaces(g1,1,n1,i1);
+		if (border){
+			linkFaces(f1,z1,f1,z1);
+			linkFaces(g1,0,g1,0);
+		}
+		else {
+			linkFaces(f2,(z2+1)%3,g2,2);
+			if (n2==f2) linkFaces(g2,1,g2,1);
+			else linkFaces(g2,1,n2,i2);
+			linkFaces(f1,z1,g2,0);
+			linkFaces(g1,0,f2,z2);
+		}
+
+		vm->VFp() = NULL;
+		vm->VFi() = 0;
+		addVertexFace(vm,f1,(z1+1)%3);
+		addVertexFace(vm,g1,0);
+		addVertexFace(b,g1,1);
+		addVertexFace(c,g1,2);
+		if (!border){
+			addVertexFace(vm,f2,(z2+1)%3);
+			addVertexFace(vm,g2,0);
+			addVertexFace(a,g2,1);
+			addVertexFace(d,g2,2);
+		}
+
+#ifdef FG_CHECK_TOPOLOGY
+		assert(_checkTopology(*m));
+#endif
+	}
+
+	namespace {
+		/// the number of faces around v, and whether v is on a border
+		unsigned int countFaces(VertexImpl* v, bool& border){
+			unsigned int n = 0;
+			border = false;
+			for(vcg::face::VFIterator<FaceImpl> vfi(v);!vfi.End();++vfi){
+				FaceImpl* f = vfi.F();
+				const int z = vfi.I();
+				if (f->FFp(z)==f or f->FFp((z+2)%3)==f) border = true;
+				n++;
+			}
+			return n;
+		}
+
+		/// whether v would still have enough faces around it with one less
+		bool canLoseFace(VertexImpl* v){
+			bool border;
+			const unsigned int n = countFaces(v,border);
+			return n>(border?1u:3u);
+		}
+
+		/// whether there is an edge between a and b
+		bool isEdge(VertexImpl* a, VertexImpl* b){
+			for(vcg::face::VFIterator<FaceImpl> vfi(a);!vfi.End();++vfi){
+				if (vfi.F()->V((vfi.I()+1)%3)==b or vfi.F()->V((vfi.I()+2)%3)==b) return true;
+			}
+			return false;
+		}
+	}
+
+	bool Extrude::flipEdge(MyMesh* m, Extrude::Pos& pos){
+		/*
+		 * Given pos = (v,e,f), with the edge a->b in f1 and b->a in f2
+		 *
+		 *     c              c
+		 *    / \            /|\
+		 *   / f1\          / | \
+		 *  a-----b  ==>   a f1|f2 b
+		 *   \ f2/          \ | /
+		 *    \ /            \|/
+		 *     d              d
+		 *
+		 * f1 becomes (a,d,c) and f2 (b,c,d), in place.
+		 */
+		FacePointer f1 = pos.F();
+		const int z1 = pos.E();
+		FacePointer f2 = f1->FFp(z1);
+		const int z2 = f1->FFi(z1);
+		if (f2==f1 or f2->FFp(z2)!=f1) return false;
+
+		VertexPointer a = f1->V(z1);
+		VertexPointer b = f1->V((z1+1)%3);
+		VertexPointer c = f1->V((z1+2)%3);
+		VertexPointer d = f2->V((z2+2)%3);
+		if (c==d or isEdge(c,d) or !canLoseFace(a) or !canLoseFace(b)) return false;
+
+		// the faces that were on the edges changing sides
+		FacePointer n1 = f1->FFp((z1+1)%3);
+		const int i1 = f1->FFi((z1+1)%3);
+		FacePointer n2 = f2->FFp((z2+1)%3);
+		const int i2 = f2->FFi((z2+1)%3);
+
+		removeVertexFace(b,f1,(z1+1)%3);
+		removeVertexFace(a,f2,(z2+1)%3);
+		f1->V((z1+1)%3) = d;
+		f2->V((z2+1)%3) = c;
+		addVertexFace(d,f1,(z1+1)%3);
+		addVertexFace(c,f2,(z2+1)%3);
+
+		linkFaces(f1,(z1+1)%3,f2,(z2+1)%3);
+		if (n2==f2) linkFaces(f1,z1,f1,z1);
+		else linkFaces(f1,z1,n2,i2);
+		if (n1==f1) linkFaces(f2,z2,f2,z2);
+		else linkFaces(f2,z2,n1,i1);
+
+#ifdef FG_CHECK_TOPOLOGY
+		assert(_checkTopology(*m));
+#endif
+		return true;
+	}
+
+	bool Extrude::collapseEdge(MyMesh* m, Extrude::Pos& pos, const vcg::Point3d& position){
+		/*
+		 * Given pos = (v,e,f), with the edge a->b (either way around) in f1 and b->a in f2,
+		 * and v = a, the faces f1 and f2 are deleted, b is deleted and its faces use a instead.
+		 *
+		 *     c              c
+		 *    / \             |
+		 *   / f1\            |
+		 *  a-----b  ==>      a
+		 *   \ f2/            |
+		 *    \ /             |
+		 *     d              d
+		 */
+		FacePointer f1 = pos.F();
+		const int z1 = pos.E();
+		FacePointer f2 = f1->FFp(z1);
+		const int z2 = f1->FFi(z1);
+		const bool border = (f2==f1);
+		if (!border and f2->FFp(z2)!=f1) return false;
+
+		VertexPointer a = pos.V();
+		VertexPointer b = (f1->V(z1)==a)?f1->V((z1+1)%3):f1->V(z1);
+		VertexPointer c = f1->V((z1+2)%3);
+		VertexPointer d = border?NULL:f2->V((z2+2)%3);
+		if (c==d or !canLoseFace(c) or (!border and !canLoseFace(d))) return false;
+
+		// The link condition: a and b can only share the neighbours across the edge
+		boost::unordered_set<VertexPointer> around;
+		bool borderA = false, borderB = false;
+		for(vcg::face::VFIterator<Face> vfi(a);!vfi.End();++vfi){
+			around.insert(vfi.F()->V((vfi.I()+1)%3));
+			around.insert(vfi.F()->V((vfi.I()+2)%3));
+			if (vfi.F()->FFp(vfi.I())==vfi.F() or vfi.F()->FFp((vfi.I()+2)%3)==vfi.F()) borderA = true;
+		}
+		for(vcg::face::VFIterator<Face> vfi(b);!vfi.End();++vfi){
+			for(int k=1;k<3;k++){
+				VertexPointer n = vfi.F()->V((vfi.I()+k)%3);
+				if (n!=a and n!=c and n!=d and around.count(n)) return false;
+			}
+			if (vfi.F()->FFp(vfi.I())==vfi.F() or vfi.F()->FFp((vfi.I()+2)%3)==vfi.F()) borderB = true;
+		}
+		// joining two borders through the inside would pinch the mesh
+		if (!border and borderA and borderB) return false;
+
+		// The neighbours across the other edges of f1 and f2 become neighbours
+		const FacePointer gone[2] = {f1,f2};
+		const int edge[2] = {z1,z2};
+		for(int i=0;i<(border?1:2);i++){
+			FacePointer f = gone[i];
+			const int e1 = (edge[i]+1)%3;
+			const int e2 = (edge[i]+2)%3;
+			FacePointer g1 = f->FFp(e1);
+			const int i1 = f->FFi(e1);
+			FacePointer g2 = f->FFp(e2);
+			const int i2 = f->FFi(e2);
+			if (g1==f and g2==f) continue; // an ear, canLoseFace rules it out
+			else if (g1==f) linkFaces(g2,i2,g2,i2);
+			else if (g2==f) linkFaces(g1,i1,g1,i1);
+			else linkFaces(g1,i1,g2,i2);
+		}
+
+		// The opposite vertices lose their face, a gets the faces of b
+		removeVertexFace(c,f1,(z1+2)%3);
+		if (!border) removeVertexFace(d,f2,(z2+2)%3);
+		std::vector<std::pair<FaceImpl*,int> > faces;
+		for(vcg::face::VFIterator<Face> vfi(a);!vfi.End();++vfi){
+			if (vfi.F()!=f1 and vfi.F()!=f2) faces.push_back(std::make_pair(vfi.F(),vfi.I()));
+		}
+		for(vcg::face::VFIterator<Face> vfi(b);!vfi.End();++vfi){
+			if (vfi.F()!=f1 and vfi.F()!=f2) faces.push_back(std::make_pair(vfi.F(),vfi.I()));
+		}
+		for(unsigned int i=0;i<faces.size();i++){
+			faces[i].first->V(faces[i].second) = a;
+		}
+		linkVertexFaces(a,faces);
+		a->P() = position;
+
+		b->VFp() = NULL;
+		b->VFi() = 0;
+		vcg::tri::Allocator<MyMesh>::DeleteVertex(*m,*b);
+		vcg::tri::Allocator<MyMesh>::DeleteFace(*m,*f1);
+		if (!border) vcg::tri::Allocator<MyMesh>::DeleteFace(*m,*f2);
+
+#ifdef FG_CHECK_TOPOLOGY
+		assert(_checkTopology(*m));
+#endif
+		return true;
+	}
+
+	/**
+	 * Checks if loop is a connected closed edge loop.
+	 *
+	 * @param loop
+	 * @return
+	 */
+	bool Extrude::isEdgeLoop(std::vector<MyMesh::VertexPointer>& loop){
+		//std::cout << "isEdgeLoop: loop.size = " << loop.size() << "\n";
+
+		if (loop.size()<3) return false;
+		MyMesh::VertexPointer p = loop[loop.size()-1];
+		BOOST_FOREACH(MyMesh::VertexPointer np, loop){
+			// p should be connected to np
+			bool isPConnectedToNP = false;
+			vcg::face::VFIterator<MyMesh::FaceType> vfi(p);
+			while(!vfi.End()){
+				if (vfi.f->V(0)==np || vfi.f->V(1)==np || vfi.f->V(2)==np)
+				{
+					isPConnectedToNP = true;
+					break;
+				}
+				++vfi;
+			}
+
+			if (!isPConnectedToNP){
+				return false;
+			}
+			p = np;
+		}
+		return true;
+	}
+}
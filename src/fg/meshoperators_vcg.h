@@ -38,6 +38,11 @@ namespace fg {
 	/**
 	 * \brief Operators which act directly on the vcg implementation of a mesh.
 	 *
+	 * The operators patch the FF and VF adjacency of the faces they touch rather
+	 * than rebuilding it, so their cost doesn't depend on the size of the mesh.
+	 * If FG_CHECK_TOPOLOGY is defined the whole topology is checked afterwards
+	 * (see fg::_checkTopology), which is slow, so it is off by default.
+	 *
 	 * NB: Vertex* is a vcg::Mesh::Vertex, not a fg::Vertex!
 	 */
 	class Extrude {
@@ -52,28 +57,52 @@ namespace fg {
 		typedef MyMesh::FaceIterator FaceIterator;
 		typedef vcg::face::Pos<fg::FaceImpl> Pos;
 
-		typedef std::vector<VertexPointer*> VPUpdateList;
-		typedef std::vector<FacePointer*> FPUpdateList;
-
 		/**
 		 * Extrudes the set of triangles within distance w in the specified direction and magnitude
+		 * Throws std::runtime_error if the border of the triangles isn't a single loop.
 		 * @param m
 		 * @param v
-		 * @param vpul
 		 * @param w
 		 * @param direction
 		 * @param magnitude
 		 * @return
 		 */
-		static std::set<VertexPointer> extrude(MyMesh* m, Vertex*& v, VPUpdateList& vpul, FPUpdateList& fpul, int w, vcg::Point3d direction, double magnitude);
+		static std::set<VertexPointer> extrude(MyMesh* m, Vertex*& v, int w, vcg::Point3d direction, double magnitude);
 
-		/// Splits the edge specified by Pos
-		static void splitEdge(MyMesh* m, Pos& p, VPUpdateList& vpul, FPUpdateList& fpul);
+		/**
+		 * Extrudes the one-ring of faces around each of the centres at once (see fg::extrudeMany).
+		 * The fans are all checked before the mesh is modified, and the adjacency is patched locally.
+		 * Throws std::runtime_error if a centre is on a border, isn't manifold, or its fan overlaps another.
+		 * @return the cap loop of each extrusion
+		 */
+		static std::vector<std::vector<VertexPointer> > extrudeMany(MyMesh* m, const std::vector<VertexPointer>& centres, const std::vector<vcg::Point3d>& directions, const std::vector<double>& magnitudes);
+
+		/**
+		 * Splits the edge specified by Pos at its midpoint, and the faces on either side of it in two.
+		 * Each face keeps its slot as the half at the start of the edge (in that face), the new vertex
+		 * interpolates the attributes of the edge. Throws std::runtime_error if the edge isn't manifold.
+		 */
+		static void splitEdge(MyMesh* m, Pos& p);
+
+		/**
+		 * Flips the edge specified by Pos, so it joins the other corners of the two faces on it.
+		 * The faces keep their slots. Returns false (and does nothing) if the edge is a border or
+		 * non-manifold, the other corners are already joined, or an end would have too few faces.
+		 */
+		static bool flipEdge(MyMesh* m, Pos& p);
+
+		/**
+		 * Collapses the edge specified by Pos into its vertex Pos::V(), which is moved to position.
+		 * The other vertex of the edge and the faces on it are deleted (not removed, see Mesh::compact).
+		 * Returns false (and does nothing) if the result wouldn't be manifold, e.g., the ends of the
+		 * edge share other neighbours or are on different parts of a border.
+		 */
+		static bool collapseEdge(MyMesh* m, Pos& p, const vcg::Point3d& position);
 
 		static bool isEdgeLoop(std::vector<VertexPointer>& loop);
 
 		/// \deprecated Use the simpler extrude instead
-		static std::set<VertexPointer> extrude(MyMesh* m, Vertex*& v, VPUpdateList& vpul, FPUpdateList& fpul, int width, vcg::Point3d direction, double length, double expand);
+		static std::set<VertexPointer> extrude(MyMesh* m, Vertex*& v, int width, vcg::Point3d direction, double length, double expand);
 	private:
 		static void error(const char* msg);
 	};
@@ -0,0 +1,117 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/meshsnapshot.h"
+#include "fg/mesh.h"
+#include "fg/meshimpl.h"
+
+namespace fg {
+	MeshSnapshot::MeshSnapshot()
+	:positions()
+	,normals()
+	,texcoords()
+	,colours()
+	,indices()
+	,remap()
+	,version(0)
+	,topologyVersion(0)
+	{}
+
+	MeshSnapshot::MeshSnapshot(Mesh* m)
+	:positions()
+	,normals()
+	,texcoords()
+	,colours()
+	,indices()
+	,remap()
+	,version(0)
+	,topologyVersion(0)
+	{
+		build(m);
+	}
+
+	void MeshSnapshot::clear(){
+		positions.clear();
+		normals.clear();
+		texcoords.clear();
+		colours.clear();
+		indices.clear();
+		remap.clear();
+	}
+
+	void MeshSnapshot::build(Mesh* m){
+		const MeshImpl& mi = *m->_constImpl();
+
+		// count the live elements rather than trust vn and fn, which operators can leave out of date
+		unsigned int numVertices = 0, numFaces = 0;
+		for(unsigned int i=0;i<mi.vert.size();i++){
+			if (!mi.vert[i].IsD()) numVertices++;
+		}
+		if (!mi.vert.empty()){
+			for(unsigned int i=0;i<mi.face.size();i++){
+				if (!mi.face[i].IsD()) numFaces++;
+			}
+		}
+
+		positions.resize(3*numVertices);
+		normals.resize(3*numVertices);
+		texcoords.resize(2*numVertices);
+		colours.resize(4*numVertices);
+		indices.resize(3*numFaces);
+		remap.assign(mi.vert.size(),0);
+
+		unsigned int n = 0;
+		for(unsigned int i=0;i<mi.vert.size();i++){
+			const VertexImpl& v = mi.vert[i];
+			if (v.IsD()) continue;
+			remap[i] = n;
+			for(int k=0;k<3;k++){
+				positions[3*n+k] = v.cP()[k];
+				normals[3*n+k] = v.cN()[k];
+			}
+			for(int k=0;k<4;k++){
+				colours[4*n+k] = v.cC()[k];
+			}
+			texcoords[2*n] = v.cT().U();
+			texcoords[2*n+1] = v.cT().V();
+			n++;
+		}
+
+		unsigned int nf = 0;
+		if (!mi.vert.empty()){
+			const VertexImpl* base = &mi.vert[0];
+			for(unsigned int i=0;i<mi.face.size();i++){
+				const FaceImpl& f = mi.face[i];
+				if (f.IsD()) continue;
+				for(int k=0;k<3;k++){
+					indices[3*nf+k] = remap[f.cV(k) - base];
+				}
+				nf++;
+			}
+		}
+
+		version = m->getVersion();
+		topologyVersion = m->getTopologyVersion();
+	}
+}
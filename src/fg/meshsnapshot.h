@@ -0,0 +1,72 @@
+/**
+ * \file
+ * \brief A compact copy of the renderable data in a mesh
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_MESHSNAPSHOT_H
+#define FG_MESHSNAPSHOT_H
+
+#include <vector>
+
+namespace fg {
+	// forward decl
+	class Mesh;
+
+	/**
+	 * \brief A structure-of-arrays, single precision copy of a mesh.
+	 *
+	 * MeshImpl stores a lot per vertex (double precision attributes, adjacency,
+	 * bones, flags) so code that only wants to draw or write out a mesh ends up
+	 * striding over data it never uses. A snapshot gathers just the positions,
+	 * normals, colours, texcoords and triangle indices into tightly packed
+	 * arrays in one pass, skipping deleted vertices and faces.
+	 *
+	 * A snapshot doesn't refer back to the mesh, so once built it can be handed
+	 * to another thread while the mesh keeps changing.
+	 */
+	class MeshSnapshot {
+	public:
+		MeshSnapshot();
+		MeshSnapshot(Mesh* m);
+
+		/// \brief Replace the contents with the current state of m. Call m->sync() first if the normals matter.
+		void build(Mesh* m);
+
+		void clear();
+
+		unsigned int numVertices() const {return positions.size()/3;}
+		unsigned int numFaces() const {return indices.size()/3;}
+
+		std::vector<float> positions; ///< 3 per vertex
+		std::vector<float> normals; ///< 3 per vertex
+		std::vector<float> texcoords; ///< 2 per vertex
+		std::vector<unsigned char> colours; ///< 4 per vertex (rgba, as stored by vcg)
+		std::vector<unsigned int> indices; ///< 3 per face, into the arrays above
+		std::vector<unsigned int> remap; ///< MeshImpl vertex index to snapshot index (deleted vertices map to 0)
+
+		unsigned int version; ///< the mesh version the snapshot was built from
+		unsigned int topologyVersion; ///< the mesh topology version the snapshot was built from
+	};
+}
+
+#endif
@@ -0,0 +1,127 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/nring.h"
+
+#include <utility>
+
+#include <boost/unordered_map.hpp>
+
+#include <vcg/simplex/face/pos.h>
+
+namespace fg {
+	NRing::NRing(VertexImpl* v)
+	:allV()
+	,allF()
+	,lastV()
+	,lastF()
+	,mVisitedV()
+	,mVisitedF()
+	{
+		add(v);
+	}
+
+	void NRing::expand(){
+		std::vector<VertexImpl*> previous;
+		previous.swap(lastV);
+		lastF.clear();
+		for(unsigned int i=0;i<previous.size();i++){
+			for(vcg::face::VFIterator<FaceImpl> vfi(previous[i]);!vfi.End();++vfi){
+				add(vfi.F());
+			}
+		}
+		order();
+	}
+
+	void NRing::expand(int n){
+		for(int i=0;i<n;i++) expand();
+	}
+
+	void NRing::add(VertexImpl* v){
+		if (mVisitedV.insert(v).second){
+			allV.push_back(v);
+			lastV.push_back(v);
+		}
+	}
+
+	void NRing::add(FaceImpl* f){
+		if (f->IsD() or !mVisitedF.insert(f).second) return;
+		allF.push_back(f);
+		lastF.push_back(f);
+		for(int i=0;i<3;i++) add(f->V(i));
+	}
+
+	void NRing::order(){
+		if (lastV.size()<2) return;
+
+		// The new vertices are the border of the faces collected so far. The border
+		// edges all belong to the new faces, they are the edges between two new vertices
+		// whose opposite half-edge isn't in a new face.
+		boost::unordered_set<VertexImpl*> ring(lastV.begin(),lastV.end());
+		typedef std::pair<VertexImpl*,VertexImpl*> Edge;
+		std::vector<Edge> edges;
+		for(unsigned int i=0;i<lastF.size();i++){
+			for(int j=0;j<3;j++){
+				VertexImpl* a = lastF[i]->V(j);
+				VertexImpl* b = lastF[i]->V((j+1)%3);
+				if (ring.count(a) and ring.count(b)) edges.push_back(Edge(a,b));
+			}
+		}
+
+		boost::unordered_multimap<VertexImpl*,VertexImpl*> next; // border half-edges by their first vertex
+		boost::unordered_set<VertexImpl*> hasPrevious;
+		{
+			boost::unordered_set<Edge> all(edges.begin(),edges.end());
+			for(unsigned int i=0;i<edges.size();i++){
+				if (all.count(Edge(edges[i].second,edges[i].first))) continue;
+				next.insert(edges[i]);
+				hasPrevious.insert(edges[i].second);
+			}
+		}
+
+		// Walk the border. Open chains (where the ring runs into a mesh border) are walked
+		// from their first vertex, then the closed loops, both in the order the vertices were found.
+		std::vector<VertexImpl*> ordered;
+		ordered.reserve(lastV.size());
+		boost::unordered_set<VertexImpl*> done;
+		for(int pass=0;pass<2;pass++){
+			for(unsigned int i=0;i<lastV.size();i++){
+				VertexImpl* v = lastV[i];
+				if (done.count(v) or (pass==0 and hasPrevious.count(v))) continue;
+				ordered.push_back(v);
+				done.insert(v);
+				while (true){
+					boost::unordered_multimap<VertexImpl*,VertexImpl*>::iterator it = next.find(v);
+					if (it==next.end()) break;
+					v = it->second;
+					next.erase(it);
+					if (done.insert(v).second) ordered.push_back(v);
+				}
+			}
+		}
+
+		std::copy(ordered.begin(),ordered.end(),allV.end()-lastV.size());
+		lastV.swap(ordered);
+	}
+}
@@ -0,0 +1,73 @@
+/**
+ * \file
+ * \brief Expanding rings of vertices and faces around a vertex
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_NRING_H
+#define FG_NRING_H
+
+#include <vector>
+
+#include <boost/unordered_set.hpp>
+
+#include "fg/meshimpl.h"
+
+namespace fg {
+	/**
+	 * \brief The n-ring of a vertex, a replacement for vcg::tri::Nring.
+	 *
+	 * vcg's Nring marks the visited elements with the V flag, so the flags of
+	 * the whole mesh have to be cleared before each use. NRing keeps its own
+	 * visited sets instead, so its cost only depends on the size of the ring
+	 * and it doesn't modify the mesh. It walks the faces around a vertex with
+	 * the VF adjacency, so it also works at mesh borders.
+	 *
+	 * After expand(n), lastV holds the vertices n edges from the centre in
+	 * cyclic order (following the winding of the faces). If the ring isn't a
+	 * single loop (e.g., it reaches a border or wraps around a handle) each
+	 * loop or open chain is listed in turn.
+	 */
+	class NRing {
+	public:
+		NRing(VertexImpl* v);
+
+		/// \brief Add the next ring
+		void expand();
+		void expand(int n);
+
+		std::vector<VertexImpl*> allV; ///< every vertex so far, ring by ring
+		std::vector<FaceImpl*> allF; ///< every face so far
+		std::vector<VertexImpl*> lastV; ///< the vertices in the outermost ring
+		std::vector<FaceImpl*> lastF; ///< the faces added by the last expand()
+
+	private:
+		void add(VertexImpl* v);
+		void add(FaceImpl* f);
+		void order();
+
+		boost::unordered_set<VertexImpl*> mVisitedV;
+		boost::unordered_set<FaceImpl*> mVisitedF;
+	};
+}
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/parallel.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace fg {
+	int Parallel::sNumThreads = 0;
+	int Parallel::sMinParallelSize = 10000;
+
+	void Parallel::setNumThreads(int n){
+		sNumThreads = n<0?0:n;
+	}
+
+	int Parallel::getNumThreads(){
+#ifdef _OPENMP
+		return sNumThreads==0?omp_get_num_procs():sNumThreads;
+#else
+		return 1;
+#endif
+	}
+
+	void Parallel::setMinParallelSize(int n){
+		sMinParallelSize = n;
+	}
+
+	int Parallel::getMinParallelSize(){
+		return sMinParallelSize;
+	}
+
+	int Parallel::threadsFor(int n){
+		if (n<sMinParallelSize) return 1;
+		return getNumThreads();
+	}
+
+	int Parallel::threadIndex(){
+#ifdef _OPENMP
+		return omp_get_thread_num();
+#else
+		return 0;
+#endif
+	}
+}
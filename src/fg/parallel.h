@@ -0,0 +1,62 @@
+/**
+ * \file
+ * \brief Settings for the multithreaded code paths
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_PARALLEL_H
+#define FG_PARALLEL_H
+
+namespace fg {
+	/**
+	 * \brief Controls how many threads the parallel loops in fg use
+	 * (e.g., Mesh::syncAll() and Mesh::getBounds()).
+	 *
+	 * The loops use OpenMP, if fg was built without it everything runs on
+	 * the calling thread. The parallel loops are written so that their
+	 * results don't depend on the number of threads.
+	 */
+	class Parallel {
+	public:
+		/// \brief Set the number of threads (0 uses every core, 1 disables threading). Default is 0.
+		static void setNumThreads(int n);
+
+		/// \brief The number of threads a large loop will use
+		static int getNumThreads();
+
+		/// \brief Loops over fewer than n elements run on a single thread (default 10000)
+		static void setMinParallelSize(int n);
+		static int getMinParallelSize();
+
+		/// \brief The number of threads to use for a loop over n elements
+		static int threadsFor(int n);
+
+		/// \brief The index of the calling thread within a parallel region (0 outside of one)
+		static int threadIndex();
+
+	private:
+		static int sNumThreads;
+		static int sMinParallelSize;
+	};
+}
+
+#endif
@@ -28,7 +28,6 @@
 #include <ostream>
 #include <iostream>
 #include <vector>
-#include <list>
 
 #include <boost/foreach.hpp>
 #include <boost/ref.hpp>
@@ -59,87 +58,130 @@ namespace fg {
 	};
 
 	/**
-	 * \brief Proxy provides a simple wrapper around a pointer to an object of type T.
+	 * \brief A Handle identifies an element of a HandleTable.
+	 *
+	 * It stores the slot the table gave the element and the generation of that
+	 * slot when the handle was created. When the element is removed its slot is
+	 * freed and its generation bumped, so the handle resolves to NULL even after
+	 * the slot is given to another element.
+	 */
+	struct Handle {
+		static const unsigned int INVALID = 0xffffffff;
+
+		Handle(unsigned int s = INVALID, unsigned int g = 0):slot(s),generation(g){}
+		bool isNull() const {return slot==INVALID;}
+
+		unsigned int slot;
+		unsigned int generation;
+	};
+
+	/**
+	 * \brief A HandleTable resolves Handles to elements of a std::vector<T>.
+	 *
+	 * Each element that a handle has been made for gets a slot, which holds
+	 * its current index in the vector. Elements nobody has a handle to cost
+	 * nothing, and the vector is free to reallocate. T must provide IsD() (as
+	 * the vcg vertex and face types do); deleted elements resolve to NULL.
+	 *
+	 * When the container is compacted the owner calls remap(), which moves the
+	 * slots to the new indices and frees the slots of the removed elements. So
+	 * the table never holds more than one slot per element, however many times
+	 * the container is compacted, and a handle resolves in constant time.
+	 */
+	template <class T>
+	class HandleTable {
+	public:
+		HandleTable(std::vector<T>* container);
+
+		/// \brief Make a handle to t, which must be an element of the container (or NULL)
+		Handle handle(const T* t) const;
+
+		/// \brief Resolve h, returns NULL if the element is gone
+		T* get(const Handle& h) const;
+
+		/// \brief Invalidate every existing handle to the element at index i (e.g., when it is deleted)
+		void invalidate(unsigned int i);
+
+		/// \brief Invalidate every existing handle (e.g., when the container is refilled)
+		void invalidateAll();
+
+		/**
+		 * \brief Update the slots after the container has been reordered.
+		 *
+		 * newIndex[i] is the new index of the element that was at i, or
+		 * Handle::INVALID if it was removed.
+		 */
+		void remap(const std::vector<unsigned int>& newIndex);
+
+		/// \brief Point the table at a copy of the container (with the same layout)
+		void setContainer(std::vector<T>* container){mContainer = container;}
+
+		/// \brief The number of slots in use
+		unsigned int size() const {return mIndex.size() - mFree.size();}
+
+	private:
+		/// give slot s back, bumping its generation
+		void release(unsigned int s) const;
+
+		std::vector<T>* mContainer;
+		mutable std::vector<unsigned int> mSlot; ///< the slot of each element (INVALID if it has none), grown on demand
+		mutable std::vector<unsigned int> mIndex; ///< the element in each slot (INVALID if the slot is free)
+		mutable std::vector<unsigned int> mGenerations; ///< of each slot
+		mutable std::vector<unsigned int> mFree; ///< the free slots
+	};
+
+	/**
+	 * \brief Proxy provides a safe wrapper around an element of a HandleTable.
 	 * 
 	 * Proxy is used to provide safe access to a potentially volatile object (esp. across the C++/Lua boundary.) See e.g., fg::VertexProxy .
+	 * The object is looked up through its handle on every access, so a proxy
+	 * stays valid when the underlying storage moves and becomes invalid when the
+	 * object is deleted.
 	 */
 	template <class T>
 	class Proxy {
 	public:
-		Proxy(T* t):mImpl(t){}
+		Proxy(HandleTable<T>* table, T* t):mTable(table),mHandle(table->handle(t)){}
 
 		/**
-		 * @return Reference to the internal pointer
+		 * @return The internal pointer, or NULL if the object is gone
 		 */
-		T*& pImpl() {
+		T* pImpl() const {
+			T* t = resolve();
 			if (ProxySettings::DEBUG_CHECK_IS_VALID){
-				if (mImpl==NULL){
+				if (t==NULL){
 					ProxySettings::DEBUG_OSTREAM << "<Warning> Accessing invalid proxy! (Proxy@" << this << ")";
 				}
 			}
-			return mImpl;
+			return t;
 		}
 
 		/**
 		 * @return Const reference to the internal object. Assumes it is valid.
 		 */
 		const T& constImpl() const {
-			if (ProxySettings::DEBUG_CHECK_IS_VALID){
-				if (mImpl==NULL){
-					ProxySettings::DEBUG_OSTREAM << "<Warning> Accessing invalid proxy! (Proxy@" << this << ")";
-				}
-			}
-			return *mImpl;
+			return *pImpl();
 		}
 
 		/**
-		 * @return True if the pointer is valid (non-null)
+		 * @return True if the object still exists
 		 */
-		bool isValid() const {return mImpl!=NULL;}
+		bool isValid() const {return resolve()!=NULL;}
 
 		/**
-		 * Invalidate the internal pointer. (E.g., if the pointed to object gets deleted)
+		 * Invalidate this proxy. (Other proxies to the same object are unaffected.)
 		 */
-		void invalidate(){mImpl = NULL;}
-
-	private:
-		T* mImpl;
-	};
+		void invalidate(){mHandle = Handle();}
 
-	/**
-	 * A ProxyList maintains a list of proxies and is responsible
-	 * for updating the internal pointers when the data changes location or
-	 * notifying proxies if the data is deleted..
-	 */
-	template <class T>
-	class ProxyList {
-	public:
-		typedef Proxy<T> TProxy;
-		ProxyList();
-		~ProxyList();
-
-		/**
-		 * Add a new proxy to this list. It will be removed when there are no
-		 * more references to the proxy (besides this one).
-		 */
-		void add(shared_ptr<TProxy>);
-
-		/**
-		 * Remove any unreferenced proxies from this list.
-		 *
-		 * XXX: Using shared_ptr::use_count may be slow according to boost docs...
-		 */
-		void doGarbageCollection();
-
-		/**
-		 * Return a list of pointers to pointers to T,
-		 * this will be used in the vcg Allocator to update the
-		 * internal refs of Vertex and Face Proxies.
-		 */
-		std::vector<T**> getUpdateList();
+		const Handle& handle() const {return mHandle;}
 
 	private:
-		std::list<shared_ptr<TProxy> > mProxies;
+		T* resolve() const {
+			return mTable->get(mHandle);
+		}
+
+		HandleTable<T>* mTable;
+		Handle mHandle;
 	};
 }
 
@@ -1,40 +1,81 @@
-
 namespace fg {
-	template <class T> ProxyList<T>::ProxyList():mProxies(){}
-	template <class T> ProxyList<T>::~ProxyList(){}
+	template <class T>
+	HandleTable<T>::HandleTable(std::vector<T>* container)
+	:mContainer(container)
+	,mSlot()
+	,mIndex()
+	,mGenerations()
+	,mFree()
+	{}
 
 	template <class T>
-	void ProxyList<T>::add(shared_ptr<TProxy> v){
-		mProxies.push_back(v);
+	Handle HandleTable<T>::handle(const T* t) const {
+		if (t==NULL or mContainer->empty()) return Handle();
+		unsigned int i = t - &(*mContainer)[0];
+		if (i>=mSlot.size()) mSlot.resize(mContainer->size(),Handle::INVALID);
+		unsigned int s = mSlot[i];
+		if (s==Handle::INVALID){
+			// reuse a free slot, its generation was bumped when it was freed
+			if (mFree.empty()){
+				s = mIndex.size();
+				mIndex.push_back(i);
+				mGenerations.push_back(0);
+			}
+			else {
+				s = mFree.back();
+				mFree.pop_back();
+				mIndex[s] = i;
+			}
+			mSlot[i] = s;
+		}
+		return Handle(s,mGenerations[s]);
 	}
 
 	template <class T>
-	void ProxyList<T>::doGarbageCollection(){
-		int count = 0;
+	T* HandleTable<T>::get(const Handle& h) const {
+		if (h.slot>=mIndex.size() or h.generation!=mGenerations[h.slot]) return NULL;
+		const unsigned int i = mIndex[h.slot];
+		if (i>=mContainer->size()) return NULL;
+		T* t = &(*mContainer)[i];
+		return t->IsD()?NULL:t;
+	}
 
-		// Delete any proxy refs
-		typename std::list<shared_ptr<TProxy> >::iterator it = mProxies.begin();
-		while(it!=mProxies.end()){
-			std::cout << "usecount(" << *it << ") = " << it->use_count() << "\n";
-			if (it->use_count()<=1){
-				count++;
-				it = mProxies.erase(it);
-			}
-			else
-				it++;
-		}
+	template <class T>
+	void HandleTable<T>::release(unsigned int s) const {
+		mIndex[s] = Handle::INVALID;
+		mGenerations[s]++;
+		mFree.push_back(s);
+	}
+
+	template <class T>
+	void HandleTable<T>::invalidate(unsigned int i){
+		if (i>=mSlot.size() or mSlot[i]==Handle::INVALID) return;
+		release(mSlot[i]);
+		mSlot[i] = Handle::INVALID;
+	}
 
-		if (count > 0)
-			std::cout << "ProxyList: " << count << " proxies cleaned up\n";
+	template <class T>
+	void HandleTable<T>::invalidateAll(){
+		for(unsigned int s=0;s<mIndex.size();s++){
+			if (mIndex[s]!=Handle::INVALID) release(s);
+		}
+		mSlot.clear();
 	}
 
 	template <class T>
-	std::vector<T**> ProxyList<T>::getUpdateList()
-	{
-		std::vector<T**> vpl;
-		BOOST_FOREACH(shared_ptr<TProxy>& pvp, mProxies){
-			vpl.push_back(&pvp->pImpl());
+	void HandleTable<T>::remap(const std::vector<unsigned int>& newIndex){
+		// only the slots in use are touched, so this is linear in the handled elements
+		mSlot.clear();
+		for(unsigned int s=0;s<mIndex.size();s++){
+			const unsigned int i = mIndex[s];
+			if (i==Handle::INVALID) continue;
+			const unsigned int j = i<newIndex.size()?newIndex[i]:Handle::INVALID;
+			if (j==Handle::INVALID) release(s);
+			else {
+				mIndex[s] = j;
+				if (j>=mSlot.size()) mSlot.resize(j+1,Handle::INVALID);
+				mSlot[j] = s;
+			}
 		}
-		return vpl;
 	}
 }
@@ -0,0 +1,340 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/refine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+
+#include <boost/unordered_map.hpp>
+
+#include <vcg/complex/allocate.h>
+#include <vcg/complex/algorithms/update/topology.h>
+
+namespace fg {
+	namespace {
+		const unsigned int NONE = 0xffffffff;
+
+		typedef std::pair<unsigned int,unsigned int> Edge; ///< (smallest,largest) vertex index
+
+		inline Edge edge(unsigned int a, unsigned int b){return a<b?Edge(a,b):Edge(b,a);}
+
+		struct Tri {
+			Tri(){v[0] = v[1] = v[2] = NONE;}
+			Tri(unsigned int a, unsigned int b, unsigned int c){v[0] = a; v[1] = b; v[2] = c;}
+			unsigned int v[3];
+		};
+
+		/// The (up to two) triangles on an edge
+		struct EdgeFaces {
+			EdgeFaces():manifold(true){f[0] = f[1] = NONE;}
+
+			void add(unsigned int t){
+				if (f[0]==NONE) f[0] = t;
+				else if (f[1]==NONE) f[1] = t;
+				else manifold = false;
+			}
+			void replace(unsigned int t, unsigned int by){
+				if (f[0]==t) f[0] = by;
+				else if (f[1]==t) f[1] = by;
+			}
+
+			unsigned int f[2];
+			bool manifold;
+		};
+
+		/**
+		 * The faces of a MeshImpl as vertex indices, with the triangles on each
+		 * edge. The edges are split here and the result is written back by store().
+		 */
+		class Refinement {
+		public:
+			Refinement(MeshImpl& m);
+
+			bool exists(const Edge& e) const {return mEdges.count(e)>0;}
+			double length2(const Edge& e) const {return (pos[e.first]-pos[e.second]).SquaredNorm();}
+			void getEdges(std::vector<Edge>& edges) const;
+
+			/**
+			 * Split e, after splitting any longer edge of the triangles on either side
+			 * (and so on). Returns false, leaving e unsplit, if the mesh would have
+			 * more than maxFaces faces.
+			 */
+			bool refine(const Edge& e, unsigned int maxFaces = NONE);
+
+			/// Write the new vertices and faces into the mesh
+			void store();
+
+			std::vector<Tri> tris; ///< the faces, then the new triangles (NONE for deleted faces)
+			std::vector<char> selected; ///< per triangle, the halves of a triangle inherit it
+			std::vector<vcg::Point3d> pos;
+			std::vector<vcg::Point3d> nrm;
+			std::vector<Edge> created; ///< the edges made by the splits so far
+			unsigned int faces; ///< the number of live triangles
+
+		private:
+			/// the longest edge of triangle t
+			Edge longest(unsigned int t) const;
+			/// split e at its midpoint, and the triangles on either side in two
+			void split(const Edge& e);
+			void link(unsigned int a, unsigned int b, unsigned int t){mEdges[edge(a,b)].add(t);}
+
+			MeshImpl& mMesh;
+			unsigned int mNumVertices;
+			std::vector<Edge> mParents; ///< the edge each new vertex split
+			boost::unordered_map<Edge,EdgeFaces> mEdges;
+		};
+
+		Refinement::Refinement(MeshImpl& m)
+		:tris(m.face.size())
+		,selected(m.face.size(),0)
+		,pos(m.vert.size())
+		,nrm(m.vert.size())
+		,created()
+		,faces(0)
+		,mMesh(m)
+		,mNumVertices(m.vert.size())
+		,mParents()
+		,mEdges()
+		{
+			for(unsigned int i=0;i<m.vert.size();i++){
+				pos[i] = m.vert[i].cP();
+				nrm[i] = m.vert[i].cN();
+			}
+
+			mEdges.rehash(2*m.fn);
+			for(unsigned int i=0;i<m.face.size();i++){
+				const FaceImpl& f = m.face[i];
+				if (f.IsD()) continue;
+				for(int j=0;j<3;j++) tris[i].v[j] = f.cV(j) - &m.vert[0];
+				for(int j=0;j<3;j++) link(tris[i].v[j],tris[i].v[(j+1)%3],i);
+				faces++;
+			}
+		}
+
+		void Refinement::getEdges(std::vector<Edge>& edges) const {
+			edges.reserve(edges.size()+mEdges.size());
+			for(boost::unordered_map<Edge,EdgeFaces>::const_iterator it=mEdges.begin();it!=mEdges.end();++it){
+				edges.push_back(it->first);
+			}
+		}
+
+		Edge Refinement::longest(unsigned int t) const {
+			const Tri& tri = tris[t];
+			Edge best;
+			double bestLength = -1;
+			for(int j=0;j<3;j++){
+				Edge e = edge(tri.v[j],tri.v[(j+1)%3]);
+				double l = length2(e);
+				if (l>bestLength){
+					best = e;
+					bestLength = l;
+				}
+			}
+			return best;
+		}
+
+		bool Refinement::refine(const Edge& e, unsigned int maxFaces){
+			// Each edge on the path is longer than the one before, so it is finite.
+			// An edge is split once neither of its triangles has a longer one.
+			std::vector<Edge> path(1,e);
+			while (!path.empty()){
+				const Edge top = path.back();
+				boost::unordered_map<Edge,EdgeFaces>::const_iterator it = mEdges.find(top);
+				if (it==mEdges.end() or !it->second.manifold){
+					path.pop_back(); // already split, or can't be
+					continue;
+				}
+
+				const double l = length2(top)*(1+1e-9);
+				bool descended = false;
+				for(int i=0;i<2 and !descended;i++){
+					if (it->second.f[i]==NONE) continue;
+					Edge next = longest(it->second.f[i]);
+					if (next!=top and length2(next)>l and mEdges.find(next)->second.manifold){
+						path.push_back(next);
+						descended = true;
+					}
+				}
+				if (descended) continue;
+
+				if (faces+2>maxFaces) return false;
+				split(top);
+				path.pop_back();
+			}
+			return true;
+		}
+
+		void Refinement::split(const Edge& e){
+			const EdgeFaces ef = mEdges[e];
+			mEdges.erase(e);
+
+			const unsigned int m = pos.size();
+			pos.push_back((pos[e.first]+pos[e.second])*0.5);
+			vcg::Point3d n = nrm[e.first]+nrm[e.second];
+			if (n.SquaredNorm()>0) n.Normalize();
+			else n = nrm[e.first];
+			nrm.push_back(n);
+			mParents.push_back(e);
+
+			created.push_back(edge(e.first,m));
+			created.push_back(edge(m,e.second));
+			for(int i=0;i<2;i++){
+				const unsigned int t = ef.f[i];
+				if (t==NONE) continue;
+
+				// t is (p,q,c) with the edge p->q, it becomes (p,m,c) and the new triangle is (m,q,c)
+				int j = 0;
+				while (edge(tris[t].v[j],tris[t].v[(j+1)%3])!=e) j++;
+				const unsigned int p = tris[t].v[j];
+				const unsigned int q = tris[t].v[(j+1)%3];
+				const unsigned int c = tris[t].v[(j+2)%3];
+				const unsigned int t2 = tris.size();
+				tris[t].v[(j+1)%3] = m;
+				tris.push_back(Tri(m,q,c));
+				selected.push_back(selected[t]);
+				faces++;
+
+				link(p,m,t);
+				link(m,q,t2);
+				link(m,c,t);
+				link(m,c,t2);
+				mEdges[edge(q,c)].replace(t,t2);
+				created.push_back(edge(m,c));
+			}
+		}
+
+		void Refinement::store(){
+			MeshImpl& m = mMesh;
+
+			if (pos.size()>mNumVertices){
+				vcg::tri::Allocator<MeshImpl>::AddVertices(m,pos.size()-mNumVertices);
+			}
+			for(unsigned int i=mNumVertices;i<pos.size();i++){
+				// the parents come first, so their attributes are already set
+				const VertexImpl& a = m.vert[mParents[i-mNumVertices].first];
+				const VertexImpl& b = m.vert[mParents[i-mNumVertices].second];
+				VertexImpl& v = m.vert[i];
+				v.P() = pos[i];
+				v.N() = nrm[i];
+				for(int k=0;k<4;k++) v.C()[k] = (unsigned char)(((int)a.cC()[k]+b.cC()[k]+1)/2);
+				v.T().P() = (a.cT().P()+b.cT().P())*0.5;
+				v.T().N() = a.cT().N();
+			}
+
+			if (tris.size()>m.face.size()){
+				vcg::tri::Allocator<MeshImpl>::AddFaces(m,tris.size()-m.face.size());
+			}
+			for(unsigned int i=0;i<tris.size();i++){
+				if (tris[i].v[0]==NONE) continue;
+				for(int j=0;j<3;j++) m.face[i].V(j) = &m.vert[tris[i].v[j]];
+			}
+
+			vcg::tri::UpdateTopology<MeshImpl>::VertexFace(m);
+			vcg::tri::UpdateTopology<MeshImpl>::FaceFace(m);
+		}
+
+		/// how many times over its limits e is, it needs splitting if > 1
+		double excess(const Refinement& r, const Edge& e, double maxEdgeLength, double maxError){
+			double x = 0;
+			if (maxEdgeLength>0){
+				x = std::sqrt(r.length2(e))/maxEdgeLength;
+			}
+			if (maxError>0){
+				const vcg::Point3d d = r.pos[e.second]-r.pos[e.first];
+				const double error = std::abs(d*(r.nrm[e.first]-r.nrm[e.second]))/8;
+				x = std::max(x,error/maxError);
+			}
+			return x;
+		}
+	}
+
+	void refineFaces(MeshImpl& m, const std::vector<unsigned int>& faces, int levels){
+		if (levels<=0 or faces.empty()) return;
+
+		Refinement r(m);
+		for(unsigned int i=0;i<faces.size();i++){
+			if (faces[i]<r.tris.size() and r.tris[faces[i]].v[0]!=NONE) r.selected[faces[i]] = 1;
+		}
+
+		for(int level=0;level<levels;level++){
+			// split every edge in the region, longest first so there is less to propagate
+			std::vector<std::pair<double,Edge> > edges;
+			for(unsigned int t=0;t<r.tris.size();t++){
+				if (!r.selected[t]) continue;
+				for(int j=0;j<3;j++){
+					Edge e = edge(r.tris[t].v[j],r.tris[t].v[(j+1)%3]);
+					edges.push_back(std::make_pair(r.length2(e),e));
+				}
+			}
+			std::sort(edges.rbegin(),edges.rend());
+			edges.erase(std::unique(edges.begin(),edges.end()),edges.end());
+
+			for(unsigned int i=0;i<edges.size();i++){
+				r.refine(edges[i].second);
+			}
+			r.created.clear();
+		}
+
+		r.store();
+	}
+
+	int refineAdaptive(MeshImpl& m, double maxEdgeLength, double maxError, int maxFaces){
+		if (maxEdgeLength<=0 and maxError<=0) return 0;
+
+		Refinement r(m);
+		const unsigned int budget = maxFaces>0?maxFaces:NONE;
+
+		typedef std::pair<double,Edge> Entry;
+		std::priority_queue<Entry> queue;
+		{
+			std::vector<Edge> edges;
+			r.getEdges(edges);
+			for(unsigned int i=0;i<edges.size();i++){
+				double x = excess(r,edges[i],maxEdgeLength,maxError);
+				if (x>1) queue.push(Entry(x,edges[i]));
+			}
+		}
+
+		const unsigned int numVertices = r.pos.size();
+		while (!queue.empty()){
+			const Edge e = queue.top().second;
+			queue.pop();
+			if (!r.exists(e)) continue; // split on the way to another edge
+
+			const bool done = !r.refine(e,budget);
+			for(unsigned int i=0;i<r.created.size();i++){
+				double x = excess(r,r.created[i],maxEdgeLength,maxError);
+				if (x>1) queue.push(Entry(x,r.created[i]));
+			}
+			r.created.clear();
+			if (done) break;
+		}
+
+		r.store();
+		return r.pos.size()-numVertices;
+	}
+}
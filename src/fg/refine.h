@@ -0,0 +1,68 @@
+/**
+ * \file
+ * \brief Local and adaptive subdivision by edge bisection
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_REFINE_H
+#define FG_REFINE_H
+
+#include <vector>
+
+#include "fg/meshimpl.h"
+
+/*
+ * Both functions refine m by splitting edges at their midpoints, which splits
+ * the triangle on each side of the edge in two, so the result never has cracks
+ * (T-junctions). Before an edge is split, any longer edge of the triangles next
+ * to it is split first (Rivara's longest edge propagation), which keeps the
+ * triangles well shaped: the triangles around a refined region are split into
+ * graded transition triangles rather than slivers.
+ *
+ * The vertices of m keep their indices and each face stays in its slot as one
+ * of its children, the new vertices and faces are appended. The new vertices
+ * interpolate the colour, uv and normal of the edge they split. Non-manifold
+ * edges are never split. The FF and VF adjacency are rebuilt.
+ */
+namespace fg {
+	/**
+	 * \brief Subdivide the given faces (indices into m.face) levels times.
+	 *
+	 * Each level splits every edge of the faces (and of their children from the
+	 * previous level) once, so the region has about 4x the faces per level.
+	 */
+	void refineFaces(MeshImpl& m, const std::vector<unsigned int>& faces, int levels);
+
+	/**
+	 * \brief Split edges until they are shorter than maxEdgeLength and their curvature error is below maxError.
+	 *
+	 * The curvature error of an edge estimates how far its midpoint is from the
+	 * smooth surface implied by the vertex normals, |(p1-p0).(n0-n1)|/8. The
+	 * edges that exceed their limits the most are split first, and refinement
+	 * stops when the mesh would have more than maxFaces faces. A limit <= 0 is ignored.
+	 *
+	 * @return the number of edges split
+	 */
+	int refineAdaptive(MeshImpl& m, double maxEdgeLength, double maxError, int maxFaces);
+}
+
+#endif
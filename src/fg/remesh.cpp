@@ -0,0 +1,262 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/remesh.h"
+#include "fg/meshoperators_vcg.h"
+
+#include <cstdlib>
+#include <utility>
+
+#include <boost/unordered_set.hpp>
+
+namespace fg {
+	namespace {
+		typedef std::pair<unsigned int,int> Edge; ///< a face (index into m.face) and the index of the edge in it
+
+		inline vcg::Point3d normal(const vcg::Point3d& a, const vcg::Point3d& b, const vcg::Point3d& c){
+			return (b-a)^(c-a);
+		}
+
+		/// The faces being remeshed, and the steps of an iteration
+		class Remesher {
+		public:
+			Remesher(MeshImpl& m, const std::vector<unsigned int>& faces, double targetLength);
+
+			void splitLongEdges();
+			void collapseShortEdges();
+			void equalizeValences();
+			void relax();
+
+		private:
+			bool inside(const FaceImpl* f) const {return mFaces.count(f - &mMesh.face[0])>0;}
+			/// whether the edge can be split: it is manifold (the face across it can be outside, it's split too)
+			bool canSplit(FaceImpl* f, int z) const {return f->FFp(z)==f or f->FFp(z)->FFp(f->FFi(z))==f;}
+			/// whether the edge can be collapsed or flipped: it is manifold, not a border and both its faces are inside
+			bool canChange(FaceImpl* f, int z) const {return f->FFp(z)!=f and canSplit(f,z) and inside(f->FFp(z));}
+			/// whether v can move: it isn't on a border and all its faces are inside
+			bool isFree(VertexImpl* v) const;
+			/// the number of neighbours of v, and how many it should have
+			int valence(VertexImpl* v, int& target) const;
+			double length2(FaceImpl* f, int z) const {return (f->P(z)-f->P((z+1)%3)).SquaredNorm();}
+			/// whether moving lose and keep to p (joining them) makes no long edges and folds no faces
+			bool canCollapse(VertexImpl* keep, VertexImpl* lose, const vcg::Point3d& p) const;
+			/// the edges of the faces, each once
+			void getEdges(std::vector<Edge>& edges) const;
+
+			MeshImpl& mMesh;
+			boost::unordered_set<unsigned int> mFaces;
+			double mHigh2; ///< the squared lengths edges are split above
+			double mLow2; ///< and collapsed below
+		};
+
+		Remesher::Remesher(MeshImpl& m, const std::vector<unsigned int>& faces, double targetLength)
+		:mMesh(m)
+		,mFaces()
+		,mHigh2(targetLength*targetLength*16/9)
+		,mLow2(targetLength*targetLength*16/25)
+		{
+			for(unsigned int i=0;i<faces.size();i++){
+				if (faces[i]<m.face.size() and !m.face[faces[i]].IsD()) mFaces.insert(faces[i]);
+			}
+		}
+
+		bool Remesher::isFree(VertexImpl* v) const {
+			for(vcg::face::VFIterator<FaceImpl> vfi(v);!vfi.End();++vfi){
+				FaceImpl* f = vfi.F();
+				if (!inside(f) or f->FFp(vfi.I())==f or f->FFp((vfi.I()+2)%3)==f) return false;
+			}
+			return true;
+		}
+
+		int Remesher::valence(VertexImpl* v, int& target) const {
+			int n = 0;
+			bool border = false;
+			for(vcg::face::VFIterator<FaceImpl> vfi(v);!vfi.End();++vfi){
+				FaceImpl* f = vfi.F();
+				if (f->FFp(vfi.I())==f or f->FFp((vfi.I()+2)%3)==f) border = true;
+				n++;
+			}
+			target = border?4:6;
+			return border?n+1:n;
+		}
+
+		bool Remesher::canCollapse(VertexImpl* keep, VertexImpl* lose, const vcg::Point3d& p) const {
+			VertexImpl* ends[2] = {keep,lose};
+			for(int i=0;i<2;i++){
+				for(vcg::face::VFIterator<FaceImpl> vfi(ends[i]);!vfi.End();++vfi){
+					FaceImpl* f = vfi.F();
+					const int z = vfi.I();
+					VertexImpl* b = f->V((z+1)%3);
+					VertexImpl* c = f->V((z+2)%3);
+					if (b==ends[1-i] or c==ends[1-i]) continue; // a face on the edge, it goes
+					if ((b->P()-p).SquaredNorm()>mHigh2 or (c->P()-p).SquaredNorm()>mHigh2) return false;
+					if (normal(p,b->P(),c->P())*normal(f->P(z),b->P(),c->P())<=0) return false;
+				}
+			}
+			return true;
+		}
+
+		void Remesher::getEdges(std::vector<Edge>& edges) const {
+			edges.reserve(edges.size()+2*mFaces.size());
+			for(boost::unordered_set<unsigned int>::const_iterator it=mFaces.begin();it!=mFaces.end();++it){
+				FaceImpl* f = &mMesh.face[*it];
+				for(int k=0;k<3;k++){
+					FaceImpl* g = f->FFp(k);
+					if (g==f or !inside(g) or *it<(unsigned int)(g - &mMesh.face[0])) edges.push_back(Edge(*it,k));
+				}
+			}
+		}
+
+		void Remesher::splitLongEdges(){
+			std::vector<Edge> todo;
+			getEdges(todo);
+			while (!todo.empty()){
+				const Edge e = todo.back();
+				todo.pop_back();
+				FaceImpl* f = &mMesh.face[e.first];
+				if (f->IsD() or !canSplit(f,e.second) or length2(f,e.second)<=mHigh2) continue;
+
+				FaceImpl* g = f->FFp(e.second);
+				const bool outside = (g!=f and !inside(g));
+				const unsigned int first = mMesh.face.size();
+				Extrude::Pos pos(f,e.second,f->V(e.second));
+				Extrude::splitEdge(&mMesh,pos);
+
+				// the new faces are (m,b,c) then (m,a,d), the second is outside if g was
+				mFaces.insert(first);
+				if (mMesh.face.size()>first+1 and !outside) mFaces.insert(first+1);
+
+				// the halves of the edge may still be too long (the other new edges wait for the next iteration)
+				todo.push_back(Edge(e.first,e.second));
+				todo.push_back(Edge(first,0));
+			}
+		}
+
+		void Remesher::collapseShortEdges(){
+			std::vector<Edge> todo;
+			getEdges(todo);
+			while (!todo.empty()){
+				const Edge e = todo.back();
+				todo.pop_back();
+				FaceImpl* f = &mMesh.face[e.first];
+				if (f->IsD() or !canChange(f,e.second) or length2(f,e.second)>=mLow2) continue;
+
+				// a fixed end stays where it is
+				VertexImpl* keep = f->V(e.second);
+				VertexImpl* lose = f->V((e.second+1)%3);
+				const bool freeKeep = isFree(keep);
+				const bool freeLose = isFree(lose);
+				if (!freeKeep and !freeLose) continue;
+				if (!freeLose) std::swap(keep,lose);
+				const vcg::Point3d p = (freeKeep and freeLose)?(keep->P()+lose->P())*0.5:keep->P();
+				if (!canCollapse(keep,lose,p)) continue;
+
+				const unsigned int other = f->FFp(e.second) - &mMesh.face[0];
+				Extrude::Pos pos(f,e.second,keep);
+				if (!Extrude::collapseEdge(&mMesh,pos,p)) continue;
+				mFaces.erase(e.first);
+				mFaces.erase(other);
+
+				// the edges around the joined vertex may be short now
+				for(vcg::face::VFIterator<FaceImpl> vfi(keep);!vfi.End();++vfi){
+					const unsigned int i = vfi.F() - &mMesh.face[0];
+					todo.push_back(Edge(i,vfi.I()));
+					todo.push_back(Edge(i,(vfi.I()+2)%3));
+				}
+			}
+		}
+
+		void Remesher::equalizeValences(){
+			std::vector<Edge> todo;
+			getEdges(todo);
+			for(unsigned int i=0;i<todo.size();i++){
+				FaceImpl* f = &mMesh.face[todo[i].first];
+				const int z = todo[i].second;
+				if (f->IsD() or !canChange(f,z)) continue;
+
+				FaceImpl* g = f->FFp(z);
+				VertexImpl* a = f->V(z);
+				VertexImpl* b = f->V((z+1)%3);
+				VertexImpl* c = f->V((z+2)%3);
+				VertexImpl* d = g->V((f->FFi(z)+2)%3);
+				int ta, tb, tc, td;
+				const int va = valence(a,ta);
+				const int vb = valence(b,tb);
+				const int vc = valence(c,tc);
+				const int vd = valence(d,td);
+				const int before = std::abs(va-ta)+std::abs(vb-tb)+std::abs(vc-tc)+std::abs(vd-td);
+				const int after = std::abs(va-1-ta)+std::abs(vb-1-tb)+std::abs(vc+1-tc)+std::abs(vd+1-td);
+				if (after>=before) continue;
+
+				// don't fold the surface over
+				const vcg::Point3d n = normal(a->P(),b->P(),c->P())+normal(b->P(),a->P(),d->P());
+				if (normal(a->P(),d->P(),c->P())*n<=0 or normal(d->P(),b->P(),c->P())*n<=0) continue;
+
+				Extrude::Pos pos(f,z,a);
+				Extrude::flipEdge(&mMesh,pos);
+			}
+		}
+
+		void Remesher::relax(){
+			boost::unordered_set<VertexImpl*> vertices;
+			for(boost::unordered_set<unsigned int>::const_iterator it=mFaces.begin();it!=mFaces.end();++it){
+				for(int k=0;k<3;k++) vertices.insert(mMesh.face[*it].V(k));
+			}
+
+			// move each vertex to the centroid of its neighbours, projected onto its tangent plane
+			std::vector<std::pair<VertexImpl*,vcg::Point3d> > moves;
+			for(boost::unordered_set<VertexImpl*>::const_iterator it=vertices.begin();it!=vertices.end();++it){
+				VertexImpl* v = *it;
+				if (!isFree(v)) continue;
+				vcg::Point3d q(0,0,0), n(0,0,0);
+				int count = 0;
+				for(vcg::face::VFIterator<FaceImpl> vfi(v);!vfi.End();++vfi){
+					FaceImpl* f = vfi.F();
+					q += f->P((vfi.I()+1)%3);
+					n += normal(f->P(0),f->P(1),f->P(2));
+					count++;
+				}
+				if (count==0 or n.SquaredNorm()==0) continue;
+				q /= count;
+				n.Normalize();
+				moves.push_back(std::make_pair(v,q + n*((v->P()-q)*n)));
+			}
+			for(unsigned int i=0;i<moves.size();i++){
+				moves[i].first->P() = moves[i].second;
+			}
+		}
+	}
+
+	void remesh(MeshImpl& m, const std::vector<unsigned int>& faces, double targetLength, int iterations){
+		if (targetLength<=0 or iterations<=0 or faces.empty()) return;
+
+		Remesher r(m,faces,targetLength);
+		for(int i=0;i<iterations;i++){
+			r.splitLongEdges();
+			r.collapseShortEdges();
+			r.equalizeValences();
+			r.relax();
+		}
+	}
+}
@@ -0,0 +1,53 @@
+/**
+ * \file
+ * \brief Isotropic remeshing
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_REMESH_H
+#define FG_REMESH_H
+
+#include <vector>
+
+#include "fg/meshimpl.h"
+
+namespace fg {
+	/**
+	 * \brief Remesh the given faces (indices into m.face) towards edges of targetLength.
+	 *
+	 * Each iteration makes the triangles more regular (Botsch and Kobbelt's isotropic remeshing):
+	 * - edges longer than 4/3 targetLength are split at their midpoints
+	 * - edges shorter than 4/5 targetLength are collapsed (unless that would make a long edge or fold a face)
+	 * - edges are flipped where that brings the vertices closer to 6 neighbours (4 on a border)
+	 * - the vertices are moved towards the centroid of their neighbours, within their tangent plane
+	 *
+	 * The operators are those of Extrude (splitEdge, collapseEdge and flipEdge), which
+	 * patch the adjacency locally, so the cost only depends on the size of the region.
+	 * The border of the region and of the mesh stays where it is: its vertices don't move
+	 * and its edges are only split (a face outside the region on a split edge is split in
+	 * two, otherwise the outside is unchanged). The vertices and faces that are left keep
+	 * their slots, the collapsed ones are deleted (see Mesh::compact).
+	 */
+	void remesh(MeshImpl& m, const std::vector<unsigned int>& faces, double targetLength, int iterations);
+}
+
+#endif
@@ -0,0 +1,215 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/smoother.h"
+#include "fg/parallel.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/foreach.hpp>
+
+namespace fg {
+	namespace {
+		const unsigned int NONE = 0xffffffff;
+	}
+
+	Smoother::Smoother(Weights weights, double lambda, double mu)
+	:mWeights(weights)
+	,mLambda(lambda)
+	,mMu(mu)
+	,mVertices()
+	,mOffsets()
+	,mNeighbours()
+	,mOpposite()
+	,mBuffer()
+	,mBuilt(false)
+	,mTopologyId(0)
+	,mTopologyVersion(0)
+	,mSelection()
+	{
+	}
+
+	void Smoother::smooth(Mesh* m, int iterations){
+		apply(m,std::vector<unsigned int>(),std::vector<double>(),iterations);
+	}
+
+	void Smoother::smoothVertices(Mesh* m, const Mesh::VertexSet& vertices, int iterations){
+		smoothVertices(m,vertices,std::vector<double>(),iterations);
+	}
+
+	void Smoother::smoothVertices(Mesh* m, const Mesh::VertexSet& vertices, const std::vector<double>& weights, int iterations){
+		if (!weights.empty() and weights.size()!=vertices.size()){
+			throw std::runtime_error("smooth: the number of weights doesn't match the number of vertices");
+		}
+		if (vertices.empty()) return;
+		const MeshImpl& mi = *m->_impl();
+
+		std::vector<unsigned int> indices;
+		std::vector<double> w;
+		unsigned int i = 0;
+		BOOST_FOREACH(const shared_ptr<VertexProxy>& v, vertices){
+			const VertexImpl* p = v->pImpl();
+			if (p!=NULL and p>=&mi.vert.front() and p<=&mi.vert.back()){
+				indices.push_back(p - &mi.vert[0]);
+				if (!weights.empty()) w.push_back(weights[i]);
+			}
+			i++;
+		}
+		if (!indices.empty()) apply(m,indices,w,iterations);
+	}
+
+	void Smoother::smooth(MeshImpl& m, const std::vector<unsigned int>& vertices, const std::vector<double>& weights, int iterations){
+		if (iterations<=0) return;
+		build(m,vertices);
+		mBuilt = false; // no mesh to key it on
+		run(m,weights,iterations);
+	}
+
+	void Smoother::apply(Mesh* m, const std::vector<unsigned int>& vertices, const std::vector<double>& weights, int iterations){
+		if (iterations<=0) return;
+		MeshImpl& mi = *m->_impl();
+
+		if (!mBuilt or m->getTopologyId()!=mTopologyId or m->getTopologyVersion()!=mTopologyVersion or vertices!=mSelection){
+			build(mi,vertices);
+			mBuilt = true;
+			mTopologyId = m->getTopologyId();
+			mTopologyVersion = m->getTopologyVersion();
+			mSelection = vertices;
+		}
+		run(mi,weights,iterations);
+
+		if (vertices.empty()) m->_touchGeometry();
+		else {
+			for(unsigned int i=0;i<mVertices.size();i++){
+				if (mOffsets[i]<mOffsets[i+1]) m->_touchVertex(&mi.vert[mVertices[i]]);
+			}
+		}
+		m->sync();
+	}
+
+	void Smoother::build(MeshImpl& m, const std::vector<unsigned int>& vertices){
+		mVertices = vertices;
+		if (vertices.empty()){
+			mVertices.resize(m.vert.size());
+			for(unsigned int i=0;i<m.vert.size();i++) mVertices[i] = i;
+		}
+
+		mOffsets.assign(1,0);
+		mNeighbours.clear();
+		mOpposite.clear();
+		std::vector<unsigned int> border;
+		for(unsigned int i=0;i<mVertices.size();i++){
+			const unsigned int vi = mVertices[i];
+			VertexImpl* v = vi<m.vert.size()?&m.vert[vi]:NULL;
+			if (v==NULL or v->IsD() or v->VFp()==NULL){
+				mOffsets.push_back(mNeighbours.size());
+				continue;
+			}
+
+			// face f has the corners (v,b,c) in order
+			const unsigned int start = mNeighbours.size();
+			border.clear();
+			for(vcg::face::VFIterator<FaceImpl> vfi(v);!vfi.End();++vfi){
+				FaceImpl* f = vfi.F();
+				const int z = vfi.I();
+				const unsigned int b = f->V((z+1)%3) - &m.vert[0];
+				const unsigned int c = f->V((z+2)%3) - &m.vert[0];
+				mNeighbours.push_back(b);
+				mOpposite.push_back(c);
+				mNeighbours.push_back(c);
+				mOpposite.push_back(b);
+				if (vcg::face::IsBorder(*f,z)) border.push_back(b);
+				if (vcg::face::IsBorder(*f,(z+2)%3)) border.push_back(c);
+			}
+
+			if (!border.empty()){
+				// a border vertex slides along the border, unless it is a corner of two borders
+				mNeighbours.resize(start);
+				mOpposite.resize(start);
+				if (border.size()==2){
+					for(int k=0;k<2;k++){
+						mNeighbours.push_back(border[k]);
+						mOpposite.push_back(NONE);
+					}
+				}
+			}
+			mOffsets.push_back(mNeighbours.size());
+		}
+		mBuffer.resize(mVertices.size());
+	}
+
+	void Smoother::run(MeshImpl& m, const std::vector<double>& weights, int iterations){
+		if (!weights.empty() and weights.size()!=mVertices.size()){
+			throw std::runtime_error("smooth: the number of weights doesn't match the number of vertices");
+		}
+		for(int i=0;i<iterations;i++){
+			step(m,weights,mLambda);
+			if (mMu!=0) step(m,weights,mMu);
+		}
+	}
+
+	void Smoother::step(MeshImpl& m, const std::vector<double>& weights, double factor){
+		const int n = mVertices.size();
+		const int threads = Parallel::threadsFor(n);
+
+		// the new positions only depend on the old ones
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<n;i++){
+			const int begin = mOffsets[i], end = mOffsets[i+1];
+			if (begin==end) continue;
+			const vcg::Point3d p = m.vert[mVertices[i]].cP();
+
+			vcg::Point3d c(0,0,0);
+			double sum = 0;
+			if (mWeights==COTANGENT and mOpposite[begin]!=NONE){
+				for(int k=begin;k<end;k++){
+					// the cotangent of the angle at the opposite corner, negative ones are clamped
+					const vcg::Point3d& o = m.vert[mOpposite[k]].cP();
+					const vcg::Point3d& q = m.vert[mNeighbours[k]].cP();
+					const vcg::Point3d a = p - o, b = q - o;
+					const double sine = (a^b).Norm();
+					if (sine<=0) continue;
+					const double w = (a*b)/sine;
+					if (w<=0) continue;
+					c += q*w;
+					sum += w;
+				}
+			}
+			if (sum<=0){
+				c = vcg::Point3d(0,0,0);
+				for(int k=begin;k<end;k++) c += m.vert[mNeighbours[k]].cP();
+				sum = end - begin;
+			}
+
+			const double s = weights.empty()?factor:factor*weights[i];
+			mBuffer[i] = p + (c/sum - p)*s;
+		}
+
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<n;i++){
+			if (mOffsets[i]<mOffsets[i+1]) m.vert[mVertices[i]].P() = mBuffer[i];
+		}
+	}
+}
@@ -0,0 +1,122 @@
+/**
+ * \file
+ * \brief Parallel Laplacian and Taubin smoothing
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_SMOOTHER_H
+#define FG_SMOOTHER_H
+
+#include <vector>
+
+#include "fg/mesh.h"
+#include "fg/meshimpl.h"
+
+namespace fg {
+	/**
+	 * \brief Smooths the vertices of a mesh by moving them towards their neighbours.
+	 *
+	 * Each step moves every vertex v by lambda*(c - v), where c is a weighted
+	 * average of the neighbours of v:
+	 * - UNIFORM weights every neighbour the same
+	 * - COTANGENT weights each edge by the cotangents of the angles opposite it,
+	 *   so the vertices move across the surface less and the shape is kept better
+	 *
+	 * If mu isn't 0 each step is followed by a second one with mu instead of lambda
+	 * (Taubin's lambda|mu smoothing). With mu < -lambda, e.g., 0.5 and -0.53, this
+	 * removes noise without the shrinking of plain Laplacian smoothing.
+	 *
+	 * Border vertices only move along the border, towards their two border neighbours,
+	 * so an open border is smoothed like a curve (leave it out of the selection to keep it fixed).
+	 * The new positions are computed from the old ones (double buffered) so a step
+	 * doesn't depend on the order of the vertices, and runs in parallel (see fg::Parallel).
+	 * The neighbourhoods are built once for a topology and a selection, as for
+	 * Subdivider, so smoothing the same vertices every frame is cheap.
+	 *
+	 * E.g.,
+	 * \code
+	 * local s = fg.taubin_smoother()
+	 * s:smooth(m,10)
+	 * s:smooth_vertices(m,vs,10) -- only vs, the other vertices stay where they are
+	 * s:smooth_vertices(m,vs,10,ws) -- ws[i] (from 0 to 1) scales the steps of vs[i]
+	 * \endcode
+	 */
+	class Smoother {
+	public:
+		enum Weights {UNIFORM, COTANGENT};
+
+		Smoother(Weights weights = UNIFORM, double lambda = 0.5, double mu = 0);
+
+		Weights getWeights() const {return mWeights;}
+		double getLambda() const {return mLambda;}
+		double getMu() const {return mMu;}
+
+		/// \brief Smooth every vertex of m
+		void smooth(Mesh* m, int iterations);
+
+		/// \brief Smooth the given vertices of m, weights (if not empty) has a factor for each of them
+		void smoothVertices(Mesh* m, const Mesh::VertexSet& vertices, int iterations);
+		void smoothVertices(Mesh* m, const Mesh::VertexSet& vertices, const std::vector<double>& weights, int iterations);
+
+		/**
+		 * \brief (LOW LEVEL) Smooth the given vertices (indices into m.vert, every vertex if empty).
+		 *
+		 * weights (if not empty) has a factor for each of vertices, or for each vertex
+		 * of m if vertices is empty. m needs its VF and FF adjacency.
+		 */
+		void smooth(MeshImpl& m, const std::vector<unsigned int>& vertices, const std::vector<double>& weights, int iterations);
+
+	private:
+		/// find the neighbours of the vertices (all of m if vertices is empty)
+		void build(MeshImpl& m, const std::vector<unsigned int>& vertices);
+		/// move the vertices by factor of their laplacian
+		void step(MeshImpl& m, const std::vector<double>& weights, double factor);
+		/// smooth the vertices the neighbourhoods were built for
+		void run(MeshImpl& m, const std::vector<double>& weights, int iterations);
+		/// smooth m, reusing the neighbourhoods if its topology and the vertices are the same as last time
+		void apply(Mesh* m, const std::vector<unsigned int>& vertices, const std::vector<double>& weights, int iterations);
+
+		Weights mWeights;
+		double mLambda;
+		double mMu;
+
+		/**
+		 * mVertices are the vertices being smoothed (every slot of m.vert if the whole
+		 * mesh is), the neighbourhood of mVertices[i] is the entries offsets[i] <= k < offsets[i+1].
+		 * Each face around an inner vertex adds its two other corners, each with the corner
+		 * opposite the edge to it (for the cotangent weights), so every neighbour appears
+		 * twice. A border vertex only has its border neighbours (with no opposite corner).
+		 */
+		std::vector<unsigned int> mVertices;
+		std::vector<int> mOffsets;
+		std::vector<unsigned int> mNeighbours;
+		std::vector<unsigned int> mOpposite;
+		std::vector<vcg::Point3d> mBuffer; ///< the new positions
+
+		bool mBuilt;
+		unsigned int mTopologyId; ///< the mesh topology the neighbourhoods were built for
+		unsigned int mTopologyVersion;
+		std::vector<unsigned int> mSelection; ///< and the vertices they were built for (empty for all)
+	};
+}
+
+#endif
@@ -0,0 +1,335 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/spatialhash.h"
+#include "fg/meshimpl.h"
+#include "fg/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace fg {
+	// cell coordinates are clamped to this, so far away points can't overflow
+	static const double MAX_CELL = 1<<29;
+
+	SpatialHash::SpatialHash(boost::shared_ptr<Mesh> m, double cellSize)
+	:mMesh(m)
+	,mCellSize(cellSize)
+	,mAutoCellSize(cellSize<=0)
+	,mHead()
+	,mNext()
+	,mPrev()
+	,mCells()
+	,mLinked()
+	,mMin()
+	,mMax()
+	,mBuilt(false)
+	,mVersion(0)
+	,mGeometryVersion(0)
+	,mTopologyVersion(0)
+	{
+		// the journal lets update() skip the vertices that haven't moved
+		mMesh->setJournalEnabled(true);
+	}
+
+	SpatialHash::Cell SpatialHash::cellOf(const vcg::Point3d& p) const {
+		double c[3];
+		for(int a=0;a<3;a++){
+			c[a] = std::floor(p[a]/mCellSize);
+			if (c[a]<-MAX_CELL) c[a] = -MAX_CELL;
+			else if (c[a]>MAX_CELL) c[a] = MAX_CELL;
+		}
+		Cell cell = {(int)c[0],(int)c[1],(int)c[2]};
+		return cell;
+	}
+
+	unsigned int SpatialHash::bucketOf(int x, int y, int z) const {
+		// see Teschner et al., Optimized Spatial Hashing for Collision Detection of Deformable Objects
+		unsigned int h = ((unsigned int)x*73856093u) ^ ((unsigned int)y*19349663u) ^ ((unsigned int)z*83492791u);
+		return h & (mHead.size()-1);
+	}
+
+	void SpatialHash::link(int i, const Cell& c){
+		mCells[i] = c;
+		unsigned int b = bucketOf(c.x,c.y,c.z);
+		mPrev[i] = -1;
+		mNext[i] = mHead[b];
+		if (mHead[b]>=0) mPrev[mHead[b]] = i;
+		mHead[b] = i;
+		mLinked[i] = 1;
+
+		mMin.x = std::min(mMin.x,c.x);
+		mMin.y = std::min(mMin.y,c.y);
+		mMin.z = std::min(mMin.z,c.z);
+		mMax.x = std::max(mMax.x,c.x);
+		mMax.y = std::max(mMax.y,c.y);
+		mMax.z = std::max(mMax.z,c.z);
+	}
+
+	void SpatialHash::unlink(int i){
+		if (!mLinked[i]) return;
+		if (mPrev[i]>=0) mNext[mPrev[i]] = mNext[i];
+		else mHead[bucketOf(mCells[i].x,mCells[i].y,mCells[i].z)] = mNext[i];
+		if (mNext[i]>=0) mPrev[mNext[i]] = mPrev[i];
+		mLinked[i] = 0;
+	}
+
+	void SpatialHash::update(){
+		if (!mBuilt or mMesh->getTopologyVersion()!=mTopologyVersion or mMesh->_constImpl()->vert.size()!=mCells.size()){
+			rebuild();
+			return;
+		}
+		if (mMesh->getGeometryVersion()==mGeometryVersion) return;
+
+		std::vector<MeshJournal::Range> vertices, faces;
+		if (mMesh->getJournal().getChangesSince(mVersion,vertices,faces)){
+			for(unsigned int i=0;i<vertices.size();i++) moveRange(vertices[i].begin,vertices[i].end);
+		}
+		else {
+			moveRange(0,mCells.size());
+		}
+		mVersion = mMesh->getVersion();
+		mGeometryVersion = mMesh->getGeometryVersion();
+	}
+
+	void SpatialHash::rebuild(){
+		const MeshImpl& m = *mMesh->_constImpl();
+		mBuilt = true;
+		mVersion = mMesh->getVersion();
+		mGeometryVersion = mMesh->getGeometryVersion();
+		mTopologyVersion = mMesh->getTopologyVersion();
+
+		const int nv = m.vert.size();
+		const int nf = m.face.size();
+
+		if (mAutoCellSize){
+			double sum = 0;
+			int count = 0;
+			const int threads = Parallel::threadsFor(nf);
+			#pragma omp parallel for num_threads(threads) schedule(static) reduction(+:sum,count)
+			for(int i=0;i<nf;i++){
+				const FaceImpl& f = m.face[i];
+				if (f.IsD()) continue;
+				for(int j=0;j<3;j++) sum += vcg::Distance(f.cP(j),f.cP((j+1)%3));
+				count += 3;
+			}
+			mCellSize = (count>0 and sum>0)?2*sum/count:1;
+		}
+
+		unsigned int size = 64;
+		while (size<2*(unsigned int)nv) size *= 2;
+		mHead.assign(size,-1);
+		mNext.assign(nv,-1);
+		mPrev.assign(nv,-1);
+		mCells.resize(nv);
+		mLinked.assign(nv,0);
+		Cell lo = {1<<30,1<<30,1<<30}, hi = {-(1<<30),-(1<<30),-(1<<30)};
+		mMin = lo;
+		mMax = hi;
+
+		const int threads = Parallel::threadsFor(nv);
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<nv;i++){
+			if (!m.vert[i].IsD()) mCells[i] = cellOf(m.vert[i].cP());
+		}
+
+		// linked in reverse so each bucket lists its vertices in index order
+		for(int i=nv-1;i>=0;i--){
+			if (!m.vert[i].IsD()) link(i,mCells[i]);
+		}
+	}
+
+	void SpatialHash::moveRange(int begin, int end){
+		const MeshImpl& m = *mMesh->_constImpl();
+		end = std::min<int>(end,m.vert.size());
+		if (begin>=end) return;
+
+		std::vector<Cell> cells(end-begin);
+		const int threads = Parallel::threadsFor(end-begin);
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=begin;i<end;i++){
+			if (!m.vert[i].IsD()) cells[i-begin] = cellOf(m.vert[i].cP());
+		}
+
+		// most vertices stay in their cell, the rest are relinked
+		for(int i=begin;i<end;i++){
+			if (m.vert[i].IsD()){
+				unlink(i);
+			}
+			else if (!mLinked[i] or mCells[i]!=cells[i-begin]){
+				unlink(i);
+				link(i,cells[i-begin]);
+			}
+		}
+	}
+
+	bool SpatialHash::clampRange(const vcg::Point3d& p, double radius, Cell& lo, Cell& hi) const {
+		lo = cellOf(p - vcg::Point3d(radius,radius,radius));
+		hi = cellOf(p + vcg::Point3d(radius,radius,radius));
+		lo.x = std::max(lo.x,mMin.x);
+		lo.y = std::max(lo.y,mMin.y);
+		lo.z = std::max(lo.z,mMin.z);
+		hi.x = std::min(hi.x,mMax.x);
+		hi.y = std::min(hi.y,mMax.y);
+		hi.z = std::min(hi.z,mMax.z);
+		return lo.x<=hi.x and lo.y<=hi.y and lo.z<=hi.z;
+	}
+
+	void SpatialHash::queryRadius(const Vec3& p, double radius, std::vector<int>& result){
+		update();
+		const MeshImpl& m = *mMesh->_constImpl();
+		const double r2 = radius*radius;
+		Cell lo, hi;
+		if (radius<0 or !clampRange(p,radius,lo,hi)) return;
+
+		// for large radii it's quicker to test every vertex
+		const double numCells = (hi.x-lo.x+1.0)*(hi.y-lo.y+1.0)*(hi.z-lo.z+1.0);
+		if (numCells>mCells.size()){
+			for(unsigned int i=0;i<mCells.size();i++){
+				if (mLinked[i] and vcg::SquaredDistance(m.vert[i].cP(),(const vcg::Point3d&)p)<=r2) result.push_back(i);
+			}
+			return;
+		}
+
+		for(int x=lo.x;x<=hi.x;x++){
+			for(int y=lo.y;y<=hi.y;y++){
+				for(int z=lo.z;z<=hi.z;z++){
+					const Cell c = {x,y,z};
+					for(int i=mHead[bucketOf(x,y,z)];i>=0;i=mNext[i]){
+						if (mCells[i]==c and vcg::SquaredDistance(m.vert[i].cP(),(const vcg::Point3d&)p)<=r2) result.push_back(i);
+					}
+				}
+			}
+		}
+	}
+
+	void SpatialHash::queryNearest(const Vec3& p, int k, std::vector<int>& result){
+		update();
+		const MeshImpl& m = *mMesh->_constImpl();
+		const int nv = mCells.size();
+		if (k<=0 or mMin.x>mMax.x) return;
+
+		// a max-heap of the k nearest so far
+		std::vector<std::pair<double,int> > heap;
+		heap.reserve(k+1);
+
+		// search shells of cells around p's cell until nothing closer can remain
+		const Cell c = cellOf(p);
+		const int maxRing = std::max(std::max(std::max(c.x-mMin.x,mMax.x-c.x),std::max(c.y-mMin.y,mMax.y-c.y)),std::max(c.z-mMin.z,mMax.z-c.z));
+		double scanned = 0;
+		for(int r=0;r<=maxRing;r++){
+			// every point in shell r is at least (r-1) cells away from p
+			if ((int)heap.size()==k and r>0 and heap.front().first<=((r-1)*mCellSize)*((r-1)*mCellSize)) break;
+
+			const int x0 = std::max(c.x-r,mMin.x), x1 = std::min(c.x+r,mMax.x);
+			const int y0 = std::max(c.y-r,mMin.y), y1 = std::min(c.y+r,mMax.y);
+			const int z0 = std::max(c.z-r,mMin.z), z1 = std::min(c.z+r,mMax.z);
+			scanned += (x1-x0+1.0)*(y1-y0+1.0)*std::min(z1-z0+1,2);
+			if (scanned>nv){
+				// the cells are too sparse, test every vertex instead
+				heap.clear();
+				for(int i=0;i<nv;i++){
+					if (mLinked[i]) heap.push_back(std::make_pair(vcg::SquaredDistance(m.vert[i].cP(),(const vcg::Point3d&)p),i));
+				}
+				const int n = std::min<int>(k,heap.size());
+				std::partial_sort(heap.begin(),heap.begin()+n,heap.end());
+				for(int i=0;i<n;i++) result.push_back(heap[i].second);
+				return;
+			}
+
+			for(int x=x0;x<=x1;x++){
+				for(int y=y0;y<=y1;y++){
+					// inside the shell only the cells on its two z faces are new
+					const bool side = r==0 or x==c.x-r or x==c.x+r or y==c.y-r or y==c.y+r;
+					for(int z=z0;z<=z1;z++){
+						if (!side){
+							if (z<c.z-r) z = c.z-r;
+							else if (z>c.z-r and z<c.z+r) z = c.z+r;
+							if (z>z1) break;
+						}
+						const Cell cz = {x,y,z};
+						for(int i=mHead[bucketOf(x,y,z)];i>=0;i=mNext[i]){
+							if (mCells[i]!=cz) continue;
+							std::pair<double,int> d(vcg::SquaredDistance(m.vert[i].cP(),(const vcg::Point3d&)p),i);
+							if ((int)heap.size()<k){
+								heap.push_back(d);
+								std::push_heap(heap.begin(),heap.end());
+							}
+							else if (d<heap.front()){
+								std::pop_heap(heap.begin(),heap.end());
+								heap.back() = d;
+								std::push_heap(heap.begin(),heap.end());
+							}
+						}
+					}
+				}
+			}
+		}
+
+		std::sort_heap(heap.begin(),heap.end());
+		for(unsigned int i=0;i<heap.size();i++) result.push_back(heap[i].second);
+	}
+
+	void SpatialHash::queryPairs(double radius, std::vector<std::pair<int,int> >& result){
+		update();
+		const MeshImpl& m = *mMesh->_constImpl();
+		const int nv = mCells.size();
+		const double r2 = radius*radius;
+		if (radius<0) return;
+
+		// each thread collects the pairs for its (contiguous) share of the vertices
+		const int threads = Parallel::threadsFor(nv);
+		std::vector<std::vector<std::pair<int,int> > > local(threads);
+		#pragma omp parallel num_threads(threads)
+		{
+			std::vector<std::pair<int,int> >& out = local[Parallel::threadIndex()];
+			#pragma omp for schedule(static)
+			for(int i=0;i<nv;i++){
+				if (!mLinked[i]) continue;
+				const vcg::Point3d& p = m.vert[i].cP();
+				Cell lo, hi;
+				if (!clampRange(p,radius,lo,hi)) continue;
+				for(int x=lo.x;x<=hi.x;x++){
+					for(int y=lo.y;y<=hi.y;y++){
+						for(int z=lo.z;z<=hi.z;z++){
+							const Cell c = {x,y,z};
+							for(int j=mHead[bucketOf(x,y,z)];j>=0;j=mNext[j]){
+								if (j>i and mCells[j]==c and vcg::SquaredDistance(m.vert[j].cP(),p)<=r2) out.push_back(std::make_pair(i,j));
+							}
+						}
+					}
+				}
+			}
+		}
+
+		for(int t=0;t<threads;t++){
+			result.insert(result.end(),local[t].begin(),local[t].end());
+		}
+	}
+
+	boost::shared_ptr<VertexProxy> SpatialHash::getVertex(int i) const {
+		// like Mesh::selectAllVertices() this doesn't detach the storage, the proxy resolves through its handle
+		return mMesh->_newSP(const_cast<VertexImpl*>(&mMesh->_constImpl()->vert[i]));
+	}
+}
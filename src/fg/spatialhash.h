@@ -0,0 +1,118 @@
+/**
+ * \file
+ * \brief A spatial hash over the vertices of a mesh
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_SPATIALHASH_H
+#define FG_SPATIALHASH_H
+
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "fg/vec3.h"
+#include "fg/mesh.h"
+
+namespace fg {
+	/**
+	 * \brief A spatial hash of the vertex positions of a mesh, for finding the
+	 * vertices within a (euclidean) radius of a point, the k nearest vertices,
+	 * or every pair of vertices closer than a radius.
+	 *
+	 * Space is divided into cubic cells, each vertex is kept in a linked list
+	 * for the hash bucket of its cell. Queries scan the cells overlapping the
+	 * query region and test the actual distances.
+	 *
+	 * Each query first calls update(). If the mesh topology changed the hash is
+	 * rebuilt, otherwise only the vertices the mesh journal (see Mesh::getJournal())
+	 * reports as modified are moved to their new cells. The hash enables the
+	 * journal of its mesh.
+	 *
+	 * Results are vertex indices into MeshImpl::vert (see getVertex()).
+	 */
+	class SpatialHash {
+	public:
+		/**
+		 * \brief Create a hash over the vertices of m with cells of size cellSize.
+		 * Queries are fastest when the cells are about the size of the query radius.
+		 * If cellSize is 0, twice the average edge length is used.
+		 */
+		SpatialHash(boost::shared_ptr<Mesh> m, double cellSize = 0);
+
+		double getCellSize() const {return mCellSize;}
+
+		/// \brief Bring the hash up to date with the mesh
+		void update();
+
+		/// \brief Rebuild the hash from scratch
+		void rebuild();
+
+		/// \brief Append the vertices within radius of p to result (in no particular order)
+		void queryRadius(const Vec3& p, double radius, std::vector<int>& result);
+
+		/// \brief Append the (up to) k vertices nearest p to result, nearest first
+		void queryNearest(const Vec3& p, int k, std::vector<int>& result);
+
+		/**
+		 * \brief Append every pair of vertices (i,j) with i<j that are within radius of each other.
+		 * Runs in parallel, the pairs are ordered by i.
+		 */
+		void queryPairs(double radius, std::vector<std::pair<int,int> >& result);
+
+		/// \brief A proxy for vertex index i
+		boost::shared_ptr<VertexProxy> getVertex(int i) const;
+
+	private:
+		struct Cell {
+			int x, y, z;
+			bool operator==(const Cell& c) const {return x==c.x and y==c.y and z==c.z;}
+			bool operator!=(const Cell& c) const {return !(*this==c);}
+		};
+
+		Cell cellOf(const vcg::Point3d& p) const;
+		unsigned int bucketOf(int x, int y, int z) const;
+		void link(int i, const Cell& c);
+		void unlink(int i);
+		void moveRange(int begin, int end);
+		bool clampRange(const vcg::Point3d& p, double radius, Cell& lo, Cell& hi) const;
+
+		boost::shared_ptr<Mesh> mMesh;
+		double mCellSize;
+		bool mAutoCellSize;
+
+		std::vector<int> mHead; ///< first vertex in each bucket, or -1
+		std::vector<int> mNext; ///< per vertex, the next and previous vertex in its bucket (or -1)
+		std::vector<int> mPrev;
+		std::vector<Cell> mCells; ///< per vertex
+		std::vector<char> mLinked; ///< per vertex, false for deleted vertices
+		Cell mMin, mMax; ///< bounds every linked vertex's cell (they may be larger than needed after vertices move)
+
+		bool mBuilt;
+		unsigned int mVersion; ///< the mesh versions the hash is up to date with
+		unsigned int mGeometryVersion;
+		unsigned int mTopologyVersion;
+	};
+}
+
+#endif
@@ -0,0 +1,494 @@
+/**
+ * \file
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "fg/subdivider.h"
+#include "fg/meshimpl.h"
+#include "fg/parallel.h"
+#include "fg/proxy.h"
+
+#include <vcg/complex/allocate.h>
+#include <vcg/complex/algorithms/update/topology.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace fg {
+	// the attributes carried through the stencils: position (3), colour (4) and uv (2)
+	static const int STRIDE = 9;
+
+	/**
+	 * One level of subdivision. Output vertex i is the sum of weights[k]*input[indices[k]]
+	 * for offsets[i] <= k < offsets[i+1]. The first vertices correspond to the input vertices
+	 * (deleted ones have empty stencils), one vertex per input edge follows.
+	 */
+	struct Subdivider::Level {
+		int numVertices;
+		std::vector<int> offsets;
+		std::vector<int> indices;
+		std::vector<double> weights;
+		std::vector<char> live; ///< per output vertex, false for deleted slots
+		std::vector<int> faces; ///< output triangles, each input face k becomes faces 4k (the middle) to 4k+3
+	};
+
+	namespace {
+		/// The edges of a triangle list. Half-edge h is edge h%3 of face h/3, i.e., from corner h%3 to the next.
+		struct Edges {
+			std::vector<int> a, b; ///< the endpoints (a<b)
+			std::vector<int> he0, he1; ///< the first two half-edges on each edge (he1 is -1 for borders)
+			std::vector<int> count; ///< the number of faces on each edge, anything but 2 is treated as a crease
+			std::vector<int> of; ///< the edge of each half-edge
+		};
+
+		struct HalfEdge {
+			int a, b, h;
+			bool operator<(const HalfEdge& o) const {
+				if (a!=o.a) return a<o.a;
+				if (b!=o.b) return b<o.b;
+				return h<o.h;
+			}
+		};
+
+		void buildEdges(const std::vector<int>& faces, Edges& edges){
+			const int nh = faces.size();
+			std::vector<HalfEdge> hes(nh);
+			for(int h=0;h<nh;h++){
+				const int u = faces[h], w = faces[h - h%3 + (h%3+1)%3];
+				hes[h].a = std::min(u,w);
+				hes[h].b = std::max(u,w);
+				hes[h].h = h;
+			}
+			std::sort(hes.begin(),hes.end());
+
+			edges.of.resize(nh);
+			for(int i=0;i<nh;){
+				int j = i;
+				while (j<nh and hes[j].a==hes[i].a and hes[j].b==hes[i].b){
+					edges.of[hes[j].h] = edges.a.size();
+					j++;
+				}
+				edges.a.push_back(hes[i].a);
+				edges.b.push_back(hes[i].b);
+				edges.he0.push_back(hes[i].h);
+				edges.he1.push_back(j-i>1?hes[i+1].h:-1);
+				edges.count.push_back(j-i);
+				i = j;
+			}
+		}
+
+		/// A stencil under construction, repeated vertices are merged
+		struct Row {
+			std::vector<int> indices;
+			std::vector<double> weights;
+
+			void add(int i, double w){
+				for(unsigned int k=0;k<indices.size();k++){
+					if (indices[k]==i){
+						weights[k] += w;
+						return;
+					}
+				}
+				indices.push_back(i);
+				weights.push_back(w);
+			}
+
+			void clear(){
+				indices.clear();
+				weights.clear();
+			}
+		};
+
+		struct LevelBuilder {
+			const std::vector<int>& faces;
+			const Edges& edges;
+			std::vector<int> creases; ///< per vertex, the number of crease edges
+			std::vector<int> creaseNeighbour; ///< per vertex, the other ends of (the first two of) its crease edges
+			std::vector<int> neighbourOffsets; ///< per vertex, its range in neighbours
+			std::vector<int> neighbours;
+
+			LevelBuilder(int nv, const std::vector<int>& f, const Edges& e)
+			:faces(f)
+			,edges(e)
+			,creases(nv,0)
+			,creaseNeighbour(2*nv,-1)
+			,neighbourOffsets(nv+1,0)
+			,neighbours()
+			{
+				const int ne = edges.a.size();
+				for(int e=0;e<ne;e++){
+					if (edges.a[e]==edges.b[e]) continue;
+					neighbourOffsets[edges.a[e]+1]++;
+					neighbourOffsets[edges.b[e]+1]++;
+					if (edges.count[e]!=2){
+						addCrease(edges.a[e],edges.b[e]);
+						addCrease(edges.b[e],edges.a[e]);
+					}
+				}
+				for(int i=0;i<nv;i++) neighbourOffsets[i+1] += neighbourOffsets[i];
+				neighbours.resize(neighbourOffsets[nv]);
+				std::vector<int> fill(neighbourOffsets.begin(),neighbourOffsets.end()-1);
+				for(int e=0;e<ne;e++){
+					if (edges.a[e]==edges.b[e]) continue;
+					neighbours[fill[edges.a[e]]++] = edges.b[e];
+					neighbours[fill[edges.b[e]]++] = edges.a[e];
+				}
+			}
+
+			void addCrease(int v, int other){
+				if (creases[v]<2) creaseNeighbour[2*v+creases[v]] = other;
+				creases[v]++;
+			}
+
+			int corner(int h, int i) const {return faces[h - h%3 + (h%3+i)%3];}
+
+			/// the other crease neighbour of v (than not), or -1 if v isn't on a simple crease
+			int nextOnCrease(int v, int notV) const {
+				if (creases[v]!=2) return -1;
+				return creaseNeighbour[2*v]==notV?creaseNeighbour[2*v+1]:creaseNeighbour[2*v];
+			}
+
+			void loopVertex(int v, Row& row) const {
+				const int n = neighbourOffsets[v+1]-neighbourOffsets[v];
+				if (n==0 or creases[v]>2 or creases[v]==1){
+					// isolated vertices and corners stay put
+					row.add(v,1);
+				}
+				else if (creases[v]==2){
+					row.add(v,0.75);
+					row.add(creaseNeighbour[2*v],0.125);
+					row.add(creaseNeighbour[2*v+1],0.125);
+				}
+				else {
+					const double c = 0.375 + 0.25*std::cos(2*M_PI/n);
+					const double beta = (0.625 - c*c)/n;
+					row.add(v,1-n*beta);
+					for(int k=neighbourOffsets[v];k<neighbourOffsets[v+1];k++) row.add(neighbours[k],beta);
+				}
+			}
+
+			void loopEdge(int e, Row& row) const {
+				const int a = edges.a[e], b = edges.b[e];
+				if (edges.count[e]==2){
+					row.add(a,0.375);
+					row.add(b,0.375);
+					row.add(corner(edges.he0[e],2),0.125);
+					row.add(corner(edges.he1[e],2),0.125);
+				}
+				else {
+					row.add(a,0.5);
+					row.add(b,0.5);
+				}
+			}
+
+			/// add w times the vertex across edge i of the face of half-edge h, if there is none its reflection is used
+			void wing(int h, int i, double w, Row& row) const {
+				const int hh = h - h%3 + (h%3+i)%3;
+				const int e = edges.of[hh];
+				if (edges.count[e]==2){
+					const int other = edges.he0[e]==hh?edges.he1[e]:edges.he0[e];
+					row.add(corner(other,2),w);
+				}
+				else {
+					row.add(corner(hh,0),w);
+					row.add(corner(hh,1),w);
+					row.add(corner(hh,2),-w);
+				}
+			}
+
+			void butterflyEdge(int e, Row& row) const {
+				const int a = edges.a[e], b = edges.b[e];
+				if (edges.count[e]==2){
+					const int h0 = edges.he0[e], h1 = edges.he1[e];
+					row.add(a,0.5);
+					row.add(b,0.5);
+					row.add(corner(h0,2),0.125);
+					row.add(corner(h1,2),0.125);
+					wing(h0,1,-0.0625,row);
+					wing(h0,2,-0.0625,row);
+					wing(h1,1,-0.0625,row);
+					wing(h1,2,-0.0625,row);
+				}
+				else {
+					// four point rule along the crease
+					const int a0 = nextOnCrease(a,b), b0 = nextOnCrease(b,a);
+					if (a!=b and a0>=0 and b0>=0){
+						row.add(a,0.5625);
+						row.add(b,0.5625);
+						row.add(a0,-0.0625);
+						row.add(b0,-0.0625);
+					}
+					else {
+						row.add(a,0.5);
+						row.add(b,0.5);
+					}
+				}
+			}
+		};
+
+		void append(const Row& row, std::vector<int>& indices, std::vector<double>& weights, std::vector<int>& offsets){
+			indices.insert(indices.end(),row.indices.begin(),row.indices.end());
+			weights.insert(weights.end(),row.weights.begin(),row.weights.end());
+			offsets.push_back(indices.size());
+		}
+	}
+
+	Subdivider::Subdivider(Scheme scheme)
+	:mScheme(scheme)
+	,mLevels()
+	,mResult()
+	,mBack()
+	,mDoubleBuffered(false)
+	,mBackHasTopology(false)
+	,mTopologyId(0)
+	,mTopologyVersion(0)
+	,mSourceId(0)
+	,mSourceVersion(0)
+	{
+	}
+
+	Subdivider::~Subdivider(){
+	}
+
+	boost::shared_ptr<Mesh> Subdivider::subdivide(boost::shared_ptr<Mesh> m, int levels){
+		if (levels<=0) return m;
+		const MeshImpl& source = *m->_constImpl();
+
+		const bool topology = !mResult or (int)mLevels.size()!=levels
+				or m->getTopologyId()!=mTopologyId or m->getTopologyVersion()!=mTopologyVersion;
+		const bool geometry = m->getId()!=mSourceId or m->getVersion()!=mSourceVersion;
+		if (!topology and !geometry) return mResult;
+
+		// the last result stays as it is, and the one before it is written
+		bool writeTopology = topology;
+		if (mDoubleBuffered){
+			std::swap(mResult,mBack);
+			writeTopology = topology or !mBackHasTopology;
+			mBackHasTopology = !topology;
+		}
+
+		if (topology){
+			build(source,levels);
+			mTopologyId = m->getTopologyId();
+			mTopologyVersion = m->getTopologyVersion();
+		}
+
+		if (writeTopology){
+			// a result still shared with a clone is left to it
+			if (!mResult or mResult->isShared()){
+				Mesh::MeshBuilder empty;
+				mResult = empty.createMesh();
+			}
+			write(source,*mResult->_impl(),true);
+			// the old elements are gone, even where the new ones have the same index
+			mResult->_vertexHandles()->invalidateAll();
+			mResult->_faceHandles()->invalidateAll();
+			mResult->_touchTopology();
+		}
+		else {
+			write(source,*mResult->_impl(),false);
+			mResult->_touchGeometry();
+		}
+
+		mSourceId = m->getId();
+		mSourceVersion = m->getVersion();
+		mResult->sync();
+		return mResult;
+	}
+
+	void Subdivider::subdivide(const MeshImpl& m, int levels, MeshImpl& out, std::vector<unsigned int>* newFaceIndex){
+		build(m,levels);
+		write(m,out,true);
+
+		if (newFaceIndex!=NULL){
+			// the middle child of a face is first, so follow those down the levels
+			const unsigned int scale = 1u<<(2*levels);
+			newFaceIndex->assign(m.face.size(),(unsigned int)Handle::INVALID);
+			unsigned int n = 0;
+			for(unsigned int i=0;i<m.face.size();i++){
+				if (!m.face[i].IsD()) (*newFaceIndex)[i] = scale*n++;
+			}
+		}
+
+		// nothing here is worth keeping for subdivide(mesh,levels)
+		mLevels.clear();
+		mResult.reset();
+		mBack.reset();
+		mBackHasTopology = false;
+	}
+
+	void Subdivider::build(const MeshImpl& m, int levels){
+		mLevels.assign(levels,Level());
+
+		// the input of the first level is the mesh itself (without its deleted faces)
+		int nv = m.vert.size();
+		std::vector<char> live(nv);
+		for(int i=0;i<nv;i++) live[i] = !m.vert[i].IsD();
+		std::vector<int> faces;
+		faces.reserve(3*m.fn);
+		const VertexImpl* base = m.vert.empty()?NULL:&m.vert[0];
+		for(unsigned int i=0;i<m.face.size();i++){
+			const FaceImpl& f = m.face[i];
+			if (f.IsD()) continue;
+			for(int j=0;j<3;j++) faces.push_back(f.cV(j) - base);
+		}
+
+		for(int l=0;l<levels;l++){
+			const std::vector<int>& in = l==0?faces:mLevels[l-1].faces;
+			const std::vector<char>& inLive = l==0?live:mLevels[l-1].live;
+			Level& level = mLevels[l];
+
+			Edges edges;
+			buildEdges(in,edges);
+			const int ne = edges.a.size();
+			LevelBuilder b(nv,in,edges);
+
+			level.numVertices = nv + ne;
+			level.offsets.reserve(level.numVertices+1);
+			level.offsets.push_back(0);
+			level.indices.reserve(mScheme==LOOP?7*nv+4*ne:nv+8*ne);
+			level.weights.reserve(level.indices.capacity());
+
+			Row row;
+			for(int v=0;v<nv;v++){
+				row.clear();
+				if (inLive[v]){
+					if (mScheme==LOOP) b.loopVertex(v,row);
+					else row.add(v,1);
+				}
+				append(row,level.indices,level.weights,level.offsets);
+			}
+			for(int e=0;e<ne;e++){
+				row.clear();
+				if (mScheme==LOOP) b.loopEdge(e,row);
+				else b.butterflyEdge(e,row);
+				append(row,level.indices,level.weights,level.offsets);
+			}
+
+			level.live.assign(inLive.begin(),inLive.end());
+			level.live.resize(level.numVertices,1);
+
+			const int nf = in.size()/3;
+			level.faces.resize(12*nf);
+			for(int k=0;k<nf;k++){
+				const int v0 = in[3*k], v1 = in[3*k+1], v2 = in[3*k+2];
+				const int m0 = nv + edges.of[3*k], m1 = nv + edges.of[3*k+1], m2 = nv + edges.of[3*k+2];
+				const int children[12] = {m0,m1,m2, v0,m0,m2, m0,v1,m1, m2,m1,v2};
+				std::copy(children,children+12,&level.faces[12*k]);
+			}
+
+			nv = level.numVertices;
+		}
+	}
+
+	void Subdivider::evaluate(const MeshImpl& m, std::vector<double>& result) const {
+		const int nv = m.vert.size();
+		std::vector<double> in(nv*STRIDE,0), out;
+		{
+			const int threads = Parallel::threadsFor(nv);
+			#pragma omp parallel for num_threads(threads) schedule(static)
+			for(int i=0;i<nv;i++){
+				const VertexImpl& v = m.vert[i];
+				if (v.IsD()) continue;
+				double* a = &in[i*STRIDE];
+				for(int c=0;c<3;c++) a[c] = v.cP()[c];
+				for(int c=0;c<4;c++) a[3+c] = v.cC()[c];
+				a[7] = v.cT().U();
+				a[8] = v.cT().V();
+			}
+		}
+
+		for(unsigned int l=0;l<mLevels.size();l++){
+			const Level& level = mLevels[l];
+			const int n = level.numVertices;
+			out.resize(n*STRIDE);
+			const int* offsets = &level.offsets[0];
+			const int* indices = level.indices.empty()?NULL:&level.indices[0];
+			const double* weights = level.weights.empty()?NULL:&level.weights[0];
+			const double* src = in.empty()?NULL:&in[0];
+			double* dst = &out[0];
+
+			const int threads = Parallel::threadsFor(n);
+			#pragma omp parallel for num_threads(threads) schedule(static)
+			for(int i=0;i<n;i++){
+				// a fixed number of contiguous attributes per vertex, so the inner loops vectorise
+				double sum[STRIDE] = {0};
+				for(int k=offsets[i];k<offsets[i+1];k++){
+					const double w = weights[k];
+					const double* a = src + indices[k]*STRIDE;
+					for(int c=0;c<STRIDE;c++) sum[c] += w*a[c];
+				}
+				for(int c=0;c<STRIDE;c++) dst[i*STRIDE+c] = sum[c];
+			}
+			in.swap(out);
+		}
+		result.swap(in);
+	}
+
+	void Subdivider::write(const MeshImpl& m, MeshImpl& out, bool topology) const {
+		std::vector<double> attributes;
+		evaluate(m,attributes);
+		const Level& last = mLevels.back();
+		const int nv = last.numVertices;
+
+		if (topology){
+			out.Clear();
+
+			// the original vertices keep their other attributes (e.g., bones).
+			// NB: the vector is copied as assigning a single vcg element copies nothing
+			out.vert = m.vert;
+			out.vert.resize(nv);
+			out.vn = 0;
+			for(int i=0;i<nv;i++){
+				VertexImpl& v = out.vert[i];
+				v.VFp() = NULL;
+				v.VFi() = -1;
+				if (!last.live[i]) v.SetD();
+				else out.vn++;
+			}
+
+			const int nf = last.faces.size()/3;
+			vcg::tri::Allocator<MeshImpl>::AddFaces(out,nf);
+			for(int i=0;i<nf;i++){
+				for(int j=0;j<3;j++) out.face[i].V(j) = &out.vert[last.faces[3*i+j]];
+			}
+
+			vcg::tri::UpdateTopology<MeshImpl>::VertexFace(out);
+			vcg::tri::UpdateTopology<MeshImpl>::FaceFace(out);
+		}
+
+		const int threads = Parallel::threadsFor(nv);
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for(int i=0;i<nv;i++){
+			VertexImpl& v = out.vert[i];
+			if (v.IsD()) continue;
+			const double* a = &attributes[i*STRIDE];
+			v.P() = vcg::Point3d(a[0],a[1],a[2]);
+			for(int c=0;c<4;c++){
+				// the butterfly weights can overshoot
+				v.C()[c] = (unsigned char)std::max(0.0,std::min(255.0,std::floor(a[3+c]+0.5)));
+			}
+			v.T().U() = a[7];
+			v.T().V() = a[8];
+		}
+	}
+}
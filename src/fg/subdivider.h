@@ -0,0 +1,121 @@
+/**
+ * \file
+ * \brief Cached stencil-based subdivision
+ * \author ben
+ *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2011 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef FG_SUBDIVIDER_H
+#define FG_SUBDIVIDER_H
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "fg/mesh.h"
+
+namespace fg {
+	/**
+	 * \brief Subdivides triangle meshes with precomputed stencils.
+	 *
+	 * Each level of subdivision splits every triangle into four. Every vertex
+	 * of the refined mesh is a fixed weighted sum (a stencil) of the vertices
+	 * of the coarser one, and the weights only depend on the connectivity. So
+	 * the stencils (and the refined faces) are built once for a topology, and
+	 * as long as only the vertices move each further subdivision just
+	 * evaluates them, in parallel (see fg::Parallel).
+	 *
+	 * Two schemes are available:
+	 * - LOOP, Loop's approximating scheme (with the usual crease rules at borders)
+	 * - BUTTERFLY, the interpolating 8-point butterfly scheme (with the four point rule at borders).
+	 *   It has no special rules for extraordinary vertices, so it isn't as smooth near vertices of valence other than 6
+	 *
+	 * The stencils are keyed by Mesh::getTopologyId() and Mesh::getTopologyVersion(),
+	 * so they are also reused for clones of the mesh they were built from.
+	 * Vertex colours and uvs are subdivided with the same stencils as the positions.
+	 *
+	 * E.g.,
+	 * \code
+	 * local s = fg.subdivider() -- or fg.butterfly_subdivider()
+	 * -- each frame
+	 * local smooth = s:subdivide(m,2) -- cheap unless m's topology changed
+	 * \endcode
+	 */
+	class Subdivider {
+	public:
+		enum Scheme {LOOP, BUTTERFLY};
+
+		Subdivider(Scheme scheme = LOOP);
+		~Subdivider(); ///< defined where Level is complete
+
+		Scheme getScheme() const {return mScheme;}
+
+		/**
+		 * \brief Return m subdivided the given number of times.
+		 *
+		 * The same result mesh is returned (and updated in place) for as long as the
+		 * topology of the input and the number of levels stay the same, unless the
+		 * subdivider is double buffered.
+		 */
+		boost::shared_ptr<Mesh> subdivide(boost::shared_ptr<Mesh> m, int levels);
+
+		/**
+		 * \brief Alternate between two result meshes (off by default).
+		 *
+		 * Each subdivide() then writes into the mesh it returned the time before last, so the
+		 * last result can still be read (e.g., drawn) while the next one is computed in another thread.
+		 */
+		void setDoubleBuffered(bool b){mDoubleBuffered = b;}
+
+		/**
+		 * \brief (LOW LEVEL) Subdivide m into out, replacing its contents.
+		 *
+		 * The vertices of m keep their indices (their other attributes, e.g., bones, are copied),
+		 * the new vertices follow them. If newFaceIndex isn't NULL it is filled with where each
+		 * face of m ended up (one of its children), or Handle::INVALID for deleted faces.
+		 */
+		void subdivide(const MeshImpl& m, int levels, MeshImpl& out, std::vector<unsigned int>* newFaceIndex = NULL);
+
+	private:
+		struct Level;
+
+		/// (re)build the stencils for the topology of m
+		void build(const MeshImpl& m, int levels);
+		/// the subdivided vertex attributes of m, STRIDE doubles per vertex
+		void evaluate(const MeshImpl& m, std::vector<double>& result) const;
+		/// write the topology (if topology is true) and the vertex attributes into out
+		void write(const MeshImpl& m, MeshImpl& out, bool topology) const;
+
+		Scheme mScheme;
+		std::vector<Level> mLevels;
+
+		boost::shared_ptr<Mesh> mResult;
+		boost::shared_ptr<Mesh> mBack; ///< the result before mResult (if double buffered)
+		bool mDoubleBuffered;
+		bool mBackHasTopology; ///< mBack was written with the current topology
+		unsigned int mTopologyId; ///< the mesh topology the stencils were built for
+		unsigned int mTopologyVersion;
+		unsigned int mSourceId; ///< the mesh mResult was last evaluated from
+		unsigned int mSourceVersion;
+	};
+}
+
+#endif
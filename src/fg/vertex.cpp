@@ -27,22 +27,29 @@
 #include "fg/face.h"
 
 namespace fg {
-	VertexProxy::VertexProxy(Mesh* m, VertexImpl* vi):Proxy<VertexImpl>(vi),mMesh(m){}
+	VertexProxy::VertexProxy(Mesh* m, VertexImpl* vi):Proxy<VertexImpl>(m->_vertexHandles(),vi),mMesh(m){}
 
 	VertexProxy::~VertexProxy(){}
 
+	VertexImpl* VertexProxy::pImpl(){
+		mMesh->_detach();
+		return Proxy<VertexImpl>::pImpl();
+	}
+
 	Vec3 VertexProxy::getPos() const {
 		return constImpl().P();
 	}
 
 	void VertexProxy::setPos(Vec3 v){
 		pImpl()->P() = v;
+		mMesh->_touchVertex(pImpl());
 	}
 
 	void VertexProxy::setPos(double x, double y, double z){
 		pImpl()->P().X() = x;
 		pImpl()->P().Y() = y;
 		pImpl()->P().Z() = z;
+		mMesh->_touchVertex(pImpl());
 	}
 
 	Vec3 VertexProxy::getN() const {
@@ -59,6 +66,7 @@ namespace fg {
 		}
 		n.Normalize();
 		pImpl()->N() = n;
+		mMesh->_touchVertex(pImpl());
 	}
 
 	Vec3 VertexProxy::getColour() const {
@@ -70,17 +78,20 @@ namespace fg {
 	void VertexProxy::setColour(Vec3 k){
 		vcg::Color4b c(k.getX()*255,k.getY()*255,k.getZ()*255,255);
 		pImpl()->C() = c;
+		mMesh->_touchVertex(pImpl());
 	}
 
 	void VertexProxy::setColour(double r, double g, double b){
 		pImpl()->C().X() = r*255.;
 		pImpl()->C().Y() = g*255;
 		pImpl()->C().Z() = b*255;
+		mMesh->_touchVertex(pImpl());
 	}
 
 	void VertexProxy::setUV(double u, double v){
 		pImpl()->T().U() = u;
 		pImpl()->T().V() = v;
+		mMesh->_touchVertex(pImpl());
 	}
 
 	shared_ptr<FaceProxy> VertexProxy::getAdjacentFace(){
@@ -55,6 +55,9 @@ namespace fg {
 		VertexProxy(Mesh* m, VertexImpl* vi);
 		~VertexProxy();
 
+		using Proxy<VertexImpl>::pImpl; // read-only access through a const proxy
+		VertexImpl* pImpl(); ///< Write access, detaches the mesh first if its storage is shared (see Mesh::clone())
+
 		// Accessors
 		Vec3 getPos() const;
 		void setPos(Vec3 v);
@@ -82,14 +85,11 @@ namespace fg {
 	};
 
 	/**
-	 * A VertexProxyList maintains a list of vertexProxies and is responsible
-	 * for updating the internal pointers when the vertices change location or
-	 * notifying proxies if vertices are deleted..
-	 *
-	 * XXX: Need to accommodate VCG's Allocator PointerUpdater design.
-	 * 		i.e., be compatible with a std::vector<VertexPointer*>...
+	 * A VertexHandleTable resolves the handles held by VertexProxies.
+	 * It belongs to the mesh, so proxies stay valid when the vertex storage
+	 * moves and become invalid when their vertex is deleted.
 	 */
-	typedef ProxyList<VertexImpl> VertexProxyList;
+	typedef HandleTable<VertexImpl> VertexHandleTable;
 
 }
 
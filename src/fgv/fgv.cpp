@@ -13,6 +13,7 @@
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <map>
 
 #define BOOST_FILESYSTEM_VERSION 3
 #include <boost/filesystem.hpp>
@@ -31,6 +32,7 @@ using namespace boost::filesystem;
 #include "fg/mesh.h"
 #include "fg/meshimpl.h"
 #include "fg/exportmeshnode.h"
+#include "fg/subdivider.h"
 
 #include "fgv/shader.h"
 #include "fgv/trackball.h"
@@ -82,6 +84,9 @@ struct AppState {
 	double time; // current time in the simulation, read from universe->time
 } gAppState = {NULL, NULL, SM_PAUSED, SM_PAUSED, 1, 0};
 
+// a subdivider per mesh (by id), so the view only re-evaluates the stencils while the topology is unchanged
+std::map<unsigned int, boost::shared_ptr<fg::Subdivider> > gSubdividers;
+
 // control callbacks
 void TW_CALL playCb(void *clientData){
 	if (gAppState.simulationMode==SM_ERROR) {
@@ -267,6 +272,7 @@ int main(int argc, char *argv[])
 		if (gViewMode.ground) drawGroundPlane();
         
 		if (gAppState.universe!=NULL){
+			std::map<unsigned int, boost::shared_ptr<fg::Subdivider> > subdividers; // the ones still in use
 			foreach(shared_ptr<fg::MeshNode> m, gAppState.universe->meshNodes()){
 				// std::cout << m << "\n" << *m << "\n\n";
 
@@ -275,11 +281,11 @@ int main(int argc, char *argv[])
 
 				shared_ptr<fg::Mesh> old = shared_ptr<fg::Mesh>();
 				if (gViewMode.numberSubdivs>0){
-					// copy the mesh
 					old = m->mesh();
-					shared_ptr<fg::Mesh> clone = old->clone();
-					clone->smoothSubdivide(gViewMode.numberSubdivs);
-					m->setMesh(clone);
+					shared_ptr<fg::Subdivider>& s = gSubdividers[old->getId()];
+					if (!s) s.reset(new fg::Subdivider(fg::Subdivider::BUTTERFLY));
+					subdividers[old->getId()] = s;
+					m->setMesh(s->subdivide(old,gViewMode.numberSubdivs));
 				}
 
 				fg::GLRenderer::RenderMeshMode rmm;
@@ -295,9 +301,8 @@ int main(int argc, char *argv[])
 				if (gViewMode.numberSubdivs>0){
 					m->setMesh(old);
 				}
-
-				// clone should get garbage collected...
 			}
+			gSubdividers.swap(subdividers);
 
 			if (gViewMode.showNodeAxes){
 				foreach(shared_ptr<fg::Node> n, gAppState.universe->nodes()){
@@ -321,6 +326,8 @@ int main(int argc, char *argv[])
 		if (spareTime > 0) glfwSleep(spareTime);
 	}
 
+	// free the cached mesh buffers while the window's context is still alive
+	fg::GLRenderer::clearMeshCache();
 	TwTerminate();
 	glfwTerminate();
 
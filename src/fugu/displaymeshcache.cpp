@@ -0,0 +1,116 @@
+/**
+ * \file
+ * \author ben
+  *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2012 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#include "displaymeshcache.h"
+
+#include <QtConcurrentRun>
+
+// Runs in a worker thread. m is a private clone so nothing else can touch it.
+// The subdivider is double buffered, so it doesn't write into the mesh the viewer is drawing.
+static boost::shared_ptr<fg::Mesh> subdivideMesh(boost::shared_ptr<fg::Subdivider> s, boost::shared_ptr<fg::Mesh> m, int levels){
+	return s->subdivide(m,levels);
+}
+
+DisplayMeshCache::DisplayMeshCache(QObject* parent)
+:QObject(parent)
+,mEntries()
+,mBackgroundRebuild(false)
+{
+}
+
+DisplayMeshCache::~DisplayMeshCache(){
+	clear();
+}
+
+boost::shared_ptr<fg::Mesh> DisplayMeshCache::get(boost::shared_ptr<fg::Mesh> source, int levels){
+	Entry& e = mEntries[source->getId()];
+	e.used = true;
+
+	if (e.job!=NULL and (e.job->isFinished() or !mBackgroundRebuild)){
+		e.job->waitForFinished();
+		finishJob(e);
+	}
+
+	unsigned int version = source->getVersion();
+	if (e.display and e.version==version and e.levels==levels){
+		return e.display;
+	}
+
+	if (!mBackgroundRebuild){
+		e.display = e.subdivider->subdivide(source,levels);
+		e.version = version;
+		e.levels = levels;
+		return e.display;
+	}
+
+	// if a job is already running (even a stale one) wait for it to finish
+	// before starting another, meanwhile draw whatever we have
+	if (e.job==NULL){
+		startJob(e,source,levels);
+	}
+	return e.display?e.display:source;
+}
+
+void DisplayMeshCache::startJob(Entry& e, boost::shared_ptr<fg::Mesh> source, int levels){
+	e.job = new Job(this);
+	e.jobVersion = source->getVersion();
+	e.jobLevels = levels;
+	connect(e.job, SIGNAL(finished()), this, SIGNAL(meshReady()));
+
+	// the clone is made here as the source may be modified while the job runs
+	e.job->setFuture(QtConcurrent::run(subdivideMesh, e.subdivider, source->clone(), levels));
+}
+
+void DisplayMeshCache::finishJob(Entry& e){
+	e.display = e.job->result();
+	e.version = e.jobVersion;
+	e.levels = e.jobLevels;
+	delete e.job;
+	e.job = NULL;
+}
+
+void DisplayMeshCache::prune(){
+	std::map<unsigned int, Entry>::iterator it = mEntries.begin();
+	while (it!=mEntries.end()){
+		Entry& e = it->second;
+		if (!e.used and (e.job==NULL or e.job->isFinished())){
+			delete e.job;
+			mEntries.erase(it++);
+		}
+		else {
+			e.used = false;
+			++it;
+		}
+	}
+}
+
+void DisplayMeshCache::clear(){
+	for(std::map<unsigned int, Entry>::iterator it=mEntries.begin();it!=mEntries.end();++it){
+		if (it->second.job!=NULL){
+			it->second.job->waitForFinished();
+			delete it->second.job;
+		}
+	}
+	mEntries.clear();
+}
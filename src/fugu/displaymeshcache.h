@@ -0,0 +1,100 @@
+/**
+ * \file
+ * \brief Keeps the subdivided copies of meshes that the viewer draws
+ * \author ben
+  *
+ * \cond showlicense
+ * \verbatim
+ * --------------------------------------------------------------
+ *    ___
+ *   |  _|___
+ *   |  _| . | fg: real-time procedural
+ *   |_| |_  | animation and generation
+ *       |___| of 3D forms
+ *
+ *   Copyright (c) 2012 Centre for Electronic Media Art (CEMA)
+ *   Monash University, Australia. All rights reserved.
+ *
+ *   Use of this software is governed by the terms outlined in
+ *   the LICENSE file.
+ *
+ * --------------------------------------------------------------
+ * \endverbatim
+ * \endcond
+ */
+
+#ifndef DISPLAYMESHCACHE_H
+#define DISPLAYMESHCACHE_H
+
+#include "fg/mesh.h"
+#include "fg/subdivider.h"
+
+#include <QObject>
+#include <QFutureWatcher>
+
+#include <map>
+
+/**
+ * \brief Caches the smooth subdivided version of each mesh in the view.
+ *
+ * The subdivided copy is updated only when the source mesh is modified
+ * (see fg::Mesh::getVersion()) or the number of subdivisions changes. Each
+ * mesh has its own fg::Subdivider, so while only its vertices move the
+ * update just re-evaluates the subdivision stencils.
+ *
+ * With background rebuilding enabled the subdivision is done in a
+ * worker thread, and the stale copy (or the unsubdivided source if there
+ * is none yet) is returned until it finishes. meshReady() is emitted
+ * when a rebuilt mesh is available.
+ */
+class DisplayMeshCache: public QObject {
+	Q_OBJECT
+
+public:
+	DisplayMeshCache(QObject* parent = 0);
+	~DisplayMeshCache();
+
+	/// \brief Get the mesh to draw in place of source, smooth subdivided "levels" times
+	boost::shared_ptr<fg::Mesh> get(boost::shared_ptr<fg::Mesh> source, int levels);
+
+	/// \brief Forget any meshes that haven't been requested since the last prune()
+	void prune();
+
+	/// \brief Forget all meshes
+	void clear();
+
+	inline void setBackgroundRebuild(bool b){mBackgroundRebuild = b;}
+	inline bool backgroundRebuild() const {return mBackgroundRebuild;}
+
+signals:
+	void meshReady();
+
+private:
+	typedef QFutureWatcher<boost::shared_ptr<fg::Mesh> > Job;
+
+	struct Entry {
+		Entry():subdivider(new fg::Subdivider(fg::Subdivider::BUTTERFLY)),display(),version(0),levels(0),job(NULL),jobVersion(0),jobLevels(0),used(false){
+			// a job writes the next mesh while display is drawn
+			subdivider->setDoubleBuffered(true);
+		}
+
+		boost::shared_ptr<fg::Subdivider> subdivider; ///< only used by one job at a time
+		boost::shared_ptr<fg::Mesh> display;
+		unsigned int version; ///< source version display was built from
+		int levels;
+
+		Job* job; ///< the background rebuild in flight (or NULL)
+		unsigned int jobVersion;
+		int jobLevels;
+
+		bool used; ///< requested since the last prune
+	};
+
+	void startJob(Entry& e, boost::shared_ptr<fg::Mesh> source, int levels);
+	void finishJob(Entry& e);
+
+	std::map<unsigned int, Entry> mEntries;
+	bool mBackgroundRebuild;
+};
+
+#endif
@@ -43,6 +43,7 @@
 #include <cstring>
 
 #include "fgview.h"
+#include "displaymeshcache.h"
 
 #include "fg/functions.h"
 
@@ -99,6 +100,10 @@ FGView::FGView(QWidget *parent)
 	mMeshMode = MM_FLAT;
 	mColourMode = fg::GLRenderer::COLOUR_VERTEX;
 
+	mDisplayMeshes = new DisplayMeshCache(this);
+	mDisplayMeshes->setBackgroundRebuild(settings.value("view/backgroundSubdivision",false).toBool());
+	connect(mDisplayMeshes, SIGNAL(meshReady()), this, SLOT(update()));
+
 	// theme...
 	mBackgroundHorizon = settings.value("view/bghorizon", QColor(79,79,79)).value<QColor>();
 	mBackgroundSky = settings.value("view/bgsky", QColor(16,16,16)).value<QColor>();
@@ -117,10 +122,15 @@ FGView::~FGView()
 		settings.setValue("view/showNodeAxes",mShowNodeAxes);
 		settings.setValue("view/lighting",mLighting);
 		settings.setValue("view/showOverWire",mShowOverWire);
+		settings.setValue("view/backgroundSubdivision",mDisplayMeshes->backgroundRebuild());
 
 		settings.setValue("view/bghorizon", mBackgroundHorizon);
 		settings.setValue("view/bgsky", mBackgroundSky);
 	}
+
+	// the cached mesh buffers belong to this widget's context, so free them while it is current
+	makeCurrent();
+	fg::GLRenderer::clearMeshCache();
 }
 
 QSize FGView::minimumSizeHint() const
@@ -133,8 +143,8 @@ QSize FGView::sizeHint() const
 	return QSize(400, 400);
 }
 
-void FGView::setUniverse(fg::Universe* u){mUniverse = u; update();}
-void FGView::unsetUniverse(){mUniverse = NULL; update();}
+void FGView::setUniverse(fg::Universe* u){mUniverse = u; mDisplayMeshes->clear(); update();}
+void FGView::unsetUniverse(){mUniverse = NULL; mDisplayMeshes->clear(); update();}
 
 QColor FGView::getBackgroundHorizonColour() const {
 	return mBackgroundHorizon;
@@ -189,6 +199,15 @@ void FGView::setNumberOfSubdivs(int num){
 	update();
 }
 
+bool FGView::backgroundSubdivision(){
+	return mDisplayMeshes->backgroundRebuild();
+}
+
+void FGView::toggleBackgroundSubdivision(bool on){
+	mDisplayMeshes->setBackgroundRebuild(on);
+	update();
+}
+
 void FGView::setSubdivs0(){
 	setNumberOfSubdivs(0);
 }
@@ -260,6 +279,10 @@ void FGView::initializeGL()
 	}
 	std::cout << "Status: Using GLEW " << glewGetString(GLEW_VERSION) << "\n";
 
+	// initializeGL is called again if the context is recreated (e.g., on a reparent),
+	// and any cached mesh buffers belong to the old context
+	fg::GLRenderer::clearMeshCache();
+
 	qglClearColor(QColor(0,0,0));
 
 	//glEnable(GL_CULL_FACE);
@@ -422,11 +445,9 @@ void FGView::paintGL()
 
 				shared_ptr<fg::Mesh> old = shared_ptr<fg::Mesh>();
 				if (mNumberSubdivs>0){
-					// copy the mesh
+					// swap in the cached subdivided copy
 					old = m->mesh();
-					shared_ptr<fg::Mesh> clone = old->clone();
-					clone->smoothSubdivide(mNumberSubdivs);
-					m->setMesh(clone);
+					m->setMesh(mDisplayMeshes->get(old,mNumberSubdivs));
 				}
 
 				if (mShadersAvailable and mPhongShader!=NULL and mMeshMode==MM_PHONG){
@@ -470,10 +491,11 @@ void FGView::paintGL()
 				if (mNumberSubdivs>0){
 					m->setMesh(old);
 				}
-
-				// clone should get garbage collected...
 			}
 
+			// drop the copies of meshes that weren't drawn this frame
+			mDisplayMeshes->prune();
+
 
 
 			if (mShadersAvailable and mPhongShader!=NULL){
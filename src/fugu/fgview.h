@@ -34,6 +34,7 @@
 // ref: http://prideout.net/blog/?p=1
 
 class QGLShaderProgram;
+class DisplayMeshCache;
 
 #ifdef ENABLE_SSAO
 	class QGLFramebufferObject;
@@ -61,6 +62,7 @@ public:
 	inline bool showNodeAxes(){return mShowNodeAxes;}
 	inline bool showOverWire(){return mShowOverWire;}
 	inline bool lighting(){return mLighting;}
+	bool backgroundSubdivision();
 
 	inline void setSaveSettings(bool ss){mSaveSettings = ss;}
 
@@ -79,6 +81,7 @@ public slots:
 	void setSubdivs1();
 	void setSubdivs2();
 	void setSubdivs3();
+	void toggleBackgroundSubdivision(bool on);
 
 	void setDrawSmooth();
 	void setDrawFlat();
@@ -151,6 +154,7 @@ private:
 	bool mSSAO;
 	bool mShowOverWire;
 	int mNumberSubdivs;
+	DisplayMeshCache* mDisplayMeshes; // subdivided copies of the meshes
 	enum MeshMode { MM_SMOOTH, MM_FLAT, MM_WIRE, MM_POINTS, MM_TEXTURED, MM_PHONG };
 	MeshMode mMeshMode;
 	fg::GLRenderer::ColourMode mColourMode;
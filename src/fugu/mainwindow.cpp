@@ -159,6 +159,7 @@ MainWindow::MainWindow(QWidget *parent)
 	ui.actionToggleShowNodeOrigins->setChecked(mFGView->showNodeAxes());
 	ui.actionToggleLighting->setChecked(mFGView->lighting());
 	ui.actionToggleShowOverWire->setChecked(mFGView->showOverWire());
+	ui.actionToggleBackgroundSubdivision->setChecked(mFGView->backgroundSubdivision());
 
 	QSettings settings("MonashUniversity", "Fugu");
 	findChild<QAction*>("actionShowLineNumbers")->setChecked(settings.value("editor/showLineNumbers",false).toBool());
@@ -0,0 +1,108 @@
+/**
+ * Times Mesh::clone() followed by the first write to the clone (which
+ * detaches it, copying the mesh) against the previous implementation,
+ * which mapped face pointers with a std::map and then rebuilt the VF/FF
+ * topology.
+ *
+ * Usage: clone_benchmark [runs]
+ *
+ * @author BP
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <ctime>
+#include <map>
+#include <vector>
+
+#include <boost/tuple/tuple.hpp>
+
+#include "fg/mesh.h"
+#include "fg/meshimpl.h"
+
+#include <vcg/complex/allocate.h>
+#include <vcg/complex/algorithms/update/topology.h>
+
+using namespace fg;
+
+// The clone as it was before
+void legacyCopy(MeshImpl& fm, MeshImpl& m){
+	vcg::tri::Allocator<MeshImpl>::AddVertices(m,fm.vert.size());
+	std::map<VertexImpl*,int> ptrMap;
+	for(unsigned int i=0;i<fm.vert.size();i++){
+		ptrMap[&fm.vert[i]] = i;
+		m.vert[i].P() = fm.vert[i].P();
+		m.vert[i].N() = fm.vert[i].N();
+		m.vert[i].C() = fm.vert[i].C();
+		m.vert[i].T().U() = fm.vert[i].T().U();
+		m.vert[i].T().V() = fm.vert[i].T().V();
+		if (fm.vert[i].IsD()) m.vert[i].SetD();
+	}
+
+	vcg::tri::Allocator<MeshImpl>::AddFaces(m,fm.face.size());
+	for(unsigned int i=0;i<fm.face.size();i++){
+		FaceImpl* f = &m.face[i];
+		f->V(0) = &m.vert[ptrMap[fm.face[i].V(0)]];
+		f->V(1) = &m.vert[ptrMap[fm.face[i].V(1)]];
+		f->V(2) = &m.vert[ptrMap[fm.face[i].V(2)]];
+		if (fm.face[i].IsD()) f->SetD();
+	}
+
+	vcg::tri::UpdateTopology<MeshImpl>::VertexFace(m);
+	vcg::tri::UpdateTopology<MeshImpl>::FaceFace(m);
+}
+
+// A w*h grid of quads, each split into two triangles
+boost::shared_ptr<Mesh> grid(int w, int h){
+	std::vector<Vec3> verts;
+	std::vector<boost::tuple<int,int,int> > faces;
+	for(int y=0;y<=h;y++)
+		for(int x=0;x<=w;x++)
+			verts.push_back(Vec3(x,y,0));
+	for(int y=0;y<h;y++){
+		for(int x=0;x<w;x++){
+			int a = y*(w+1)+x, b = a+1, c = a+w+1, d = c+1;
+			faces.push_back(boost::make_tuple(a,b,d));
+			faces.push_back(boost::make_tuple(a,d,c));
+		}
+	}
+	return Mesh::MeshBuilder::createMesh(verts,faces);
+}
+
+double seconds(std::clock_t start){
+	return double(std::clock()-start)/CLOCKS_PER_SEC;
+}
+
+int main(int argc, char* argv[]){
+	int runs = argc>1?std::atoi(argv[1]):5;
+	const int targetFaces[] = {10000, 100000, 1000000};
+
+	std::cout << std::setw(10) << "faces" << std::setw(14) << "legacy (ms)" << std::setw(14) << "clone (ms)" << std::setw(10) << "speedup" << "\n";
+	for(int t=0;t<3;t++){
+		int side = 1;
+		while (2*side*side<targetFaces[t]) side++;
+		boost::shared_ptr<Mesh> m = grid(side,side);
+
+		std::clock_t start = std::clock();
+		for(int r=0;r<runs;r++){
+			MeshImpl copy;
+			legacyCopy(*m->_impl(),copy);
+		}
+		double legacy = seconds(start)/runs;
+
+		start = std::clock();
+		for(int r=0;r<runs;r++){
+			// clone() shares the storage, the first write is what copies it
+			boost::shared_ptr<Mesh> copy = m->clone();
+			copy->_impl();
+		}
+		double clone = seconds(start)/runs;
+
+		std::cout << std::setw(10) << m->_impl()->fn
+			<< std::setw(14) << std::fixed << std::setprecision(2) << legacy*1000
+			<< std::setw(14) << clone*1000
+			<< std::setw(9) << std::setprecision(1) << (clone>0?legacy/clone:0) << "x\n";
+	}
+	return 0;
+}
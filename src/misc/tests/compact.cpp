@@ -0,0 +1,128 @@
+/**
+ * Tests that Mesh::compact() removes the deleted elements and keeps the
+ * FF and VF adjacency valid, i.e., the same as rebuilding it from scratch,
+ * even when deleted faces were left in the VF chains.
+ *
+ * @author BP
+ */
+
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include <boost/test/minimal.hpp>
+
+#include "fg/mesh.h"
+#include "fg/meshimpl.h"
+#include "fg/meshoperators.h"
+#include "fg/vertex.h"
+#include "fg/face.h"
+#include "fg/pos.h"
+
+#include <vcg/complex/algorithms/update/topology.h>
+
+using namespace fg;
+
+/// the FF adjacency of m as face and edge indices
+std::vector<int> faceFace(const MeshImpl& m){
+	std::vector<int> ff;
+	for(unsigned int i=0;i<m.face.size();i++){
+		for(int j=0;j<3;j++){
+			ff.push_back(m.face[i].cFFp(j)-&m.face[0]);
+			ff.push_back(m.face[i].cFFi(j));
+		}
+	}
+	return ff;
+}
+
+/// the VF adjacency of m, the (face, corner) pairs around each vertex
+std::vector<std::set<std::pair<int,int> > > vertexFace(MeshImpl& m){
+	std::vector<std::set<std::pair<int,int> > > vf(m.vert.size());
+	for(unsigned int i=0;i<m.vert.size();i++){
+		if (m.vert[i].VFp()==NULL) continue;
+		for(vcg::face::VFIterator<FaceImpl> vfi(&m.vert[i]);!vfi.End();++vfi){
+			vf[i].insert(std::make_pair(int(vfi.F()-&m.face[0]),vfi.I()));
+		}
+	}
+	return vf;
+}
+
+/// true if m has no deleted elements and its adjacency is the same as when rebuilt
+bool compacted(MeshImpl& m){
+	if (m.vn!=(int)m.vert.size() or m.fn!=(int)m.face.size()) return false;
+	for(unsigned int i=0;i<m.vert.size();i++) if (m.vert[i].IsD()) return false;
+	for(unsigned int i=0;i<m.face.size();i++) if (m.face[i].IsD()) return false;
+	if (!_checkTopology(m)) return false;
+
+	const std::vector<int> ff = faceFace(m);
+	const std::vector<std::set<std::pair<int,int> > > vf = vertexFace(m);
+	vcg::tri::UpdateTopology<MeshImpl>::FaceFace(m);
+	vcg::tri::UpdateTopology<MeshImpl>::VertexFace(m);
+	return ff==faceFace(m) and vf==vertexFace(m);
+}
+
+/// collapse and split some edges
+void edit(shared_ptr<Mesh> m, int n){
+	for(int i=0;i<n;i++){
+		shared_ptr<Mesh::FaceSet> fs = m->selectAllFaces();
+		Mesh::FaceSet::iterator it = fs->begin();
+		std::advance(it,(i*7)%fs->size());
+		shared_ptr<FaceProxy> f = *it;
+		if (i%3==2) splitEdge(m.get(),Pos(f,i%3,f->getV(i%3)));
+		else collapseEdge(m.get(),Pos(f,i%3,f->getV(i%3)));
+	}
+}
+
+int test_main(int argc, char* argv[]){
+	shared_ptr<Mesh> m = Mesh::Primitives::Icosahedron();
+	m->loopSubdivide(2);
+	edit(m,60);
+	const MeshImpl& before = *m->_constImpl();
+	BOOST_REQUIRE(before.vn<(int)before.vert.size() and before.fn<(int)before.face.size());
+	const int vn = before.vn, fn = before.fn;
+
+	// compacting a clone leaves the original alone
+	shared_ptr<Mesh> c = m->clone();
+	c->compact();
+	BOOST_CHECK(c->_constImpl()->vert.size()==(unsigned int)vn);
+	BOOST_CHECK(c->_constImpl()->face.size()==(unsigned int)fn);
+	BOOST_CHECK(compacted(*c->_impl()));
+	BOOST_CHECK(m->_constImpl()->vn<(int)m->_constImpl()->vert.size());
+	BOOST_CHECK(_checkTopology(*m->_impl()));
+
+	m->compact();
+	BOOST_CHECK(m->_constImpl()->vn==vn and m->_constImpl()->fn==fn);
+	BOOST_CHECK(compacted(*m->_impl()));
+
+	// the compacted mesh can be edited (and compacted) again
+	edit(m,30);
+	BOOST_CHECK(_checkTopology(*m->_impl()));
+	m->compact();
+	BOOST_CHECK(compacted(*m->_impl()));
+
+	// sync() compacts once more than the given fraction of the elements is deleted
+	m->setAutoCompact(0.1);
+	for(int i=0;i<20;i++){
+		edit(m,5);
+		m->sync();
+		const MeshImpl& mi = *m->_constImpl();
+		BOOST_CHECK(mi.vert.size()-mi.vn<=0.1*mi.vert.size());
+		BOOST_CHECK(mi.face.size()-mi.fn<=0.1*mi.face.size());
+		BOOST_CHECK(_checkTopology(*m->_impl()));
+	}
+
+	// faces deleted without being unlinked from the VF chains are stepped over, rather than
+	// cutting the chains off (which would drop the live faces after them)
+	shared_ptr<Mesh> d = Mesh::Primitives::Icosahedron();
+	d->loopSubdivide(1);
+	MeshImpl& di = *d->_impl();
+	for(unsigned int i=0;i<di.face.size();i+=5){
+		di.face[i].SetD();
+		di.fn--;
+	}
+	const int dfn = di.fn;
+	d->compact();
+	BOOST_CHECK(d->_constImpl()->face.size()==(unsigned int)dfn);
+	BOOST_CHECK(compacted(*d->_impl()));
+	return 0;
+}
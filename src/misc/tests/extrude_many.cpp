@@ -0,0 +1,110 @@
+/**
+ * Tests the lua binding of extrude_many: the vertices can be a table (or
+ * a vertexset), the directions a table or nil (the vertex normals) and the magnitudes a
+ * table or a single number.
+ *
+ * @author BP
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/test/minimal.hpp>
+
+#include <lua.hpp>
+#include <luabind/luabind.hpp>
+
+#include "fg/bindings.h"
+#include "fg/mesh.h"
+#include "fg/meshimpl.h"
+#include "fg/vertex.h"
+
+using namespace fg;
+
+/// run a chunk of lua, printing the error if there is one
+bool run(lua_State* L, const std::string& chunk){
+	if (luaL_dostring(L,chunk.c_str())==0) return true;
+	std::cerr << lua_tostring(L,-1) << "\n";
+	lua_pop(L,1);
+	return false;
+}
+
+/// an icosphere with the 12 vertices of the icosahedron (which are far enough apart to extrude together) in a lua table
+shared_ptr<Mesh> setup(lua_State* L, std::vector<shared_ptr<VertexProxy> >& vs){
+	shared_ptr<Mesh> m = Mesh::Primitives::Icosahedron();
+	m->loopSubdivide(2);
+	m->sync();
+
+	// subdivision keeps the original vertices first
+	shared_ptr<Mesh::VertexSet> all = m->selectAllVertices();
+	vs.assign(all->begin(),all->end());
+	vs.resize(12);
+
+	luabind::object table = luabind::newtable(L);
+	for(int i=0;i<12;i++) table[i+1] = vs[i];
+	luabind::globals(L)["m"] = m.get();
+	luabind::globals(L)["vs"] = table;
+	return m;
+}
+
+/// checks the caps returned to lua and that each vertex moved magnitude along its direction
+void check(lua_State* L, shared_ptr<Mesh> m, const std::vector<shared_ptr<VertexProxy> >& vs, const std::vector<Vec3>& before, const std::vector<Vec3>& dirs, const std::vector<double>& mags){
+	BOOST_CHECK(run(L,"assert(#caps==12) for i=1,12 do assert(#caps[i]==5) end"));
+	for(int i=0;i<12;i++){
+		const Vec3 moved = vs[i]->getPos() - before[i];
+		BOOST_CHECK((moved - dirs[i]*mags[i]).length()<1e-9);
+	}
+	BOOST_CHECK(_checkTopology(*m->_impl()));
+}
+
+int test_main(int argc, char* argv[]){
+	lua_State* L = lua_open();
+	luaL_openlibs(L);
+	loadLuaBindings(L);
+
+	std::vector<shared_ptr<VertexProxy> > vs;
+
+	// nil directions and a single magnitude
+	{
+		shared_ptr<Mesh> m = setup(L,vs);
+		std::vector<Vec3> before, normals;
+		for(int i=0;i<12;i++){
+			before.push_back(vs[i]->getPos());
+			normals.push_back(vs[i]->getN());
+		}
+		BOOST_CHECK(run(L,"caps = fg.extrude_many(m,vs,nil,0.1)"));
+		check(L,m,vs,before,normals,std::vector<double>(12,0.1));
+	}
+
+	// a table of directions and a table of magnitudes
+	{
+		shared_ptr<Mesh> m = setup(L,vs);
+		std::vector<Vec3> before, dirs;
+		std::vector<double> mags;
+		luabind::object dirTable = luabind::newtable(L);
+		luabind::object magTable = luabind::newtable(L);
+		for(int i=0;i<12;i++){
+			before.push_back(vs[i]->getPos());
+			dirs.push_back(normalise(vs[i]->getPos()));
+			mags.push_back(0.05*(i+1));
+			dirTable[i+1] = dirs[i];
+			magTable[i+1] = mags[i];
+		}
+		luabind::globals(L)["dirs"] = dirTable;
+		luabind::globals(L)["mags"] = magTable;
+		BOOST_CHECK(run(L,"caps = fg.extrude_many(m,vs,dirs,mags)"));
+		check(L,m,vs,before,dirs,mags);
+	}
+
+	// a vertexset works too, but neighbouring vertices are rejected (as a lua error) before the mesh is changed
+	{
+		shared_ptr<Mesh> m = setup(L,vs);
+		const unsigned int nv = m->_constImpl()->vert.size();
+		BOOST_CHECK(!run(L,"fg.extrude_many(m,m:selectAllVertices(),nil,0.1)"));
+		BOOST_CHECK(m->_constImpl()->vert.size()==nv);
+	}
+
+	lua_close(L);
+	return 0;
+}
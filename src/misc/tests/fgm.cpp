@@ -0,0 +1,210 @@
+/**
+ * Tests the .fgm mesh cache written by MeshLoader: a cached mesh is the
+ * same as a parsed one, and a cache is rebuilt if its source has changed
+ * or it is corrupt.
+ *
+ * Usage: fgm [assets dir]
+ *
+ * @author BP
+ */
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/minimal.hpp>
+
+#include "fg/meshimpl.h"
+#include "fg/meshloader.h"
+
+#include <vcg/complex/allocate.h>
+
+using namespace fg;
+namespace fs = boost::filesystem;
+
+/// true if a and b are identical, including the order of the VF lists
+bool identical(MeshImpl& a, MeshImpl& b){
+	if (a.vert.size()!=b.vert.size() or a.face.size()!=b.face.size()) return false;
+	if (a.vn!=b.vn or a.fn!=b.fn) return false;
+	for(unsigned int i=0;i<a.vert.size();i++){
+		VertexImpl& v = a.vert[i];
+		VertexImpl& w = b.vert[i];
+		if (v.cP()!=w.cP() or v.cC()!=w.cC()) return false;
+		if (v.cT().U()!=w.cT().U() or v.cT().V()!=w.cT().V()) return false;
+		if ((v.VFp()==NULL)!=(w.VFp()==NULL)) return false;
+		if (v.VFp()!=NULL and (v.VFp()-&a.face[0]!=w.VFp()-&b.face[0] or v.VFi()!=w.VFi())) return false;
+	}
+	for(unsigned int i=0;i<a.face.size();i++){
+		FaceImpl& f = a.face[i];
+		FaceImpl& g = b.face[i];
+		for(int j=0;j<3;j++){
+			if (f.V(j)-&a.vert[0]!=g.V(j)-&b.vert[0]) return false;
+			if (f.FFp(j)-&a.face[0]!=g.FFp(j)-&b.face[0] or f.FFi(j)!=g.FFi(j)) return false;
+			if ((f.VFp(j)==NULL)!=(g.VFp(j)==NULL)) return false;
+			if (f.VFp(j)!=NULL and (f.VFp(j)-&a.face[0]!=g.VFp(j)-&b.face[0] or f.VFi(j)!=g.VFi(j))) return false;
+		}
+	}
+	return true;
+}
+
+/// load path with the cache disabled
+void parse(const std::string& path, MeshImpl& m){
+	MeshLoader::setCacheEnabled(false);
+	MeshLoader::load(path,m);
+	MeshLoader::setCacheEnabled(true);
+}
+
+/// true if loading path directly (as an .fgm) throws
+bool rejected(const std::string& path){
+	try {
+		MeshImpl m;
+		MeshLoader::load(path,m);
+	}
+	catch(std::runtime_error&){
+		return true;
+	}
+	return false;
+}
+
+/// overwrite n bytes of the file at offset (from the end if negative) with c
+void overwrite(const std::string& path, long offset, long n, char c){
+	FILE* f = fopen(path.c_str(),"r+b");
+	fseek(f,offset,offset<0?SEEK_END:SEEK_SET);
+	for(long i=0;i<n;i++) fputc(c,f);
+	fclose(f);
+}
+
+/**
+ * Backdate the cache, so if the next load of source leaves it as it is the
+ * cache was used, otherwise it was rebuilt (the modification time has a
+ * resolution of a second, too coarse to tell otherwise).
+ */
+const std::time_t BACKDATED = 1000000000;
+void backdate(const std::string& cache){
+	fs::last_write_time(cache,BACKDATED);
+}
+
+bool used(const std::string& cache){
+	return fs::exists(cache) and fs::last_write_time(cache)==BACKDATED;
+}
+
+int test_main(int argc, char* argv[]){
+	const fs::path assets = argc>1?argv[1]:"assets";
+	const fs::path dir = fs::temp_directory_path() / fs::unique_path("fg-fgm-%%%%-%%%%");
+	fs::create_directories(dir);
+	const std::string source = (dir / "blob.obj").string();
+	const std::string cache = source + ".fgm";
+	fs::copy_file(assets / "blob.obj",source);
+
+	MeshImpl parsed;
+	parse(source,parsed);
+	BOOST_REQUIRE(parsed.fn>0);
+	BOOST_CHECK(!fs::exists(cache));
+
+	// the first load writes the cache, the second uses it
+	{
+		MeshImpl m;
+		MeshLoader::load(source,m);
+		BOOST_CHECK(fs::exists(cache));
+		BOOST_CHECK(identical(m,parsed));
+	}
+	backdate(cache);
+	{
+		MeshImpl m;
+		MeshLoader::load(source,m);
+		BOOST_CHECK(used(cache));
+		BOOST_CHECK(identical(m,parsed));
+	}
+
+	// saveFGM and loading an .fgm directly
+	const std::string saved = (dir / "blob.fgm").string();
+	BOOST_CHECK(MeshLoader::saveFGM(saved,parsed));
+	{
+		MeshImpl m;
+		MeshLoader::load(saved,m);
+		BOOST_CHECK(identical(m,parsed));
+	}
+
+	// a mesh with deleted elements can't be saved
+	{
+		MeshImpl m;
+		parse(source,m);
+		vcg::tri::Allocator<MeshImpl>::DeleteFace(m,m.face[0]);
+		BOOST_CHECK(!MeshLoader::saveFGM((dir / "deleted.fgm").string(),m));
+		BOOST_CHECK(!fs::exists(dir / "deleted.fgm"));
+	}
+
+	// the source changes but keeps its size and modification time
+	{
+		const std::time_t time = fs::last_write_time(source);
+		std::ifstream in(source.c_str(),std::ios::binary);
+		std::string text((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+		in.close();
+		const std::string::size_type at = text.find("\nv 0.957710");
+		BOOST_REQUIRE(at!=std::string::npos);
+		text[at+3] = '8';
+		std::ofstream out(source.c_str(),std::ios::binary);
+		out << text;
+		out.close();
+		fs::last_write_time(source,time);
+		BOOST_REQUIRE(fs::file_size(source)==fs::file_size(assets / "blob.obj"));
+
+		MeshImpl changed, m;
+		parse(source,changed);
+		BOOST_CHECK(!identical(changed,parsed));
+		backdate(cache);
+		MeshLoader::load(source,m);
+		BOOST_CHECK(!used(cache));
+		BOOST_CHECK(identical(m,changed));
+		parsed.Clear();
+		parse(source,parsed);
+	}
+
+	// only the modification time changes
+	{
+		backdate(cache);
+		fs::last_write_time(source,fs::last_write_time(source)+10);
+		MeshImpl m;
+		MeshLoader::load(source,m);
+		BOOST_CHECK(!used(cache));
+		BOOST_CHECK(identical(m,parsed));
+	}
+
+	// corrupt caches: truncated, a bad header, and out of range indices at the end
+	for(int corruption=0;corruption<3;corruption++){
+		{
+			MeshImpl m;
+			MeshLoader::load(source,m); // (re)build the cache
+		}
+		const long size = fs::file_size(cache);
+		if (corruption==0) fs::resize_file(cache,size/2);
+		else if (corruption==1) overwrite(cache,0,1,'X');
+		else overwrite(cache,-size/4,size/4,0x7f);
+
+		fs::copy_file(cache,saved,fs::copy_option::overwrite_if_exists);
+		BOOST_CHECK(rejected(saved));
+
+		backdate(cache);
+		MeshImpl m;
+		MeshLoader::load(source,m);
+		BOOST_CHECK(!used(cache));
+		BOOST_CHECK(identical(m,parsed));
+		BOOST_CHECK(fs::file_size(cache)==(unsigned long)size);
+	}
+
+	// an unreadable cache is ignored
+	{
+		MeshImpl m;
+		fs::remove(cache);
+		fs::create_directory(cache);
+		MeshLoader::load(source,m);
+		BOOST_CHECK(identical(m,parsed));
+		fs::remove(cache);
+	}
+
+	fs::remove_all(dir);
+	return 0;
+}
@@ -0,0 +1,163 @@
+/**
+ * Tests that vertex and face proxies keep referring to the same elements
+ * across Mesh::compact() and subdivision, and that a proxy to a deleted
+ * element stays invalid (even when its slot is reused). Also checks that
+ * reading through a proxy doesn't detach a clone.
+ *
+ * @author BP
+ */
+
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/test/minimal.hpp>
+
+#include "fg/mesh.h"
+#include "fg/meshimpl.h"
+#include "fg/meshoperators.h"
+#include "fg/vertex.h"
+#include "fg/face.h"
+#include "fg/pos.h"
+
+using namespace fg;
+
+typedef std::vector<shared_ptr<VertexProxy> > Vertices;
+typedef std::vector<shared_ptr<FaceProxy> > Faces;
+
+Vertices allVertices(shared_ptr<Mesh> m){
+	shared_ptr<Mesh::VertexSet> vs = m->selectAllVertices();
+	return Vertices(vs->begin(),vs->end());
+}
+
+Faces allFaces(shared_ptr<Mesh> m){
+	shared_ptr<Mesh::FaceSet> fs = m->selectAllFaces();
+	return Faces(fs->begin(),fs->end());
+}
+
+template <class P>
+int countInvalid(const std::vector<shared_ptr<P> >& ps){
+	int n = 0;
+	BOOST_FOREACH(const shared_ptr<P>& p, ps){
+		if (!p->isValid()) n++;
+	}
+	return n;
+}
+
+/// the positions of the valid vertices (and a zero for the invalid ones)
+std::vector<Vec3> positions(const Vertices& vs){
+	std::vector<Vec3> ps;
+	BOOST_FOREACH(const shared_ptr<VertexProxy>& v, vs){
+		ps.push_back(v->isValid()?v->getPos():Vec3(0,0,0));
+	}
+	return ps;
+}
+
+/// the positions of the corners of the valid faces
+std::vector<Vec3> corners(const Faces& fs){
+	std::vector<Vec3> ps;
+	BOOST_FOREACH(const shared_ptr<FaceProxy>& f, fs){
+		for(int i=0;i<3;i++){
+			ps.push_back(f->isValid()?f->getV(i)->getPos():Vec3(0,0,0));
+		}
+	}
+	return ps;
+}
+
+/// true if every valid proxy resolves to a live element of the container
+template <class P, class T>
+bool resolvesInto(const std::vector<shared_ptr<P> >& ps, const std::vector<T>& container){
+	BOOST_FOREACH(const shared_ptr<P>& p, ps){
+		const P& proxy = *p;
+		if (!proxy.isValid()) continue;
+		const T* t = proxy.pImpl();
+		if (t<&container.front() or t>&container.back() or t->IsD()) return false;
+	}
+	return true;
+}
+
+int test_main(int argc, char* argv[]){
+	shared_ptr<Mesh> m = Mesh::Primitives::Icosahedron();
+	Vertices vs = allVertices(m);
+	Faces fs = allFaces(m);
+	BOOST_REQUIRE(vs.size()==12 and fs.size()==20);
+
+	// collapsing an edge deletes its other end and the two faces either side of it
+	shared_ptr<FaceProxy> f = fs.front();
+	shared_ptr<VertexProxy> a = f->getV(0), b = f->getV(1);
+	BOOST_REQUIRE(collapseEdge(m.get(),Pos(f,0,a)));
+	BOOST_CHECK(countInvalid(vs)==1);
+	BOOST_CHECK(countInvalid(fs)==2);
+	BOOST_CHECK(a->isValid());
+	BOOST_CHECK(!b->isValid());
+	BOOST_CHECK(!f->isValid());
+
+	// compact() moves the elements but the proxies follow them
+	const std::vector<Vec3> vps = positions(vs), fps = corners(fs);
+	m->compact();
+	const MeshImpl& mi = *m->_constImpl();
+	BOOST_CHECK(mi.vert.size()==11 and mi.vn==11);
+	BOOST_CHECK(mi.face.size()==18 and mi.fn==18);
+	BOOST_CHECK(countInvalid(vs)==1);
+	BOOST_CHECK(countInvalid(fs)==2);
+	BOOST_CHECK(!b->isValid());
+	BOOST_CHECK(positions(vs)==vps);
+	BOOST_CHECK(corners(fs)==fps);
+	BOOST_CHECK(resolvesInto(vs,mi.vert));
+	BOOST_CHECK(resolvesInto(fs,mi.face));
+
+	// new proxies reuse the slots of the deleted elements, the old ones mustn't see them
+	Vertices vs2 = allVertices(m);
+	Faces fs2 = allFaces(m);
+	BOOST_CHECK(countInvalid(vs2)==0 and countInvalid(fs2)==0);
+	BOOST_CHECK(!b->isValid() and static_cast<const VertexProxy&>(*b).pImpl()==NULL);
+	BOOST_CHECK(!f->isValid() and static_cast<const FaceProxy&>(*f).pImpl()==NULL);
+	BOOST_CHECK(m->_vertexHandles()->size()<=mi.vert.size());
+	BOOST_CHECK(m->_faceHandles()->size()<=mi.face.size());
+
+	// butterfly subdivision interpolates, so the original vertices stay where they are,
+	// and each face maps to one of its children
+	m->smoothSubdivide(1);
+	const MeshImpl& si = *m->_constImpl();
+	BOOST_CHECK(si.vert.size()==11+27 and si.face.size()==18*4);
+	BOOST_CHECK(countInvalid(vs)==1);
+	BOOST_CHECK(countInvalid(fs)==2);
+	BOOST_CHECK(positions(vs)==vps);
+	BOOST_CHECK(resolvesInto(vs,si.vert));
+	BOOST_CHECK(resolvesInto(fs,si.face));
+	BOOST_CHECK(resolvesInto(vs2,si.vert));
+	BOOST_CHECK(resolvesInto(fs2,si.face));
+
+	// loop subdivision moves the vertices, but they are still the same ones
+	m->loopSubdivide(1);
+	const MeshImpl& li = *m->_constImpl();
+	BOOST_CHECK(li.face.size()==18*16);
+	BOOST_CHECK(countInvalid(vs)==1);
+	BOOST_CHECK(countInvalid(fs)==2);
+	BOOST_CHECK(resolvesInto(vs,li.vert));
+	BOOST_CHECK(resolvesInto(fs,li.face));
+	BOOST_CHECK(!b->isValid() and !f->isValid());
+
+	// collapsing and compacting over and over doesn't grow the handle tables
+	for(int i=0;i<50;i++){
+		Faces all = allFaces(m);
+		shared_ptr<FaceProxy> g = all[i%all.size()];
+		collapseEdge(m.get(),Pos(g,0,g->getV(0)));
+		m->compact();
+		const MeshImpl& ci = *m->_constImpl();
+		BOOST_CHECK(ci.vn==(int)ci.vert.size() and ci.fn==(int)ci.face.size());
+		BOOST_CHECK(m->_vertexHandles()->size()<=ci.vert.size());
+		BOOST_CHECK(m->_faceHandles()->size()<=ci.face.size());
+		BOOST_CHECK(resolvesInto(vs,ci.vert));
+		BOOST_CHECK(resolvesInto(fs,ci.face));
+	}
+	BOOST_CHECK(!b->isValid() and !f->isValid());
+
+	// reading through a proxy (e.g., a ring query) doesn't detach a clone
+	shared_ptr<Mesh> c = m->clone();
+	shared_ptr<VertexProxy> cv = allVertices(c)[0];
+	BOOST_CHECK(!getVerticesAtDistance(c.get(),*cv,2)->empty());
+	BOOST_CHECK(!getVerticesWithinDistance(c.get(),*cv,2)->empty());
+	BOOST_CHECK(!nloop(c.get(),*cv,1)->empty());
+	BOOST_CHECK(c->isShared() and m->isShared());
+	return 0;
+}
@@ -0,0 +1,181 @@
+/**
+ * Tests that MeshLoader loads the OBJ meshes in assets/, and PLY copies
+ * of them (ascii and binary), into the same mesh as vcg's Importer
+ * followed by UpdateTopology (the previous load path).
+ *
+ * Usage: meshloader [assets dir]
+ *
+ * @author BP
+ */
+
+#include <iostream>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/test/minimal.hpp>
+
+#include "fg/meshimpl.h"
+#include "fg/meshloader.h"
+
+#include <vcg/complex/allocate.h>
+#include <vcg/complex/algorithms/update/topology.h>
+#include <wrap/io_trimesh/import.h>
+
+using namespace fg;
+
+/**
+ * True if a and b have the same vertices, faces and adjacency. The positions are
+ * compared as floats, as vcg's path read them into floats (MeshLoader keeps doubles).
+ * The texture coordinates aren't compared, as the assets have none and vcg leaves
+ * them uninitialised.
+ */
+bool same(MeshImpl& a, MeshImpl& b){
+	if (a.vert.size()!=b.vert.size() or a.face.size()!=b.face.size()) return false;
+	if (a.vn!=b.vn or a.fn!=b.fn) return false;
+	for(unsigned int i=0;i<a.vert.size();i++){
+		const VertexImpl& v = a.vert[i];
+		const VertexImpl& w = b.vert[i];
+		for(int c=0;c<3;c++){
+			if ((float)v.cP()[c]!=(float)w.cP()[c]) return false;
+		}
+		if (v.cC()!=w.cC()) return false;
+	}
+	for(unsigned int i=0;i<a.face.size();i++){
+		const FaceImpl& f = a.face[i];
+		const FaceImpl& g = b.face[i];
+		for(int j=0;j<3;j++){
+			if (f.cV(j)-&a.vert[0]!=g.cV(j)-&b.vert[0]) return false;
+			if (f.cFFp(j)-&a.face[0]!=g.cFFp(j)-&b.face[0] or f.cFFi(j)!=g.cFFi(j)) return false;
+		}
+	}
+	// the order of the faces around a vertex doesn't matter
+	for(unsigned int i=0;i<a.vert.size();i++){
+		std::set<std::pair<int,int> > vf, wf;
+		if (a.vert[i].VFp()!=NULL){
+			for(vcg::face::VFIterator<FaceImpl> vfi(&a.vert[i]);!vfi.End();++vfi){
+				vf.insert(std::make_pair(int(vfi.F()-&a.face[0]),vfi.I()));
+			}
+		}
+		if (b.vert[i].VFp()!=NULL){
+			for(vcg::face::VFIterator<FaceImpl> vfi(&b.vert[i]);!vfi.End();++vfi){
+				wf.insert(std::make_pair(int(vfi.F()-&b.face[0]),vfi.I()));
+			}
+		}
+		if (vf!=wf) return false;
+	}
+	return true;
+}
+
+/// load path with vcg, as Mesh::Load used to
+void importWithVCG(const std::string& path, MeshImpl& m){
+	_FloatMeshImpl fm;
+	vcg::tri::io::Importer<_FloatMeshImpl>::Open(fm,path.c_str());
+	_copyFloatMeshIntoMesh(fm,m);
+}
+
+void writeLE(std::ofstream& out, const void* data, int size){
+	const unsigned char* bytes = (const unsigned char*) data;
+	const unsigned int one = 1;
+	if (*(const unsigned char*)&one==1) out.write((const char*)bytes,size);
+	else for(int i=size-1;i>=0;i--) out.put(bytes[i]);
+}
+
+/// write the positions and faces of m as a ply file, with a made up colour for each vertex (no alpha, vcg ignores it)
+void writePLY(const std::string& path, const MeshImpl& m, bool binary){
+	std::ofstream out(path.c_str(),std::ios::binary);
+	out << "ply\n";
+	out << (binary?"format binary_little_endian 1.0\n":"format ascii 1.0\n");
+	out << "element vertex " << m.vert.size() << "\n";
+	out << "property float x\nproperty float y\nproperty float z\n";
+	out << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+	out << "element face " << m.face.size() << "\n";
+	out << "property list uchar int vertex_indices\n";
+	out << "end_header\n";
+	for(unsigned int i=0;i<m.vert.size();i++){
+		for(int c=0;c<3;c++){
+			const float x = m.vert[i].cP()[c];
+			if (binary) writeLE(out,&x,sizeof(x));
+			else out << (c>0?" ":"") << x;
+		}
+		for(int c=0;c<3;c++){
+			const unsigned char x = (i*(c+1)*37)%256;
+			if (binary) out.put(x);
+			else out << " " << (int)x;
+		}
+		if (!binary) out << "\n";
+	}
+	for(unsigned int i=0;i<m.face.size();i++){
+		const unsigned char n = 3;
+		if (binary) out.put(n);
+		else out << "3";
+		for(int j=0;j<3;j++){
+			const int v = m.face[i].cV(j) - &m.vert[0];
+			if (binary) writeLE(out,&v,sizeof(v));
+			else out << " " << v;
+		}
+		if (!binary) out << "\n";
+	}
+}
+
+int test_main(int argc, char* argv[]){
+	namespace fs = boost::filesystem;
+	const fs::path assets = argc>1?argv[1]:"assets";
+	const char* meshes[] = {"cube.obj", "blob.obj", "suzanne.obj"};
+	MeshLoader::setCacheEnabled(false);
+
+	const fs::path dir = fs::temp_directory_path() / fs::unique_path("fg-meshloader-%%%%-%%%%");
+	fs::create_directories(dir);
+
+	BOOST_FOREACH(const char* name, meshes){
+		const std::string path = (assets / name).string();
+		BOOST_REQUIRE(fs::exists(path));
+
+		MeshImpl loaded, imported;
+		MeshLoader::load(path,loaded);
+		importWithVCG(path,imported);
+		BOOST_CHECK(loaded.fn>0);
+		// the assets have no texture coordinates, which are zeroed (vcg leaves them uninitialised)
+		bool zeroed = true;
+		for(unsigned int i=0;i<loaded.vert.size();i++){
+			zeroed = zeroed and loaded.vert[i].cT().U()==0 and loaded.vert[i].cT().V()==0;
+		}
+		BOOST_CHECK(zeroed);
+		if (!same(loaded,imported)) BOOST_ERROR((std::string(name) + " doesn't match vcg").c_str());
+
+		for(int binary=0;binary<2;binary++){
+			const std::string ply = (dir / (fs::path(name).stem().string() + (binary?"_binary.ply":"_ascii.ply"))).string();
+			writePLY(ply,loaded,binary==1);
+			MeshImpl loadedPLY, importedPLY;
+			MeshLoader::load(ply,loadedPLY);
+			importWithVCG(ply,importedPLY);
+			BOOST_CHECK(loadedPLY.vn==loaded.vn and loadedPLY.fn==loaded.fn);
+			if (!same(loadedPLY,importedPLY)) BOOST_ERROR((ply + " doesn't match vcg").c_str());
+		}
+	}
+
+	// no cache is written while it is disabled
+	BOOST_CHECK(!fs::exists(dir / "cube_ascii.ply.fgm"));
+
+	// malformed files are rejected
+	const std::string bad = (dir / "bad.obj").string();
+	{
+		std::ofstream out(bad.c_str());
+		out << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 7\n";
+	}
+	bool threw = false;
+	try {
+		MeshImpl m;
+		MeshLoader::load(bad,m);
+	}
+	catch(std::runtime_error&){
+		threw = true;
+	}
+	BOOST_CHECK(threw);
+
+	fs::remove_all(dir);
+	return 0;
+}